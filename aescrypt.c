@@ -0,0 +1,617 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* aescrypt.c -- WinZip AES (AE-1 and AE-2) decryption
+
+   A member that WinZip encrypted with AES has compression method 99 and
+   an extra field (0x9901) that holds the real method and the key size
+   (see getAESData()).  Its data are
+
+        salt                    8, 12 or 16 bytes (128, 192, 256 bit key)
+        password verifier       2 bytes
+        encrypted data
+        authentication code     10 bytes
+
+   PBKDF2 (HMAC-SHA1, 1000 iterations) turns the password and the salt
+   into the AES key, the HMAC key and the verifier.  The data are
+   encrypted with AES in counter mode, the counter being a little-endian
+   number that starts at 1, and the authentication code is the start of
+   the HMAC-SHA1 of the encrypted data.  AE-2 members store no CRC; the
+   code is all there is to check.
+
+   decrypt() in crypt.c reads the salt and verifier and tries passwords on
+   them with aes_testkey().  From then on readbyte() and fillinbuf() hand
+   each buffer of input to aes_decrypt_buffer(), which hashes and decrypts
+   it in one go, and extract_or_test_member() calls aes_check_mac() at the
+   end of the member.
+
+   The counter blocks are encrypted eight at a time with AES-NI, or one at
+   a time with the ARMv8 crypto instructions, if the compiler targets them,
+   and SHA-1 uses the x86 SHA extensions; the processor is asked once (x86
+   only) and the portable code is used otherwise, or always with NO_AES_HW.
+ */
+
+#define __AESCRYPT_C /* identifies this source module */
+#include "unzip.h"
+#include "aescrypt.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#ifndef NO_AES_HW
+#define AES_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) && \
+    (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#ifndef NO_AES_HW
+#define AES_ARM
+#include <arm_neon.h>
+#endif
+#endif
+
+#define AES_ITERATIONS 1000 /* PBKDF2 */
+#define AES_MAXROUNDS  14
+
+typedef struct sha1_ctx {
+    uint32_t h[5];
+    uint64_t len;    /* bytes hashed so far */
+    uint8_t buf[64]; /* partial block */
+} sha1_ctx;
+
+typedef void(Sha1Fn)(uint32_t *h, const uint8_t *p, size_t nblocks);
+typedef void(CtrFn)(const uint8_t *rk, unsigned rounds, uint64_t ctr,
+                    uint8_t *buf, size_t nblocks);
+
+struct aes_ctx {
+    uint8_t rk[16 * (AES_MAXROUNDS + 1)]; /* round keys, FIPS-197 order */
+    unsigned rounds;
+    uint64_t ctr;   /* counter of the next keystream block */
+    uint8_t ks[16]; /* keystream of a block partly used */
+    unsigned kspos; /* bytes of ks used, 16 if none left */
+    sha1_ctx inner; /* HMAC:  hash of the data so far */
+    sha1_ctx outer; /* HMAC:  outer hash, after the key */
+};
+
+static void sha1_blocks_c(uint32_t *h, const uint8_t *p, size_t nblocks);
+static void aes_ctr_c(const uint8_t *rk, unsigned rounds, uint64_t ctr,
+                      uint8_t *buf, size_t nblocks);
+#ifdef AES_X86
+__attribute__((target("aes,sse4.1"))) static void
+aes_ctr_ni(const uint8_t *rk, unsigned rounds, uint64_t ctr, uint8_t *buf,
+           size_t nblocks);
+#endif
+
+#ifdef AES_ARM
+static void aes_ctr_arm(const uint8_t *rk, unsigned rounds, uint64_t ctr,
+                        uint8_t *buf, size_t nblocks);
+static CtrFn *aes_ctr = aes_ctr_arm;
+#else
+static CtrFn *aes_ctr = aes_ctr_c;
+#endif
+static Sha1Fn *sha1_blocks = sha1_blocks_c;
+
+/*---------------------------------------------------------------------------
+    SHA-1, HMAC-SHA1 and PBKDF2.
+  ---------------------------------------------------------------------------*/
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define BE32(p)                                                  \
+    ((uint32_t) (p)[0] << 24 | (uint32_t) (p)[1] << 16 |         \
+     (uint32_t) (p)[2] << 8 | (uint32_t) (p)[3])
+
+static void sha1_blocks_c(h, p, nblocks)
+uint32_t *h;
+const uint8_t *p;
+size_t nblocks;
+{
+    uint32_t w[16], a, b, c, d, e, f, t;
+    unsigned i;
+
+    for (; nblocks > 0; nblocks--, p += 64) {
+        a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (i = 0; i < 80; i++) {
+            if (i < 16)
+                w[i] = BE32(p + 4 * i);
+            else {
+                t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^
+                    w[i & 15];
+                w[i & 15] = ROL32(t, 1);
+            }
+            if (i < 20)
+                f = (d ^ (b & (c ^ d))) + 0x5a827999;
+            else if (i < 40)
+                f = (b ^ c ^ d) + 0x6ed9eba1;
+            else if (i < 60)
+                f = ((b & c) | (d & (b | c))) + 0x8f1bbcdc;
+            else
+                f = (b ^ c ^ d) + 0xca62c1d6;
+            t = ROL32(a, 5) + f + e + w[i & 15];
+            e = d, d = c, c = ROL32(b, 30), b = a, a = t;
+        }
+        h[0] += a, h[1] += b, h[2] += c, h[3] += d, h[4] += e;
+    }
+}
+
+#ifdef AES_X86
+/* four rounds:  e gets the next message words, f the current state */
+#define SHA1_NI4(e, f, m0, m1, m2, m3, fn)               \
+    e = _mm_sha1nexte_epu32(e, m0);                      \
+    f = abcd;                                            \
+    m1 = _mm_sha1msg2_epu32(m1, m0);                     \
+    abcd = _mm_sha1rnds4_epu32(abcd, e, fn);             \
+    m3 = _mm_sha1msg1_epu32(m3, m0);                     \
+    m2 = _mm_xor_si128(m2, m0)
+
+__attribute__((target("sha,sse4.1"))) static void sha1_blocks_ni(h, p,
+                                                                nblocks)
+uint32_t *h;
+const uint8_t *p;
+size_t nblocks;
+{
+    const __m128i bswap =
+        _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd, abcd0, e0, e00, e1, m0, m1, m2, m3;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) h), 0x1b);
+    e0 = _mm_set_epi32((int) h[4], 0, 0, 0);
+    for (; nblocks > 0; nblocks--, p += 64) {
+        abcd0 = abcd;
+        e00 = e0;
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) p), bswap);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 16)),
+                              bswap);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 32)),
+                              bswap);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 48)),
+                              bswap);
+
+        /* rounds 0-15, while the schedule gets going */
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+        e1 = _mm_sha1nexte_epu32(e1, m3);
+        e0 = abcd;
+        m0 = _mm_sha1msg2_epu32(m0, m3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m2 = _mm_sha1msg1_epu32(m2, m3);
+        m1 = _mm_xor_si128(m1, m3);
+
+        /* rounds 16-79 (the last few compute words nobody uses) */
+        SHA1_NI4(e0, e1, m0, m1, m2, m3, 0);
+        SHA1_NI4(e1, e0, m1, m2, m3, m0, 1);
+        SHA1_NI4(e0, e1, m2, m3, m0, m1, 1);
+        SHA1_NI4(e1, e0, m3, m0, m1, m2, 1);
+        SHA1_NI4(e0, e1, m0, m1, m2, m3, 1);
+        SHA1_NI4(e1, e0, m1, m2, m3, m0, 1);
+        SHA1_NI4(e0, e1, m2, m3, m0, m1, 2);
+        SHA1_NI4(e1, e0, m3, m0, m1, m2, 2);
+        SHA1_NI4(e0, e1, m0, m1, m2, m3, 2);
+        SHA1_NI4(e1, e0, m1, m2, m3, m0, 2);
+        SHA1_NI4(e0, e1, m2, m3, m0, m1, 2);
+        SHA1_NI4(e1, e0, m3, m0, m1, m2, 3);
+        SHA1_NI4(e0, e1, m0, m1, m2, m3, 3);
+        SHA1_NI4(e1, e0, m1, m2, m3, m0, 3);
+        SHA1_NI4(e0, e1, m2, m3, m0, m1, 3);
+        SHA1_NI4(e1, e0, m3, m0, m1, m2, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e00);
+        abcd = _mm_add_epi32(abcd, abcd0);
+    }
+    _mm_storeu_si128((__m128i *) h, _mm_shuffle_epi32(abcd, 0x1b));
+    h[4] = (uint32_t) _mm_extract_epi32(e0, 3);
+}
+#endif /* AES_X86 */
+
+static void sha1_init(s)
+sha1_ctx *s;
+{
+    s->h[0] = 0x67452301;
+    s->h[1] = 0xefcdab89;
+    s->h[2] = 0x98badcfe;
+    s->h[3] = 0x10325476;
+    s->h[4] = 0xc3d2e1f0;
+    s->len = 0;
+}
+
+static void sha1_update(s, p, n)
+sha1_ctx *s;
+const uint8_t *p;
+size_t n;
+{
+    unsigned used = (unsigned) s->len & 63;
+
+    s->len += n;
+    if (used) {
+        unsigned k = 64 - used;
+
+        if (n < k) {
+            memcpy(s->buf + used, p, n);
+            return;
+        }
+        memcpy(s->buf + used, p, k);
+        (*sha1_blocks)(s->h, s->buf, 1);
+        p += k;
+        n -= k;
+    }
+    if (n >= 64) {
+        (*sha1_blocks)(s->h, p, n >> 6);
+        p += n & ~(size_t) 63;
+        n &= 63;
+    }
+    memcpy(s->buf, p, n);
+}
+
+static void sha1_final(s, out)
+sha1_ctx *s;
+uint8_t *out;
+{
+    uint64_t bits = s->len << 3;
+    unsigned used = (unsigned) s->len & 63;
+    int i;
+
+    s->buf[used++] = 0x80;
+    if (used > 56) {
+        memset(s->buf + used, 0, 64 - used);
+        (*sha1_blocks)(s->h, s->buf, 1);
+        used = 0;
+    }
+    memset(s->buf + used, 0, 56 - used);
+    for (i = 0; i < 8; i++)
+        s->buf[56 + i] = (uint8_t) (bits >> (56 - 8 * i));
+    (*sha1_blocks)(s->h, s->buf, 1);
+    for (i = 0; i < 20; i++)
+        out[i] = (uint8_t) (s->h[i >> 2] >> (24 - 8 * (i & 3)));
+}
+
+/* the inner and outer hashes of HMAC-SHA1 after the key */
+static void hmac_init(inner, outer, key, keylen)
+sha1_ctx *inner;
+sha1_ctx *outer;
+const uint8_t *key;
+size_t keylen;
+{
+    uint8_t pad[64], hkey[20];
+    unsigned i;
+
+    if (keylen > 64) {
+        sha1_init(inner);
+        sha1_update(inner, key, keylen);
+        sha1_final(inner, hkey);
+        key = hkey;
+        keylen = 20;
+    }
+    for (i = 0; i < 64; i++)
+        pad[i] = (uint8_t) ((i < keylen ? key[i] : 0) ^ 0x36);
+    sha1_init(inner);
+    sha1_update(inner, pad, 64);
+    for (i = 0; i < 64; i++)
+        pad[i] ^= 0x36 ^ 0x5c;
+    sha1_init(outer);
+    sha1_update(outer, pad, 64);
+}
+
+/* finish the HMAC of whatever went into inner */
+static void hmac_final(inner, outer, out)
+sha1_ctx *inner;
+const sha1_ctx *outer;
+uint8_t *out;
+{
+    sha1_ctx o;
+
+    sha1_final(inner, out);
+    o = *outer;
+    sha1_update(&o, out, 20);
+    sha1_final(&o, out);
+}
+
+/* PBKDF2 with HMAC-SHA1 */
+static void pbkdf2(pwd, pwdlen, salt, saltlen, out, outlen)
+const uint8_t *pwd;
+size_t pwdlen;
+const uint8_t *salt;
+size_t saltlen;
+uint8_t *out;
+size_t outlen;
+{
+    sha1_ctx inner, outer, s;
+    uint8_t u[20], t[20], cnt[4];
+    uint32_t block;
+    unsigned i, j, n;
+
+    hmac_init(&inner, &outer, pwd, pwdlen);
+    for (block = 1; outlen > 0; block++) {
+        cnt[0] = (uint8_t) (block >> 24);
+        cnt[1] = (uint8_t) (block >> 16);
+        cnt[2] = (uint8_t) (block >> 8);
+        cnt[3] = (uint8_t) block;
+        s = inner;
+        sha1_update(&s, salt, saltlen);
+        sha1_update(&s, cnt, 4);
+        hmac_final(&s, &outer, u);
+        memcpy(t, u, 20);
+        for (i = 1; i < AES_ITERATIONS; i++) {
+            s = inner;
+            sha1_update(&s, u, 20);
+            hmac_final(&s, &outer, u);
+            for (j = 0; j < 20; j++)
+                t[j] ^= u[j];
+        }
+        n = outlen < 20 ? (unsigned) outlen : 20;
+        memcpy(out, t, n);
+        out += n;
+        outlen -= n;
+    }
+}
+
+/*---------------------------------------------------------------------------
+    AES encryption (decryption in counter mode needs no more).
+  ---------------------------------------------------------------------------*/
+
+static uint8_t sbox[256];
+static uint32_t te0[256]; /* S-box and MixColumns:  2s, s, s, 3s */
+
+/* build the tables and find out what the processor can do */
+static void aes_init_tables()
+{
+    uint8_t pw[256], lg[256], x;
+    unsigned i;
+
+    /* powers of 3 in GF(2^8), for the inverses */
+    for (i = 0, x = 1; i < 255; i++) {
+        pw[i] = x;
+        lg[x] = (uint8_t) i;
+        x ^= (uint8_t) (x << 1) ^ (x & 0x80 ? 0x1b : 0);
+    }
+    for (i = 0; i < 256; i++) {
+        uint8_t s = i ? pw[(255 - lg[i]) % 255] : 0, a = s;
+        unsigned r;
+        uint8_t s2;
+
+        for (r = 0; r < 4; r++) { /* the affine transform */
+            a = (uint8_t) (a << 1 | a >> 7);
+            s ^= a;
+        }
+        s ^= 0x63;
+        sbox[i] = s;
+        s2 = (uint8_t) (s << 1) ^ (s & 0x80 ? 0x1b : 0);
+        te0[i] = (uint32_t) s2 | (uint32_t) s << 8 | (uint32_t) s << 16 |
+                 (uint32_t) (s2 ^ s) << 24;
+    }
+
+#ifdef AES_X86
+    {
+        unsigned a, b, c, d;
+
+        if (__get_cpuid(1, &a, &b, &c, &d) && (c & (1 << 19)) != 0) {
+            /* SSE4.1 is there */
+            if (c & (1 << 25))
+                aes_ctr = aes_ctr_ni;
+            if (__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1 << 29)))
+                sha1_blocks = sha1_blocks_ni;
+        }
+    }
+#endif
+}
+
+/* expand key (16, 24 or 32 bytes) into rk; returns the number of rounds */
+static unsigned aes_expand(rk, key, keylen)
+uint8_t *rk;
+const uint8_t *key;
+unsigned keylen;
+{
+    unsigned nk = keylen / 4, rounds = nk + 6, i;
+    uint8_t rcon = 1, t[4];
+
+    memcpy(rk, key, keylen);
+    for (i = nk; i < 4 * (rounds + 1); i++) {
+        memcpy(t, rk + 4 * (i - 1), 4);
+        if (i % nk == 0) {
+            uint8_t t0 = t[0];
+
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[t0];
+            rcon = (uint8_t) (rcon << 1) ^ (rcon & 0x80 ? 0x1b : 0);
+        } else if (nk > 6 && i % nk == 4) {
+            t[0] = sbox[t[0]];
+            t[1] = sbox[t[1]];
+            t[2] = sbox[t[2]];
+            t[3] = sbox[t[3]];
+        }
+        rk[4 * i] = rk[4 * (i - nk)] ^ t[0];
+        rk[4 * i + 1] = rk[4 * (i - nk) + 1] ^ t[1];
+        rk[4 * i + 2] = rk[4 * (i - nk) + 2] ^ t[2];
+        rk[4 * i + 3] = rk[4 * (i - nk) + 3] ^ t[3];
+    }
+    return rounds;
+}
+
+#define LE32(p)                                                  \
+    ((uint32_t) (p)[0] | (uint32_t) (p)[1] << 8 |                \
+     (uint32_t) (p)[2] << 16 | (uint32_t) (p)[3] << 24)
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define TE(a, b, c, d)                                           \
+    (te0[(a) & 0xff] ^ ROR32(te0[((b) >> 8) & 0xff], 24) ^       \
+     ROR32(te0[((c) >> 16) & 0xff], 16) ^ ROR32(te0[(d) >> 24], 8))
+#define SB(a, b, c, d)                                           \
+    ((uint32_t) sbox[(a) & 0xff] | (uint32_t) sbox[((b) >> 8) & 0xff] << 8 | \
+     (uint32_t) sbox[((c) >> 16) & 0xff] << 16 |                 \
+     (uint32_t) sbox[(d) >> 24] << 24)
+
+/* xor the keystream for counters ctr, ctr + 1, ... into nblocks blocks */
+static void aes_ctr_c(rk, rounds, ctr, buf, nblocks)
+const uint8_t *rk;
+unsigned rounds;
+uint64_t ctr;
+uint8_t *buf;
+size_t nblocks;
+{
+    uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+    const uint8_t *k;
+    unsigned r, i;
+
+    for (; nblocks > 0; nblocks--, ctr++, buf += 16) {
+        s0 = (uint32_t) ctr ^ LE32(rk);
+        s1 = (uint32_t) (ctr >> 32) ^ LE32(rk + 4);
+        s2 = LE32(rk + 8);
+        s3 = LE32(rk + 12);
+        for (r = 1, k = rk + 16; r < rounds; r++, k += 16) {
+            t0 = TE(s0, s1, s2, s3) ^ LE32(k);
+            t1 = TE(s1, s2, s3, s0) ^ LE32(k + 4);
+            t2 = TE(s2, s3, s0, s1) ^ LE32(k + 8);
+            t3 = TE(s3, s0, s1, s2) ^ LE32(k + 12);
+            s0 = t0, s1 = t1, s2 = t2, s3 = t3;
+        }
+        t0 = SB(s0, s1, s2, s3) ^ LE32(k);
+        t1 = SB(s1, s2, s3, s0) ^ LE32(k + 4);
+        t2 = SB(s2, s3, s0, s1) ^ LE32(k + 8);
+        t3 = SB(s3, s0, s1, s2) ^ LE32(k + 12);
+        for (i = 0; i < 4; i++) {
+            buf[i] ^= (uint8_t) (t0 >> 8 * i);
+            buf[4 + i] ^= (uint8_t) (t1 >> 8 * i);
+            buf[8 + i] ^= (uint8_t) (t2 >> 8 * i);
+            buf[12 + i] ^= (uint8_t) (t3 >> 8 * i);
+        }
+    }
+}
+
+#ifdef AES_X86
+#define AES_NI_PAR 8 /* blocks in flight */
+
+__attribute__((target("aes,sse4.1"))) static void aes_ctr_ni(rk, rounds, ctr,
+                                                             buf, nblocks)
+const uint8_t *rk;
+unsigned rounds;
+uint64_t ctr;
+uint8_t *buf;
+size_t nblocks;
+{
+    __m128i k[AES_MAXROUNDS + 1], b[AES_NI_PAR];
+    unsigned r, i, n;
+
+    for (r = 0; r <= rounds; r++)
+        k[r] = _mm_loadu_si128((const __m128i *) (rk + 16 * r));
+    for (; nblocks > 0; nblocks -= n, buf += 16 * n) {
+        n = nblocks < AES_NI_PAR ? (unsigned) nblocks : AES_NI_PAR;
+        for (i = 0; i < n; i++)
+            b[i] = _mm_xor_si128(_mm_set_epi64x(0, (long long) ctr++), k[0]);
+        for (r = 1; r < rounds; r++)
+            for (i = 0; i < n; i++)
+                b[i] = _mm_aesenc_si128(b[i], k[r]);
+        for (i = 0; i < n; i++) {
+            __m128i *q = (__m128i *) (buf + 16 * i);
+
+            b[i] = _mm_aesenclast_si128(b[i], k[rounds]);
+            _mm_storeu_si128(q, _mm_xor_si128(_mm_loadu_si128(q), b[i]));
+        }
+    }
+}
+#endif /* AES_X86 */
+
+#ifdef AES_ARM
+static void aes_ctr_arm(rk, rounds, ctr, buf, nblocks)
+const uint8_t *rk;
+unsigned rounds;
+uint64_t ctr;
+uint8_t *buf;
+size_t nblocks;
+{
+    uint8x16_t b;
+    unsigned r;
+
+    for (; nblocks > 0; nblocks--, ctr++, buf += 16) {
+        b = vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(ctr),
+                                              vcreate_u64(0)));
+        for (r = 0; r < rounds - 1; r++)
+            b = vaesmcq_u8(vaeseq_u8(b, vld1q_u8(rk + 16 * r)));
+        b = vaeseq_u8(b, vld1q_u8(rk + 16 * r));
+        b = veorq_u8(b, vld1q_u8(rk + 16 * rounds));
+        vst1q_u8(buf, veorq_u8(vld1q_u8(buf), b));
+    }
+}
+#endif /* AES_ARM */
+
+/*---------------------------------------------------------------------------
+    The interface to crypt.c, fileio.c and extract.c.
+  ---------------------------------------------------------------------------*/
+
+/* Test key against the salt and verifier at h for the current member and,
+   if it fits, set up to decrypt.  Returns 0 if OK, -1 if not. */
+int aes_testkey(h, key)
+const uint8_t *h;
+const char *key;
+{
+    unsigned strength = G.pInfo->aes, saltlen = AES_SALTLEN(strength);
+    unsigned keylen = 8 + 8 * strength;
+    uint8_t dk[2 * 32 + AES_PVLEN];
+    struct aes_ctx *a;
+
+    if (sbox[0] == 0) /* first time through */
+        aes_init_tables();
+    pbkdf2((const uint8_t *) key, strlen(key), h, saltlen, dk,
+           2 * keylen + AES_PVLEN);
+    if (memcmp(dk + 2 * keylen, h + saltlen, AES_PVLEN) != 0)
+        return -1;
+
+    if ((a = G.aes) == NULL)
+        a = G.aes = (struct aes_ctx *) checked_malloc(sizeof(struct aes_ctx));
+    a->rounds = aes_expand(a->rk, dk, keylen);
+    a->ctr = 1;
+    a->kspos = 16;
+    hmac_init(&a->inner, &a->outer, dk + keylen, keylen);
+    return 0;
+}
+
+/* authenticate and decrypt len bytes of the member's data in place */
+void aes_decrypt_buffer(buf, len)
+uint8_t *buf;
+unsigned len;
+{
+    struct aes_ctx *a = G.aes;
+    size_t n;
+
+    sha1_update(&a->inner, buf, len);
+
+    /* the rest of a block begun in the last buffer */
+    for (; a->kspos < 16 && len > 0; len--)
+        *buf++ ^= a->ks[a->kspos++];
+
+    if ((n = len >> 4) > 0) {
+        (*aes_ctr)(a->rk, a->rounds, a->ctr, buf, n);
+        a->ctr += n;
+        buf += 16 * n;
+        len &= 15;
+    }
+    if (len > 0) { /* start a block that the next buffer finishes */
+        memset(a->ks, 0, 16);
+        (*aes_ctr)(a->rk, a->rounds, a->ctr++, a->ks, 1);
+        for (a->kspos = 0; a->kspos < len; a->kspos++)
+            buf[a->kspos] ^= a->ks[a->kspos];
+    }
+}
+
+/* Compare the authentication code at mac with the data decrypted.
+   Returns 0 if they match. */
+int aes_check_mac(mac)
+const uint8_t *mac;
+{
+    uint8_t h[20];
+
+    hmac_final(&G.aes->inner, &G.aes->outer, h);
+    return memcmp(h, mac, AES_MACLEN) != 0;
+}
@@ -0,0 +1,24 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* aescrypt.h -- WinZip AES decryption (see aescrypt.c) */
+
+#ifndef __aescrypt_h /* don't include more than once */
+#define __aescrypt_h
+
+#define AES_SALTLEN(s) (4 + 4 * (s)) /* salt for strength 1, 2 or 3 */
+#define AES_PVLEN      2             /* password verifier */
+#define AES_MACLEN     10            /* authentication code */
+#define AES_HEADMAX    (AES_SALTLEN(3) + AES_PVLEN)
+
+/* bytes of a member's data that are not encrypted data */
+#define AES_OVERHEAD(s) (AES_SALTLEN(s) + AES_PVLEN + AES_MACLEN)
+
+int aes_testkey(const uint8_t *h, const char *key);
+void aes_decrypt_buffer(uint8_t *buf, unsigned len);
+int aes_check_mac(const uint8_t *mac);
+
+#endif /* !__aescrypt_h */
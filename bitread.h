@@ -0,0 +1,126 @@
+/*
+  Copyright (c) 1990-2008 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2000-Apr-09 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* bitread.h -- the bit reader shared by explode and unshrink
+
+   Both read their compressed stream least significant bit first
+   through the same pair of macros:
+
+        NEEDBITS(j);
+        x = b & mask_bits[j];
+        DUMPBITS(j);
+
+   where NEEDBITS makes sure that b has at least j bits in it, and
+   DUMPBITS removes the bits from b.  b (a bitbuf_t) and k (an unsigned
+   count of the bits in b) are local variables of the decoder, so they can
+   live in registers.  inflate.c, which has to stop and go on wherever
+   its input runs out, keeps them in its state between calls and reads
+   with a macro of its own, but it uses the same bit buffer.
+
+   b is 64 bits wide.  When it runs short, NEEDBITS tops it up to at least
+   57 bits, so j may be anything up to 56.  While at least eight bytes are
+   left in the input buffer this takes one unaligned load and no per-byte
+   tests (on little-endian machines); bits of the next byte that land
+   above k are simply loaded again on the next refill.  Otherwise the
+   bytes are fetched one at a time with NEXTBYTE.
+
+   The end of the input is handled the same way for every decoder, the
+   way inflate always did it (and still does):  NEEDBITS stops filling b, whose upper bits
+   are zero, so a decoder may look at bits past the end.  If it uses some
+   of them, k goes negative (BITS_PAST_END).  That is tolerated as long as
+   the decoder needs no further input (the last code of a stream may be
+   decoded with a longer lookup than its length); if NEEDBITS has to ask
+   for more, it runs the statement BITS_OVERRUN, which the decoder
+   defines.  BITS_UNUSED is the number of input bytes left over, negative
+   if the decoder ran past the end.
+
+   BITS_LOW(x, n) is the low n bits of x, for n up to 16.  On x86-64 the
+   inner loops of inflate and explode are built twice, the second time
+   for CPUs with BMI2 (BITS_BMI2, unless NO_BMI2 is defined), where
+   BITS_LOW_BMI2 is a single BZHI instead of a mask_bits[] load, and the
+   shifts by k and by code lengths are SHLX/SHRX.  have_bmi2() (in
+   inflate.c) tells which to use.
+ */
+
+#ifndef __bitread_h
+#define __bitread_h
+
+typedef uint64_t bitbuf_t;
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define BITS_LOAD64 /* refill with one unaligned 64-bit load */
+#endif
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(NO_BMI2)
+#define BITS_BMI2
+#include <immintrin.h>
+#endif
+
+#define BITS_INIT()      \
+    do {                 \
+        b = 0;           \
+        k = 0;           \
+        G.biteofs = 0;   \
+    } while (0)
+
+#define BITS_PAST_END ((int) k < 0)
+
+/* readbyte() counts each EOF it returns against G.csize */
+#define BITS_UNUSED \
+    (G.csize + G.biteofs + G.incnt + ((int) k >> 3))
+
+#ifdef BITS_LOAD64
+#define BITS_REFILL_FAST()                         \
+    if (G.incnt >= 8) {                            \
+        bitbuf_t v_;                               \
+                                                   \
+        memcpy(&v_, G.inptr, 8);                   \
+        b |= v_ << k;                              \
+        G.inptr += (63 - k) >> 3;                  \
+        G.incnt -= (int) ((63 - k) >> 3);          \
+        k |= 56; /* k + 8 * (bytes added) */       \
+    } else
+#else
+#define BITS_REFILL_FAST()
+#endif
+
+#define NEEDBITS(n)                                \
+    do {                                           \
+        if ((int) k < (int) (n)) {                 \
+            BITS_REFILL_FAST()                     \
+            do {                                   \
+                int c_ = NEXTBYTE;                 \
+                                                   \
+                if (c_ == EOF) {                   \
+                    G.biteofs++;                   \
+                    if (BITS_PAST_END)             \
+                        BITS_OVERRUN;              \
+                    break;                         \
+                }                                  \
+                b |= (bitbuf_t) c_ << k;           \
+                k += 8;                            \
+            } while (k <= 56);                     \
+        }                                          \
+    } while (0)
+
+#define DUMPBITS(n)  \
+    do {             \
+        b >>= (n);   \
+        k -= (n);    \
+    } while (0)
+
+#define BITS_LOW(x, n) ((unsigned) (x) & mask_bits[n])
+
+#ifdef BITS_BMI2
+#define BITS_LOW_BMI2(x, n) _bzhi_u32((unsigned) (x), (unsigned) (n))
+#define BITS_TARGET_BMI2    __attribute__((target("bmi2")))
+
+int have_bmi2(void); /* inflate.c */
+#endif
+
+#endif /* !__bitread_h */
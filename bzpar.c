@@ -0,0 +1,497 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* bzpar.c -- decode the blocks of a bzip2 member on several threads
+
+   A bzip2 stream is a four-byte header ("BZh" and the block size level),
+   a series of blocks, each starting with the 48-bit magic 0x314159265359
+   and the block's CRC, and an end marker 0x177245385090 followed by the
+   combined CRC of all blocks.  Blocks are not byte-aligned, but each one
+   can be decoded on its own.  UZbunzip2_par() finds the magics with a
+   bit-level scan, makes every block into a stream of its own (header, the
+   block's bits shifted to a byte boundary, end marker, and the block's CRC
+   as the combined one) and hands those to a pool of threads running
+   libbz2.  The results are passed to G.flush in order, and the block CRCs
+   are combined and checked against the one at the end of the stream, as
+   libbz2 does it for a whole stream.
+
+   The magic can also turn up by chance inside a block.  The "block" that
+   ends there then fails to decode, and it is tried again together with
+   the one after it, at most BZ_RETRIES times:  a block that still fails
+   is bad data, not a false magic.  So can the end marker, which is taken
+   for a block magic until the end of the member's data shows that it was
+   the last one; the combined CRC after it is then checked too.
+ */
+
+#define __BZPAR_C /* identifies this source module */
+#include "unzip.h"
+
+#ifdef USE_PIPELINE
+
+#include <pthread.h>
+
+#ifndef BZ_MAXTHREADS
+#define BZ_MAXTHREADS 16 /* most worker threads started */
+#endif
+#define BZPARMIN       0x100000L /* smallest member worth the threads */
+#define BZ_RETRIES     2 /* most blocks appended to one that fails */
+#define BZ_BLOCK_MAGIC 0x314159265359ULL
+#define BZ_EOS_MAGIC   0x177245385090ULL
+#define BZ_MAGIC_MASK  0xffffffffffffULL
+
+typedef struct bzjob {
+    uint8_t *in;      /* the block as a stream of its own */
+    size_t inlen;
+    uint8_t *out;     /* the decoded block */
+    size_t outlen;
+    size_t outsize;   /* bytes allocated at out */
+    int err;          /* 0, or 2 (bad data) or 3 (no memory) */
+    int done;         /* decoded (protected by the pool lock) */
+} bzjob;
+
+struct bzpar {
+    uint8_t *buf;     /* compressed data, from stream byte bufoff on */
+    size_t len;       /* bytes in buf */
+    size_t size;      /* bytes allocated at buf */
+    uint64_t bufoff;
+    uint64_t scanned; /* stream bytes looked at by bz_scan() */
+    uint64_t reg;     /* the last 64 bits of them */
+    uint64_t *bnd;    /* bit offsets of block bnd0, bnd0 + 1, ... */
+    unsigned long bnd0;
+    unsigned long nbnd;
+    unsigned long bndsize;
+    int endmark;      /* bnd[nbnd - 1] looks like the end marker */
+    int eos;          /* and no magic follows it in the member's data */
+    int level;        /* block size character of the header */
+
+    /* the pool:  job[n % nslot] is block n */
+    bzjob job[2 * BZ_MAXTHREADS];
+    unsigned nslot;
+    unsigned long queued; /* blocks handed to the pool */
+    unsigned long taken;  /* blocks taken by a worker */
+    int quit;
+    pthread_mutex_t lock;
+    pthread_cond_t work;  /* queued or quit changed */
+    pthread_cond_t done;  /* a job is done */
+    pthread_t thread[BZ_MAXTHREADS];
+    int nthread;
+};
+
+#define BND(P, n)    ((P)->bnd[(n) - (P)->bnd0])
+#define IS_EOS(P, n) ((P)->eos && (n) + 1 == (P)->bnd0 + (P)->nbnd)
+
+/* bzhint[c] has bit s set if a magic can end s bits before the end of the
+   byte that follows c */
+static uint8_t bzhint[256];
+static int bzhint_done = FALSE;
+
+static void bz_hints(void);
+static int bz_more(struct bzpar *P);
+static int bz_scan(struct bzpar *P);
+static int bz_bound(struct bzpar *P, unsigned long n);
+static uint32_t bz_bits(struct bzpar *P, uint64_t pos, int n);
+static int bz_make(struct bzpar *P, bzjob *j, uint64_t a, uint64_t b);
+static void bz_decode(bzjob *j);
+static void *bz_worker(void *arg);
+static void bz_wait(struct bzpar *P, bzjob *j);
+static int bz_run(struct bzpar *P);
+
+static void bz_hints()
+{
+    static const uint64_t magic[2] = {BZ_BLOCK_MAGIC, BZ_EOS_MAGIC};
+    int i, s;
+
+    for (i = 0; i < 2; i++)
+        for (s = 0; s < 8; s++)
+            bzhint[(uint8_t) ((magic[i] << s) >> 8)] |= 1 << s;
+    bzhint_done = TRUE;
+}
+
+/* append the rest of G.inbuf (refilling it first if need be) to buf;
+   returns 0, or 2 if the member has no more data, or 3 */
+static int bz_more(P)
+struct bzpar *P;
+{
+    size_t keep, drop;
+    uint8_t *p;
+
+    if (G.incnt <= 0 && (G.csize <= 0 || fillinbuf() == 0))
+        return 2;
+
+    /* forget the data before the oldest block still needed */
+    keep = P->nbnd ? (size_t) ((P->bnd[0] >> 3) - P->bufoff) : 0;
+    drop = MIN(keep, (size_t) (P->scanned - P->bufoff));
+    if (drop > P->len / 2) {
+        memmove(P->buf, P->buf + drop, P->len - drop);
+        P->len -= drop;
+        P->bufoff += drop;
+    }
+    if (P->len + (size_t) G.incnt > P->size) {
+        size_t size = MAX(2 * P->size, P->len + (size_t) G.incnt);
+
+        if ((p = (uint8_t *) realloc(P->buf, size)) == NULL)
+            return 3;
+        P->buf = p;
+        P->size = size;
+    }
+    memcpy(P->buf + P->len, G.inptr, G.incnt);
+    P->len += G.incnt;
+    G.inptr += G.incnt;
+    G.incnt = 0;
+    return 0;
+}
+
+/* find the next block magic or the end marker; returns as bz_more() */
+static int bz_scan(P)
+struct bzpar *P;
+{
+    uint64_t pos, m;
+    unsigned h;
+    int s, found, r;
+
+    for (;;) {
+        for (found = FALSE; !found && P->scanned < P->bufoff + P->len;) {
+            P->reg = (P->reg << 8) | P->buf[P->scanned++ - P->bufoff];
+            if ((h = bzhint[(P->reg >> 8) & 0xff]) == 0)
+                continue;
+            for (s = 8; s-- > 0;) { /* lowest bit offset first */
+                if (!(h & (1 << s)))
+                    continue;
+                m = (P->reg >> s) & BZ_MAGIC_MASK;
+                if (m != BZ_BLOCK_MAGIC && m != BZ_EOS_MAGIC)
+                    continue;
+                if (8 * (P->scanned - 1) < (uint64_t) s + 40 + 32)
+                    continue; /* in the header */
+                pos = 8 * (P->scanned - 1) - s - 40;
+                if (P->nbnd == P->bndsize) {
+                    unsigned long n = P->bndsize ? 2 * P->bndsize : 64;
+                    uint64_t *q;
+
+                    q = (uint64_t *) realloc(P->bnd, n * sizeof(uint64_t));
+                    if (q == NULL)
+                        return 3;
+                    P->bnd = q;
+                    P->bndsize = n;
+                }
+                P->bnd[P->nbnd++] = pos;
+                P->endmark = m == BZ_EOS_MAGIC;
+                found = TRUE;
+            }
+        }
+        if (found)
+            return 0;
+        if ((r = bz_more(P)) != 0) {
+            if (r == 2 && P->endmark) { /* it was the end marker */
+                P->eos = TRUE;
+                return 0;
+            }
+            return r;
+        }
+    }
+}
+
+/* make sure the offset of block n (or the end marker before it) is known */
+static int bz_bound(P, n)
+struct bzpar *P;
+unsigned long n;
+{
+    int r;
+
+    while (P->bnd0 + P->nbnd <= n && !P->eos)
+        if ((r = bz_scan(P)) != 0)
+            return r;
+    return 0;
+}
+
+/* the n (up to 32) bits of the stream at bit offset pos */
+static uint32_t bz_bits(P, pos, n)
+struct bzpar *P;
+uint64_t pos;
+int n;
+{
+    uint32_t v = 0;
+
+    for (; n--; pos++)
+        v = (v << 1) |
+            ((P->buf[(pos >> 3) - P->bufoff] >> (7 - (pos & 7))) & 1);
+    return v;
+}
+
+/* set up j to decode the stream bits a to b as a stream of their own */
+static int bz_make(P, j, a, b)
+struct bzpar *P;
+bzjob *j;
+uint64_t a, b;
+{
+    uint64_t nbits = b - a;
+    size_t nbytes = (size_t) ((nbits + 7) >> 3);
+    const uint8_t *src = P->buf + ((a >> 3) - P->bufoff);
+    unsigned sh = (unsigned) (a & 7);
+    uint32_t crc = bz_bits(P, a + 48, 32);
+    uint64_t tail;
+    uint8_t *p;
+    size_t i;
+    int n;
+
+    j->inlen = 4 + (size_t) ((nbits + 48 + 32 + 7) >> 3);
+    if ((p = j->in = (uint8_t *) malloc(j->inlen)) == NULL)
+        return 3;
+    p[0] = 'B';
+    p[1] = 'Z';
+    p[2] = 'h';
+    p[3] = (uint8_t) P->level;
+
+    /* the magic after b has been scanned, so src[nbytes] is there */
+    for (i = 0; i < nbytes; i++)
+        p[4 + i] = (uint8_t) ((src[i] << sh) | (src[i + 1] >> (8 - sh)));
+    if (nbits & 7)
+        p[3 + nbytes] &= (uint8_t) (0xff << (8 - (nbits & 7)));
+    memzero(p + 4 + nbytes, j->inlen - 4 - nbytes);
+
+    /* end marker, and the block CRC as the combined one */
+    tail = 32 + nbits;
+    for (n = 48; n--; tail++)
+        if ((BZ_EOS_MAGIC >> n) & 1)
+            p[tail >> 3] |= 0x80 >> (tail & 7);
+    for (n = 32; n--; tail++)
+        if ((crc >> n) & 1)
+            p[tail >> 3] |= 0x80 >> (tail & 7);
+    j->outlen = 0;
+    j->err = 0;
+    return 0;
+}
+
+static void bz_decode(j)
+bzjob *j;
+{
+    bz_stream bstrm;
+    uint8_t *p;
+    int err;
+
+    memzero(&bstrm, sizeof(bstrm));
+    if (BZ2_bzDecompressInit(&bstrm, 0, 0) != BZ_OK) {
+        j->err = 3;
+        return;
+    }
+    bstrm.next_in = (char *) j->in;
+    bstrm.avail_in = (unsigned) j->inlen;
+    for (j->err = 0;;) {
+        if (j->outlen == j->outsize) {
+            size_t size = j->outsize ? 2 * j->outsize : 0x100000;
+
+            if ((p = (uint8_t *) realloc(j->out, size)) == NULL) {
+                j->err = 3;
+                break;
+            }
+            j->out = p;
+            j->outsize = size;
+        }
+        bstrm.next_out = (char *) (j->out + j->outlen);
+        bstrm.avail_out = (unsigned) (j->outsize - j->outlen);
+        err = BZ2_bzDecompress(&bstrm);
+        j->outlen = j->outsize - bstrm.avail_out;
+        if (err == BZ_STREAM_END)
+            break;
+        if (err == BZ_MEM_ERROR) {
+            j->err = 3;
+            break;
+        }
+        if (err != BZ_OK || (bstrm.avail_in == 0 && bstrm.avail_out > 0)) {
+            j->err = 2;
+            break;
+        }
+    }
+    BZ2_bzDecompressEnd(&bstrm);
+    free(j->in);
+    j->in = NULL;
+}
+
+static void *bz_worker(arg)
+void *arg;
+{
+    struct bzpar *P = (struct bzpar *) arg;
+    bzjob *j;
+
+    for (;;) {
+        pthread_mutex_lock(&P->lock);
+        while (P->taken == P->queued && !P->quit)
+            pthread_cond_wait(&P->work, &P->lock);
+        if (P->quit) {
+            pthread_mutex_unlock(&P->lock);
+            break;
+        }
+        j = &P->job[P->taken++ % P->nslot];
+        pthread_mutex_unlock(&P->lock);
+
+        bz_decode(j);
+
+        pthread_mutex_lock(&P->lock);
+        j->done = TRUE;
+        pthread_cond_broadcast(&P->done);
+        pthread_mutex_unlock(&P->lock);
+    }
+    return NULL;
+}
+
+static void bz_wait(P, j)
+struct bzpar *P;
+bzjob *j;
+{
+    pthread_mutex_lock(&P->lock);
+    while (!j->done)
+        pthread_cond_wait(&P->done, &P->lock);
+    pthread_mutex_unlock(&P->lock);
+}
+
+/* returns as UZbunzip2() */
+static int bz_run(P)
+struct bzpar *P;
+{
+    unsigned long ret = 0;  /* next block to write out */
+    unsigned long next = 0; /* next block to hand out */
+    unsigned long e, n;
+    uint32_t crc = 0;
+    uint8_t *p;
+    size_t left, m;
+    bzjob *j;
+    int r;
+
+    for (;;) {
+        /* keep the pool busy */
+        while (next - ret < P->nslot) {
+            if ((r = bz_bound(P, next + 1)) != 0)
+                return r;
+            if (IS_EOS(P, next))
+                break;
+            j = &P->job[next % P->nslot];
+            if ((r = bz_make(P, j, BND(P, next), BND(P, next + 1))) != 0)
+                return r;
+            pthread_mutex_lock(&P->lock);
+            j->done = FALSE;
+            P->queued = ++next;
+            pthread_cond_signal(&P->work);
+            pthread_mutex_unlock(&P->lock);
+        }
+        if (ret == next) /* only the end marker is left */
+            break;
+
+        j = &P->job[ret % P->nslot];
+        bz_wait(P, j);
+        e = ret; /* last block that is part of this one */
+        while (j->err == 2) {
+            /* a false magic?  try again with the next block appended */
+            if (e - ret == BZ_RETRIES)
+                return 2;
+            if ((r = bz_bound(P, ++e + 1)) != 0)
+                return r;
+            if (IS_EOS(P, e))
+                return 2;
+            Trace((stderr, "bzip2 block %lu retried up to %lu\n", ret, e));
+            if ((r = bz_make(P, j, BND(P, ret), BND(P, e + 1))) != 0)
+                return r;
+            bz_decode(j);
+        }
+        if (j->err)
+            return j->err;
+        if (e > ret) {
+            /* wait for the blocks that went in, before reusing their
+               jobs; if that was all of them, the pool is idle now */
+            for (n = ret + 1; n <= e && n < next; n++)
+                bz_wait(P, &P->job[n % P->nslot]);
+            if (next <= e) {
+                pthread_mutex_lock(&P->lock);
+                P->queued = P->taken = next = e + 1;
+                pthread_mutex_unlock(&P->lock);
+            }
+        }
+
+        crc = ((crc << 1) | (crc >> 31)) ^ bz_bits(P, BND(P, ret) + 48, 32);
+        for (p = j->out, left = j->outlen; left > 0; p += m, left -= m) {
+            m = MIN(left, WSIZE);
+            if ((r = (*G.flush)(p, (uint32_t) m)) != 0)
+                return r;
+        }
+
+        /* forget the offsets of the blocks written out */
+        ret = e + 1;
+        n = ret - P->bnd0;
+        memmove(P->bnd, P->bnd + n, (P->nbnd - n) * sizeof(uint64_t));
+        P->nbnd -= n;
+        P->bnd0 = ret;
+    }
+
+    /* the end marker is followed by the combined CRC */
+    while ((P->bufoff + P->len) * 8 < BND(P, ret) + 48 + 32)
+        if ((r = bz_more(P)) != 0)
+            return r;
+    if (bz_bits(P, BND(P, ret) + 48, 32) != crc) {
+        Trace((stderr, "bzip2 combined CRC mismatch\n"));
+        return 2;
+    }
+    return 0;
+}
+
+/* Decompress the current bzip2 member on several threads.  Returns -1,
+   without having used any input, if the member is too small or its size
+   is not known (in a stream), does not start the way bz_scan() expects
+   (leaving the error to UZbunzip2()) or there is only one processor;
+   otherwise as UZbunzip2(). */
+int UZbunzip2_par()
+{
+    struct bzpar *P;
+    long ncpu;
+    unsigned i;
+    int r;
+
+    if (G.csize + G.incnt < BZPARMIN || G.streamlost || G.incnt < 10 ||
+        memcmp(G.inptr, "BZh", 3) != 0 || G.inptr[3] < '1' ||
+        G.inptr[3] > '9' || memcmp(G.inptr + 4, "1AY&SY", 6) != 0)
+        return -1;
+    if ((ncpu = sysconf(_SC_NPROCESSORS_ONLN)) < 2)
+        return -1;
+    if ((P = (struct bzpar *) calloc(1, sizeof(struct bzpar))) == NULL)
+        return -1;
+    if (!bzhint_done)
+        bz_hints();
+
+    pthread_mutex_init(&P->lock, NULL);
+    pthread_cond_init(&P->work, NULL);
+    pthread_cond_init(&P->done, NULL);
+    for (i = 0; i < (unsigned) MIN(ncpu, BZ_MAXTHREADS); i++) {
+        if (pthread_create(&P->thread[i], NULL, bz_worker, P) != 0)
+            break;
+        P->nthread++;
+    }
+    if (P->nthread > 0) {
+        P->nslot = 2 * P->nthread;
+        P->level = G.inptr[3];
+        r = bz_run(P);
+
+        pthread_mutex_lock(&P->lock);
+        P->quit = TRUE;
+        pthread_cond_broadcast(&P->work);
+        pthread_mutex_unlock(&P->lock);
+        for (i = 0; i < (unsigned) P->nthread; i++)
+            pthread_join(P->thread[i], NULL);
+        for (i = 0; i < P->nslot; i++) {
+            free(P->job[i].in);
+            free(P->job[i].out);
+        }
+        G.inptr += G.incnt; /* the rest of the member is not needed */
+        G.incnt = 0;
+    } else
+        r = -1;
+
+    pthread_cond_destroy(&P->done);
+    pthread_cond_destroy(&P->work);
+    pthread_mutex_destroy(&P->lock);
+    free(P->buf);
+    free(P->bnd);
+    free(P);
+    return r;
+}
+
+#endif /* USE_PIPELINE */
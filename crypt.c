@@ -28,6 +28,7 @@
 #define ZCRYPT_INTERNAL
 #include "unzip.h"
 #include "crypt.h"
+#include "aescrypt.h"
 #include "ttyio.h"
 
 #ifndef FALSE
@@ -72,6 +73,81 @@ int c; /* byte of plain text */
     return c;
 }
 
+/***********************************************************************
+ * Decrypt len bytes at buf in place, updating keys.  This is zdecode()
+ * for a whole buffer:  the keys stay in registers for the length of it
+ * rather than going through G.keys twice a byte, the CRC table is the
+ * plain byte-at-a-time one (the first 256 entries of crc_table in
+ * crc32.c), used directly instead of through G.crc_32_tab, and the loop
+ * is unrolled four times.  Part of the multiply for key 1 is done while
+ * key 0 is being looked up, since the bytes are decrypted strictly one
+ * after another anyway.
+ */
+#define DECRYPT_STEP(i)                                              \
+    t = (k2 & 0xffff) | 2;                                           \
+    c = buf[i] ^ (uint8_t) ((t * (t ^ 1)) >> 8);                     \
+    buf[i] = (uint8_t) c;                                            \
+    m = k1 * 134775813U + 1;                                         \
+    k0 = tab[(k0 ^ c) & 0xff] ^ (k0 >> 8);                           \
+    k1 = m + (k0 & 0xff) * 134775813U;                               \
+    k2 = tab[(k2 ^ (k1 >> 24)) & 0xff] ^ (k2 >> 8)
+
+void decrypt_buffer(keys, buf, len)
+uint32_t *keys;
+uint8_t *buf;
+size_t len;
+{
+    const uint32_t *tab = get_crc_table();
+    uint32_t k0 = keys[0], k1 = keys[1], k2 = keys[2];
+    uint32_t t, c, m;
+
+    for (; len >= 4; len -= 4, buf += 4) {
+        DECRYPT_STEP(0);
+        DECRYPT_STEP(1);
+        DECRYPT_STEP(2);
+        DECRYPT_STEP(3);
+    }
+    for (; len > 0; len--, buf++) {
+        DECRYPT_STEP(0);
+    }
+    keys[0] = k0;
+    keys[1] = k1;
+    keys[2] = k2;
+}
+
+/***********************************************************************
+ * Decrypt the n bytes of input at G.inptr in place.  In a stream, where
+ * only its method can tell where the data of a member end, this may go
+ * past them into what follows:  keep that as it was, for restore_input().
+ */
+void decrypt_input(n)
+unsigned n;
+{
+    if (G.streamlost) {
+        if (G.cryptsave == NULL)
+            G.cryptsave = checked_malloc(INBUFSIZ);
+        G.cryptfrom = G.inptr;
+        G.cryptlen = n;
+        memcpy(G.cryptsave, G.inptr, n);
+    }
+    decrypt_buffer(G.keys, G.inptr, (size_t) n);
+}
+
+/***********************************************************************
+ * Once the method has found the end of the data, put back the input
+ * after it as decrypt_input() found it.
+ */
+void restore_input()
+{
+    size_t off;
+
+    if (G.cryptfrom != NULL && G.incnt > 0 && G.inptr >= G.cryptfrom &&
+        (off = (size_t) (G.inptr - G.cryptfrom)) + (unsigned) G.incnt <=
+            G.cryptlen)
+        memcpy(G.inptr, G.cryptsave + off, (size_t) G.incnt);
+    G.cryptfrom = NULL;
+}
+
 /***********************************************************************
  * Initialize the encryption keys and the random header according to
  * the given password.
@@ -106,7 +182,9 @@ int decrypt(passwrd) const char *passwrd;
 {
     uint16_t b;
     int n, r;
-    uint8_t h[RAND_HEAD_LEN];
+    uint8_t h[AES_HEADMAX]; /* RAND_HEAD_LEN, or WinZip AES salt and PV */
+    int hlen = G.pInfo->aes ? AES_SALTLEN(G.pInfo->aes) + AES_PVLEN
+                            : RAND_HEAD_LEN;
 
     Trace((stdout, "\n[incnt = %d]: ", G.incnt));
 
@@ -114,7 +192,7 @@ int decrypt(passwrd) const char *passwrd;
      * try to decrypt the same data twice) */
     G.pInfo->encrypted = FALSE;
     defer_leftover_input();
-    for (n = 0; n < RAND_HEAD_LEN; n++) {
+    for (n = 0; n < hlen; n++) {
         /* 2012-11-23 SMS.  (OUSPG report.)
          * Quit early if compressed size < HEAD_LEN.  The resulting
          * error message ("unable to get password") could be improved,
@@ -231,9 +309,18 @@ const char *key;                             /* decryption password to test */
     uint16_t c;
 #endif
     int n;
-    uint8_t *p;
     uint8_t hh[RAND_HEAD_LEN]; /* decrypted header */
 
+    if (G.pInfo->aes) { /* WinZip AES:  see aescrypt.c */
+        if (aes_testkey(h, key) != 0)
+            return -1; /* bad */
+        /* password OK:  decrypt current buffer contents before leaving */
+        n = (long) G.incnt > G.csize ? (int) G.csize : G.incnt;
+        if (n > 0)
+            aes_decrypt_buffer(G.inptr, (unsigned) n);
+        return 0; /* OK */
+    }
+
     /* set keys and save the encrypted header */
     init_keys(key);
     memcpy(hh, h, RAND_HEAD_LEN);
@@ -273,8 +360,8 @@ const char *key;                             /* decryption password to test */
         return -1; /* bad */
 #endif
     /* password OK:  decrypt current buffer contents before leaving */
-    for (n = (long) G.incnt > G.csize ? (int) G.csize : G.incnt, p = G.inptr;
-         n--; p++)
-        zdecode(*p);
+    n = (long) G.incnt > G.csize ? (int) G.csize : G.incnt;
+    if (n > 0)
+        decrypt_input((unsigned) n);
     return 0; /* OK */
 }
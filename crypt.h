@@ -26,7 +26,10 @@
 
 int decrypt_byte(void);
 int update_keys(int c);
+void decrypt_buffer(uint32_t *keys, uint8_t *buf, size_t len);
 void init_keys(const char *passwd);
+void decrypt_input(unsigned n);
+void restore_input(void);
 
 int decrypt(const char *passwrd);
 
@@ -0,0 +1,200 @@
+/*
+  Copyright (c) 1990-2007 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2007-Mar-04 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* expblock.h -- the decoding loops of explode.c
+
+   explode.c includes this with BMI2 defined as 0, for explode_lit() and
+   explode_nolit(), and with BITS_BMI2 (see bitread.h) once more with BMI2
+   as 1, for explode_lit_bmi2() and explode_nolit_bmi2():  the same loops,
+   built for CPUs with BMI2. */
+
+#if BMI2
+#define EXPL(f)  f##_bmi2
+#define LOWBITS  BITS_LOW_BMI2
+#define TARGET   BITS_TARGET_BMI2
+#else
+#define EXPL(f)  f
+#define LOWBITS  BITS_LOW
+#define TARGET
+#endif
+
+TARGET static int EXPL(explode_lit)(struct huft *tf, struct huft *tl,
+                                    struct huft *td, unsigned bf,
+                                    unsigned bl, unsigned bd, unsigned bdl);
+TARGET static int EXPL(explode_nolit)(struct huft *tl, struct huft *td,
+                                      unsigned bl, unsigned bd,
+                                      unsigned bdl);
+
+/* Decompress the imploded data using coded literals and a sliding
+   window (of size 2^(6+bdl) bytes). */
+TARGET static int EXPL(explode_lit)(tf, tl, td, bf, bl, bd, bdl)
+struct huft *tf, *tl, *td; /* flag+literal, length, and distance tables */
+unsigned bf, bl, bd;       /* number of bits decoded by those */
+unsigned bdl;              /* number of distance low bits */
+{
+    uint64_t s;          /* bytes to decompress */
+    register unsigned e; /* table entry flag/number of extra bits */
+    unsigned n, d;       /* length and index for copy */
+    unsigned w;          /* current window position */
+    struct huft *t;      /* pointer to table entry */
+    unsigned mf, ml, md; /* masks for bf, bl, and bd bits */
+    unsigned mdl;        /* mask for bdl (distance lower) bits */
+    register bitbuf_t b; /* bit buffer */
+    register unsigned k; /* number of bits in bit buffer */
+    unsigned u;          /* true if unflushed */
+    uint8_t *out;        /* start of pending output in the window */
+    unsigned wend;       /* flush point */
+    int retval = 0;      /* error code returned: initialized to "no error" */
+
+    /* explode the coded data */
+    BITS_INIT();        /* initialize bit buffer */
+    w = 0;              /* initialize window */
+    u = 1;              /* buffer unflushed */
+    if (G.ring != NULL) /* mirrored window:  zeroes stand in for u */
+        memzero(G.ring + RINGSIZ - WSIZE, WSIZE);
+    G.wf = 0;
+    out = WINDOW;
+    wend = WINDOWEND;
+    mf = mask_bits[bf]; /* precompute masks for speed */
+    ml = mask_bits[bl];
+    md = mask_bits[bd];
+    mdl = mask_bits[bdl];
+    s = G.lrec.ucsize;
+    while (s > 0) /* do until ucsize bytes uncompressed */
+    {
+        NEEDBITS(bf); /* literal flag and (most) literals in one go */
+        t = tf + ((unsigned) b & mf);
+        HUFTCODE();
+        if (e) {
+            /* literal */
+            s--;
+            out[w++] = (uint8_t) t->v.n;
+            if (w == wend) {
+                if ((retval = flush_window(w)) != 0)
+                    return retval;
+                out = WINDOW;
+                w = u = 0;
+            }
+        } else {
+            /* else distance/length */
+            NEEDBITS(bdl); /* get distance low bits */
+            d = (unsigned) b & mdl;
+            DUMPBITS(bdl);
+            DECODEHUFT(td, bd, md); /* get coded distance high bits */
+            d += t->v.n;            /* construct distance */
+            DECODEHUFT(tl, bl, ml); /* get coded length */
+            n = t->v.n;
+            if (e) {
+                /* get length extra bits */
+                NEEDBITS(8);
+                n += (unsigned) b & 0xff;
+                DUMPBITS(8);
+            }
+
+            /* do the copy */
+            s = (s > (uint64_t) n ? s - (uint64_t) n : 0);
+            COPYMATCH();
+        }
+    }
+
+past_end:
+    /* flush out the window */
+    if ((retval = flush_window(w)) != 0)
+        return retval;
+    if (BITS_UNUSED) {
+        /* should have used exactly csize bytes */
+        G.used_csize = G.lrec.csize - BITS_UNUSED;
+        return 5;
+    }
+    return 0;
+}
+
+/* Decompress the imploded data using uncoded literals and a sliding
+   window (of size 2^(6+bdl) bytes). */
+TARGET static int EXPL(explode_nolit)(tl, td, bl, bd, bdl)
+struct huft *tl, *td; /* length and distance decoder tables */
+unsigned bl, bd;      /* number of bits decoded by tl[] and td[] */
+unsigned bdl;         /* number of distance low bits */
+{
+    uint64_t s;          /* bytes to decompress */
+    register unsigned e; /* table entry flag/number of extra bits */
+    unsigned n, d;       /* length and index for copy */
+    unsigned w;          /* current window position */
+    struct huft *t;      /* pointer to table entry */
+    unsigned ml, md;     /* masks for bl and bd bits */
+    unsigned mdl;        /* mask for bdl (distance lower) bits */
+    register bitbuf_t b; /* bit buffer */
+    register unsigned k; /* number of bits in bit buffer */
+    unsigned u;          /* true if unflushed */
+    uint8_t *out;        /* start of pending output in the window */
+    unsigned wend;       /* flush point */
+    int retval = 0;      /* error code returned: initialized to "no error" */
+
+    /* explode the coded data */
+    BITS_INIT();        /* initialize bit buffer */
+    w = 0;              /* initialize window */
+    u = 1;              /* buffer unflushed */
+    if (G.ring != NULL) /* mirrored window:  zeroes stand in for u */
+        memzero(G.ring + RINGSIZ - WSIZE, WSIZE);
+    G.wf = 0;
+    out = WINDOW;
+    wend = WINDOWEND;
+    ml = mask_bits[bl]; /* precompute masks for speed */
+    md = mask_bits[bd];
+    mdl = mask_bits[bdl];
+    s = G.lrec.ucsize;
+    while (s > 0) {
+        /* do until ucsize bytes uncompressed */
+        NEEDBITS(9); /* literal flag and literal in one go */
+        if (b & 1) {
+            /* then literal--eight bits after the flag */
+            s--;
+            out[w++] = (uint8_t) (b >> 1);
+            DUMPBITS(9);
+            if (w == wend) {
+                if ((retval = flush_window(w)) != 0)
+                    return retval;
+                out = WINDOW;
+                w = u = 0;
+            }
+        } else {
+            /* else distance/length */
+            DUMPBITS(1);
+            NEEDBITS(bdl); /* get distance low bits */
+            d = (unsigned) b & mdl;
+            DUMPBITS(bdl);
+            DECODEHUFT(td, bd, md); /* get coded distance high bits */
+            d += t->v.n;            /* construct distance */
+            DECODEHUFT(tl, bl, ml); /* get coded length */
+            n = t->v.n;
+            if (e) {
+                /* get length extra bits */
+                NEEDBITS(8);
+                n += (unsigned) b & 0xff;
+                DUMPBITS(8);
+            }
+
+            /* do the copy */
+            s = (s > (uint64_t) n ? s - (uint64_t) n : 0);
+            COPYMATCH();
+        }
+    }
+
+past_end:
+    /* flush out the window */
+    if ((retval = flush_window(w)) != 0)
+        return retval;
+    if (BITS_UNUSED) {
+        /* should have used exactly csize bytes */
+        G.used_csize = G.lrec.csize - BITS_UNUSED;
+        return 5;
+    }
+    return 0;
+}
+
+#undef EXPL
+#undef LOWBITS
+#undef TARGET
@@ -100,6 +100,7 @@
  */
 
 #include "unzip.h" /* must supply slide[] (uint8_t) array and NEXTBYTE macro */
+#include "bitread.h"
 
 #ifndef WSIZE
 #define WSIZE 0x8000 /* window size--must be a power of two, and */
@@ -109,11 +110,12 @@
 
 /* routines here */
 static int get_tree(unsigned *l, unsigned n);
-static int explode_lit(struct huft *tb, struct huft *tl, struct huft *td,
-                       unsigned bb, unsigned bl, unsigned bd, unsigned bdl);
-static int explode_nolit(struct huft *tl, struct huft *td, unsigned bl,
-                         unsigned bd, unsigned bdl);
+static int get_table(struct xtree *x, unsigned *l, unsigned n, unsigned s,
+                     const uint16_t *d, unsigned m);
+static struct huft *flag_table(struct huft *tb, unsigned bb);
+static void explode_forget(struct xtree *x);
 int explode(void);
+int explode_free(void);
 
 /* The implode algorithm uses a sliding 4K or 8K byte window on the
    uncompressed stream to find repeated byte strings.  This is implemented
@@ -161,36 +163,18 @@ static const uint16_t cpdist8[] = {
     5633, 5761, 5889, 6017, 6145, 6273, 6401, 6529, 6657, 6785, 6913,
     7041, 7169, 7297, 7425, 7553, 7681, 7809, 7937, 8065};
 
-/* Macros for inflate() bit peeking and grabbing.
-   The usage is:
+/* The bit peeking and grabbing macros NEEDBITS() and DUMPBITS() are in
+   bitread.h.  b is topped up to at least 57 bits whenever it runs short,
+   which is enough for a whole distance/length pair (at most 1 + 7 + 16 +
+   16 + 8 bits), so there is one refill every few codes.  Running past the
+   end of the compressed data ends the decoding; the check at the end then
+   finds that more bytes were used than there were. */
 
-        NEEDBITS(j);
-        x = b & mask_bits[j];
-        DUMPBITS(j);
+#define BITS_OVERRUN goto past_end
 
-   where NEEDBITS makes sure that b has at least j bits in it, and
-   DUMPBITS removes the bits from b.  The macros use the variable k
-   for the number of bits in b.  Normally, b and k are register
-   variables for speed.
- */
-
-#define NEEDBITS(n)                          \
-    do {                                     \
-        while (k < (n)) {                    \
-            b |= ((uint32_t) NEXTBYTE) << k; \
-            k += 8;                          \
-        }                                    \
-    } while (0)
-#define DUMPBITS(n) \
-    do {            \
-        b >>= (n);  \
-        k -= (n);   \
-    } while (0)
-
-#define DECODEHUFT(htab, bits, mask)                       \
+/* follow t through the subtables, if any, to the code's entry */
+#define HUFTCODE()                                         \
     do {                                                   \
-        NEEDBITS((unsigned) (bits));                       \
-        t = (htab) + ((~(unsigned) b) & (mask));           \
         while (1) {                                        \
             DUMPBITS(t->b);                                \
             if ((e = t->e) <= 32)                          \
@@ -199,10 +183,72 @@ static const uint16_t cpdist8[] = {
                 return 1;                                  \
             e &= 31;                                       \
             NEEDBITS(e);                                   \
-            t = t->v.t + ((~(unsigned) b) & mask_bits[e]); \
+            t = t->v.t + LOWBITS(~b, e);                   \
         }                                                  \
     } while (0)
 
+#define DECODEHUFT(htab, bits, mask)             \
+    do {                                         \
+        NEEDBITS((unsigned) (bits));             \
+        t = (htab) + ((~(unsigned) b) & (mask)); \
+        HUFTCODE();                              \
+    } while (0)
+
+/* Copy a match of n bytes from distance d to window position w.  The
+   implode window is much smaller than ours, so a source that lies ahead
+   of w (in the previous pass through the window) is never overlapped. */
+#define COPYMATCH()                                                         \
+    do {                                                                    \
+        if (G.ring != NULL) {                                               \
+            /* mirrored window:  one straight copy, no wrap checks */       \
+            register uint8_t *dst, *src;                                    \
+            unsigned pos = (unsigned) G.wf + w;                             \
+                                                                            \
+            if (pos < d) /* stay in one view of the ring (see inflate) */   \
+                pos += RINGSIZ;                                             \
+            dst = G.ring + pos;                                             \
+            src = dst - d;                                                  \
+            w += n;                                                         \
+            if (d >= n)                                                     \
+                memcpy(dst, src, n);                                        \
+            else                                                            \
+                do {                                                        \
+                    *dst++ = *src++;                                        \
+                } while (--n);                                              \
+            if (w >= wend) {                                                \
+                if ((retval = flush_window(w)) != 0)                        \
+                    return retval;                                          \
+                out = WINDOW;                                               \
+                w = 0;                                                      \
+            }                                                               \
+            break;                                                          \
+        }                                                                   \
+        d = w - d; /* construct offset */                                   \
+        do {                                                                \
+            e = wszimpl - ((d &= wszimpl - 1) > w ? d : w);                 \
+            if (e > n)                                                      \
+                e = n;                                                      \
+            n -= e;                                                         \
+            if (u && w <= d) {                                              \
+                memzero(out + w, e);                                        \
+                w += e;                                                     \
+                d += e;                                                     \
+            } else if (w - d >= e) { /* (assumes unsigned comparison) */    \
+                memcpy(out + w, out + d, e);                                \
+                w += e;                                                     \
+                d += e;                                                     \
+            } else                                                          \
+                do {                                                        \
+                    out[w++] = out[d++];                                    \
+                } while (--e);                                              \
+            if (w == wszimpl) {                                             \
+                if ((retval = flush_window(w)) != 0)                        \
+                    return retval;                                          \
+                w = u = 0;                                                  \
+            }                                                               \
+        } while (n);                                                        \
+    } while (0)
+
 /* Get the bit lengths for a code representation from the compressed
    stream.  If get_tree() returns 4, then there is an error in the data.
    Otherwise zero is returned. */
@@ -230,213 +276,99 @@ unsigned n;  /* number expected */
     return k != n ? 4 : 0; /* should have read n of them */
 }
 
-/* Decompress the imploded data using coded literals and a sliding
-   window (of size 2^(6+bdl) bytes). */
-static int explode_lit(tb, tl, td, bb, bl, bd, bdl)
-struct huft *tb, *tl, *td; /* literal, length, and distance tables */
-unsigned bb, bl, bd;       /* number of bits decoded by those */
-unsigned bdl;              /* number of distance low bits */
+/* Get the table for the code lengths l[0..n-1] (as huft_build() with s, d,
+   and m as given) into x.  If x already holds the table built from the
+   same lengths for the previous member, it is used again.  Returns zero
+   or an error code as huft_build(), in which case x is left empty. */
+static int get_table(x, l, n, s, d, m)
+struct xtree *x;   /* cached table */
+unsigned *l;       /* bit lengths */
+unsigned n;        /* number of codes */
+unsigned s;        /* number of simple-valued codes */
+const uint16_t *d; /* list of base values for non-simple codes */
+unsigned m;        /* maximum lookup bits */
 {
-    uint64_t s;          /* bytes to decompress */
-    register unsigned e; /* table entry flag/number of extra bits */
-    unsigned n, d;       /* length and index for copy */
-    unsigned w;          /* current window position */
-    struct huft *t;      /* pointer to table entry */
-    unsigned mb, ml, md; /* masks for bb, bl, and bd bits */
-    unsigned mdl;        /* mask for bdl (distance lower) bits */
-    register uint32_t b; /* bit buffer */
-    register unsigned k; /* number of bits in bit buffer */
-    unsigned u;          /* true if unflushed */
-    int retval = 0;      /* error code returned: initialized to "no error" */
-
-    /* explode the coded data */
-    b = k = w = 0;      /* initialize bit buffer, window */
-    u = 1;              /* buffer unflushed */
-    mb = mask_bits[bb]; /* precompute masks for speed */
-    ml = mask_bits[bl];
-    md = mask_bits[bd];
-    mdl = mask_bits[bdl];
-    s = G.lrec.ucsize;
-    while (s > 0) /* do until ucsize bytes uncompressed */
-    {
-        NEEDBITS(1);
-        if (b & 1) {
-            /* literal--decode it */
-            DUMPBITS(1);
-            s--;
-            DECODEHUFT(tb, bb, mb); /* get coded literal */
-            redirSlide[w++] = (uint8_t) t->v.n;
-            if (w == wszimpl) {
-                if ((retval = flush(redirSlide, (uint32_t) w, 0)) != 0)
-                    return retval;
-                w = u = 0;
-            }
-        } else {
-            /* else distance/length */
-            DUMPBITS(1);
-            NEEDBITS(bdl); /* get distance low bits */
-            d = (unsigned) b & mdl;
-            DUMPBITS(bdl);
-            DECODEHUFT(td, bd, md); /* get coded distance high bits */
-            d = w - d - t->v.n;     /* construct offset */
-            DECODEHUFT(tl, bl, ml); /* get coded length */
-            n = t->v.n;
-            if (e) {
-                /* get length extra bits */
-                NEEDBITS(8);
-                n += (unsigned) b & 0xff;
-                DUMPBITS(8);
-            }
-
-            /* do the copy */
-            s = (s > (uint64_t) n ? s - (uint64_t) n : 0);
-            do {
-                e = wszimpl - ((d &= wszimpl - 1) > w ? d : w);
-                if (e > n)
-                    e = n;
-                n -= e;
-                if (u && w <= d) {
-                    memzero(redirSlide + w, e);
-                    w += e;
-                    d += e;
-                } else
-                    do {
-                        redirSlide[w++] = redirSlide[d++];
-                    } while (--e);
-                if (w == wszimpl) {
-                    if ((retval = flush(redirSlide, (uint32_t) w, 0)) != 0)
-                        return retval;
-                    w = u = 0;
-                }
-            } while (n);
-        }
+    unsigned i; /* counter */
+    int r;      /* return code */
+
+    if (x->t != NULL && x->d == d && x->m == m) {
+        for (i = 0; i < n && x->l[i] == l[i]; i++)
+            ;
+        if (i == n)
+            return 0;
     }
-
-    /* flush out redirSlide */
-    if ((retval = flush(redirSlide, (uint32_t) w, 0)) != 0)
-        return retval;
-    if (G.csize + G.incnt + (k >> 3)) {
-        /* should have read csize bytes, but sometimes read one too
-           many: k>>3 compensates */
-        G.used_csize = G.lrec.csize - G.csize - G.incnt - (k >> 3);
-        return 5;
+    explode_forget(x);
+    x->bits = m;
+    if ((r = huft_build(l, n, s, d, extra, &x->t, &x->bits)) != 0) {
+        if (r == 1)
+            huft_free(x->t);
+        x->t = NULL;
+        return r;
     }
+    x->m = m;
+    x->d = d;
+    for (i = 0; i < n; i++)
+        x->l[i] = (uint8_t) l[i];
     return 0;
 }
 
-/* Decompress the imploded data using uncoded literals and a sliding
-   window (of size 2^(6+bdl) bytes). */
-static int explode_nolit(tl, td, bl, bd, bdl)
-struct huft *tl, *td; /* length and distance decoder tables */
-unsigned bl, bd;      /* number of bits decoded by tl[] and td[] */
-unsigned bdl;         /* number of distance low bits */
+/* Make the table that explode_lit() looks up first.  It is indexed by the
+   literal flag and the next bb bits as they come in (not inverted), so an
+   entry either holds a whole literal with its flag, or starts a literal
+   in one of tb's subtables, or (e == 0, one bit) announces a distance/
+   length pair. */
+static struct huft *flag_table(tb, bb)
+struct huft *tb; /* literal code table */
+unsigned bb;     /* number of bits decoded by tb[] */
 {
-    uint64_t s;          /* bytes to decompress */
-    register unsigned e; /* table entry flag/number of extra bits */
-    unsigned n, d;       /* length and index for copy */
-    unsigned w;          /* current window position */
-    struct huft *t;      /* pointer to table entry */
-    unsigned ml, md;     /* masks for bl and bd bits */
-    unsigned mdl;        /* mask for bdl (distance lower) bits */
-    register uint32_t b; /* bit buffer */
-    register unsigned k; /* number of bits in bit buffer */
-    unsigned u;          /* true if unflushed */
-    int retval = 0;      /* error code returned: initialized to "no error" */
-
-    /* explode the coded data */
-    b = k = w = 0;      /* initialize bit buffer, window */
-    u = 1;              /* buffer unflushed */
-    ml = mask_bits[bl]; /* precompute masks for speed */
-    md = mask_bits[bd];
-    mdl = mask_bits[bdl];
-    s = G.lrec.ucsize;
-    while (s > 0) {
-        /* do until ucsize bytes uncompressed */
-        NEEDBITS(1);
-        if (b & 1) {
-            /* then literal--get eight bits */
-            DUMPBITS(1);
-            s--;
-            NEEDBITS(8);
-            redirSlide[w++] = (uint8_t) b;
-            if (w == wszimpl) {
-                if ((retval = flush(redirSlide, (uint32_t) w, 0)) != 0)
-                    return retval;
-                w = u = 0;
-            }
-            DUMPBITS(8);
+    struct huft *tf; /* table made */
+    unsigned i;      /* index */
+
+    tf = checked_malloc((2U << bb) * sizeof(struct huft));
+    for (i = 0; i < (2U << bb); i++) {
+        if (i & 1) {
+            tf[i] = tb[~(i >> 1) & mask_bits[bb]];
+            tf[i].b++;
         } else {
-            /* else distance/length */
-            DUMPBITS(1);
-            NEEDBITS(bdl); /* get distance low bits */
-            d = (unsigned) b & mdl;
-            DUMPBITS(bdl);
-            DECODEHUFT(td, bd, md); /* get coded distance high bits */
-            d = w - d - t->v.n;     /* construct offset */
-            DECODEHUFT(tl, bl, ml); /* get coded length */
-            n = t->v.n;
-            if (e) {
-                /* get length extra bits */
-                NEEDBITS(8);
-                n += (unsigned) b & 0xff;
-                DUMPBITS(8);
-            }
-
-            /* do the copy */
-            s = (s > (uint64_t) n ? s - (uint64_t) n : 0);
-            do {
-                e = wszimpl - ((d &= wszimpl - 1) > w ? d : w);
-                if (e > n)
-                    e = n;
-                n -= e;
-                if (u && w <= d) {
-                    memzero(redirSlide + w, e);
-                    w += e;
-                    d += e;
-                } else
-                    do {
-                        redirSlide[w++] = redirSlide[d++];
-                    } while (--e);
-                if (w == wszimpl) {
-                    if ((retval = flush(redirSlide, (uint32_t) w, 0)) != 0)
-                        return retval;
-                    w = u = 0;
-                }
-            } while (n);
+            tf[i].e = 0;
+            tf[i].b = 1;
+            tf[i].v.n = 0;
         }
     }
-
-    /* flush out redirSlide */
-    if ((retval = flush(redirSlide, (uint32_t) w, 0)) != 0)
-        return retval;
-    if (G.csize + G.incnt + (k >> 3)) {
-        /* should have read csize bytes, but
-           sometimes read one too many:  k>>3 compensates */
-        G.used_csize = G.lrec.csize - G.csize - G.incnt - (k >> 3);
-        return 5;
-    }
-    return 0;
+    return tf;
 }
 
+/* explode_lit() and explode_nolit(), and with BITS_BMI2 their twins for
+   BMI2 */
+#define BMI2 0
+#include "expblock.h"
+#undef BMI2
+#ifdef BITS_BMI2
+#define BMI2 1
+#include "expblock.h"
+#undef BMI2
+#endif
+
 /* Explode an imploded compressed stream.  Based on the general purpose
    bit flag, decide on coded or uncoded literals, and an 8K or 4K sliding
    window.  Construct the literal (if any), length, and distance codes and
-   the tables needed to decode them (using huft_build() from inflate.c),
-   and call the appropriate routine for the type of data in the remainder
-   of the stream.  The four routines are nearly identical, differing only
-   in whether the literal is decoded or simply read in, and in how many
-   bits are read in, uncoded, for the low distance bits. */
+   the tables needed to decode them (using huft_build() from inflate.c, or
+   keeping those of the previous member if its codes were the same), and
+   call the appropriate routine for the type of data in the remainder of
+   the stream.  The four routines are nearly identical, differing only in
+   whether the literal is decoded or simply read in, and in how many bits
+   are read in, uncoded, for the low distance bits. */
 int explode()
 {
-    unsigned r;      /* return codes */
-    struct huft *tb; /* literal code table */
-    struct huft *tl; /* length code table */
-    struct huft *td; /* distance code table */
-    unsigned bb;     /* bits for tb */
-    unsigned bl;     /* bits for tl */
-    unsigned bd;     /* bits for td */
-    unsigned bdl;    /* number of uncoded lower distance bits */
-    unsigned l[256]; /* bit lengths for codes */
+    unsigned r;        /* return codes */
+    struct xtree *xb;  /* literal code table */
+    struct xtree *xl;  /* length code table */
+    struct xtree *xd;  /* distance code table */
+    unsigned bb;       /* bits for tb */
+    unsigned bl;       /* bits for tl */
+    unsigned bd;       /* bits for td */
+    unsigned bdl;      /* number of uncoded lower distance bits */
+    unsigned l[256];   /* bit lengths for codes */
 
     /* Tune base table sizes.  Note: I thought that to truly optimize speed,
        I would have to select different bl, bd, and bb values for different
@@ -445,6 +377,10 @@ int explode()
        bd = 8 worked marginally better for large compressed sizes. */
     bl = 7;
     bd = (G.csize + G.incnt) > 200000L ? 8 : 7;
+    bb = 9;
+    xb = &G.xtrees[0];
+    xl = &G.xtrees[1];
+    xd = &G.xtrees[2];
 
 #ifdef DEBUG
     G.hufts = 0; /* initialize huft's malloc'ed */
@@ -452,69 +388,76 @@ int explode()
 
     if (G.lrec.general_purpose_bit_flag & 4) {
         /* With literal tree--minimum match length is 3 */
-        bb = 9; /* base table size for literals */
         if ((r = get_tree(l, 256)) != 0)
             return (int) r;
-        if ((r = huft_build(l, 256, 256, NULL, NULL, &tb, &bb)) != 0) {
-            if (r == 1)
-                huft_free(tb);
+        if ((r = get_table(xb, l, 256, 256, NULL, bb)) != 0)
             return (int) r;
-        }
-        if ((r = get_tree(l, 64)) != 0) {
-            huft_free(tb);
-            return (int) r;
-        }
-        if ((r = huft_build(l, 64, 0, cplen3, extra, &tl, &bl)) != 0) {
-            if (r == 1)
-                huft_free(tl);
-            huft_free(tb);
+        if (xb->f == NULL)
+            xb->f = flag_table(xb->t, xb->bits);
+        if ((r = get_tree(l, 64)) != 0)
             return (int) r;
-        }
+        r = get_table(xl, l, 64, 0, cplen3, bl);
     } else {
         /* No literal tree--minimum match length is 2 */
-        tb = NULL;
         if ((r = get_tree(l, 64)) != 0)
             return (int) r;
-        if ((r = huft_build(l, 64, 0, cplen2, extra, &tl, &bl)) != 0) {
-            if (r == 1)
-                huft_free(tl);
-            return (int) r;
-        }
+        r = get_table(xl, l, 64, 0, cplen2, bl);
     }
+    if (r != 0)
+        return (int) r;
 
-    if ((r = get_tree(l, 64)) != 0) {
-        huft_free(tl);
-        if (tb != NULL)
-            huft_free(tb);
+    if ((r = get_tree(l, 64)) != 0)
         return (int) r;
-    }
     if (G.lrec.general_purpose_bit_flag & 2) {
         /* true if 8K */
         bdl = 7;
-        r = huft_build(l, 64, 0, cpdist8, extra, &td, &bd);
+        r = get_table(xd, l, 64, 0, cpdist8, bd);
     } else {
         /* else 4K */
         bdl = 6;
-        r = huft_build(l, 64, 0, cpdist4, extra, &td, &bd);
+        r = get_table(xd, l, 64, 0, cpdist4, bd);
     }
-    if (r != 0) {
-        if (r == 1)
-            huft_free(td);
-        huft_free(tl);
-        if (tb != NULL)
-            huft_free(tb);
+    if (r != 0)
         return (int) r;
-    }
 
-    if (tb != NULL) {
-        r = explode_lit(tb, tl, td, bb, bl, bd, bdl);
-        huft_free(tb);
-    } else {
-        r = explode_nolit(tl, td, bl, bd, bdl);
-    }
+#ifdef BITS_BMI2
+    if (have_bmi2())
+        r = G.lrec.general_purpose_bit_flag & 4
+                ? explode_lit_bmi2(xb->f, xl->t, xd->t, xb->bits + 1,
+                                   xl->bits, xd->bits, bdl)
+                : explode_nolit_bmi2(xl->t, xd->t, xl->bits, xd->bits, bdl);
+    else
+#endif
+    if (G.lrec.general_purpose_bit_flag & 4)
+        r = explode_lit(xb->f, xl->t, xd->t, xb->bits + 1, xl->bits,
+                        xd->bits, bdl);
+    else
+        r = explode_nolit(xl->t, xd->t, xl->bits, xd->bits, bdl);
 
-    huft_free(td);
-    huft_free(tl);
     Trace((stderr, "<%u > ", G.hufts));
     return (int) r;
 }
+
+/* Free the tables kept in x. */
+static void explode_forget(x)
+struct xtree *x; /* cached table */
+{
+    if (x->f != NULL) {
+        free(x->f);
+        x->f = NULL;
+    }
+    if (x->t != NULL) {
+        huft_free(x->t);
+        x->t = NULL;
+    }
+}
+
+/* Free the tables explode() kept for the next member. */
+int explode_free()
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+        explode_forget(&G.xtrees[i]);
+    return 0;
+}
@@ -15,18 +15,66 @@
 #include "unzip.h"
 #include "crc32.h"
 #include "crypt.h"
+#include "aescrypt.h"
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 static const char FilenameNotMatched[] = "caution: filename not matched:  %s\n";
 static const char ExclFilenameNotMatched[] =
     "caution: excluded filename not matched:  %s\n";
 
+/* what extract_or_test_local() did with the member */
+#define ENTRY_DONE    0 /* extracted or tested it (or tried to) */
+#define ENTRY_SKIPPED 1 /* left it alone */
+#define ENTRY_STOP    2 /* no point going on with the zipfile */
+
+/* a stream (see do_stream() in process.c):  where the next byte to be used
+   is, from its start */
+#define STREAMPOS() (G.ziplen - (G.incnt > 0 ? G.incnt : 0))
+#define STREAMCSIZE ((off_t) 1 << 62) /* G.csize while it is not known */
+
+/* what the central directory is checked against at the end of a stream */
+typedef struct {
+    off_t offset; /* of the local header */
+    uint64_t csize;
+    uint64_t ucsize;
+    uint32_t crc;
+} streamed_t;
+typedef struct {
+    streamed_t *m; /* in the order of the stream */
+    size_t num;
+    size_t max;
+} streamlist_t;
+
 static int store_info(void);
+static int want_member(int *fn_matched, int *xn_matched);
 static int extract_or_test_entrylist(unsigned numchunk, uint32_t *pfilnum,
                                      uint32_t *pnum_bad_pwd,
                                      off_t *pold_extra_bytes,
                                      unsigned *pnum_dirs, direntry **pdirlist,
                                      int error_in_archive);
+static int extract_or_test_local(uint32_t *pnum_bad_pwd, unsigned *pnum_dirs,
+                                 direntry **pdirlist, int *perror_in_archive);
+static int extract_or_test_stream(uint32_t *pfilnum, uint32_t *pnum_skipped,
+                                  uint32_t *pnum_bad_pwd, unsigned *pnum_dirs,
+                                  direntry **pdirlist, int *fn_matched,
+                                  int *xn_matched);
+static unsigned stream_peek(unsigned n);
+static int stream_self_ending(void);
+static uint8_t *zip64_block(uint8_t *ef, unsigned ef_len, unsigned *plen);
+static int follow_read(uint8_t *buf, unsigned n, off_t offset);
+static void follow_settle(off_t start);
+static void stream_skip(off_t n);
+static int stream_skip_member(void);
+static int stream_read_descriptor(off_t len, int sync, uint32_t *pcrc,
+                                  uint64_t *pucsize);
+static int stream_descriptor(void);
+static int stream_sized_descriptor(void);
+static int stream_resync(off_t data);
+static int stream_cdir(streamlist_t *list, off_t cdstart);
 static int extract_or_test_member(void);
+static int aes_authenticate(void);
 static int TestExtraField(uint8_t *ef, unsigned ef_len);
 static int test_compr_eb(uint8_t *eb, unsigned eb_size, unsigned compr_offset,
                          int (*test_uc_ebdata)(uint8_t *eb, unsigned eb_size,
@@ -57,17 +105,18 @@ static const char CmprBzip[] = "bzip2";
 static const char CmprLZMA[] = "LZMA";
 static const char CmprIBMTerse[] = "IBM/Terse";
 static const char CmprIBMLZ77[] = "IBM LZ77";
+static const char CmprZstd[] = "Zstandard";
 static const char CmprWavPack[] = "WavPack";
 static const char CmprPPMd[] = "PPMd";
 static const char *ComprNames[NUM_METHODS] = {
     CmprNone,       CmprShrink,  CmprReduce,   CmprReduce,   CmprReduce,
     CmprReduce,     CmprImplode, CmprTokenize, CmprDeflate,  CmprDeflat64,
     CmprDCLImplode, CmprBzip,    CmprLZMA,     CmprIBMTerse, CmprIBMLZ77,
-    CmprWavPack,    CmprPPMd};
+    CmprZstd,       CmprWavPack, CmprPPMd};
 static const unsigned ComprIDs[NUM_METHODS] = {
     STORED,   SHRUNK,    REDUCED1,  REDUCED2,    REDUCED3,    REDUCED4,
     IMPLODED, TOKENIZED, DEFLATED,  ENHDEFLATED, DCLIMPLODED, BZIPPED,
-    LZMAED,   IBMTERSED, IBMLZ77ED, WAVPACKED,   PPMDED};
+    LZMAED,   IBMTERSED, IBMLZ77ED, ZSTDED,      WAVPACKED,   PPMDED};
 static const char FilNamMsg[] = "%s:  bad filename length (%s)\n";
 static const char LvsCFNamMsg[] = "%s:  mismatching \"local\" filename (%s),\n\
          continuing with \"central\" filename version\n";
@@ -123,12 +172,17 @@ static const char ErrUnzipNoFile[] = "\n  error:  %s%s\n";
 static const char InvalidComprData[] = "invalid compressed data to ";
 static const char Inflate[] = "inflate";
 static const char BUnzip[] = "bunzip";
+static const char Unlzma[] = "unlzma";
+#ifdef USE_ZSTD
+static const char Unzstd[] = "unzstd";
+#endif
 
 static const char Explode[] = "explode";
 static const char Unshrink[] = "unshrink";
 
 static const char FileUnknownCompMethod[] = "%s:  unknown compression method\n";
 static const char BadCRC[] = " bad CRC %08x  (should be %08x)\n";
+static const char BadAESMac[] = " bad AES authentication code\n";
 
 /* TruncEAs[] also used in OS/2 mapname(), close_outfile() */
 char const TruncEAs[] = " compressed EA data missing (%d bytes)\n";
@@ -152,6 +206,30 @@ static const char BadExtraFieldCRC[] =
 static const char OverlappedComponents[] =
     "error: invalid zip file with overlapped components (possible zip bomb)\n";
 
+static const char NoSuchDisk[] =
+    "%s:  starts on disk %u, but the split archive has %u\n";
+
+static const char StreamEnded[] =
+    "error [%s]:  stream ended before the central directory\n";
+static const char StreamBadSig[] =
+    "error [%s]:  no local header or central directory at offset %s\n";
+static const char StreamNoEnd[] =
+    "warning [%s]:  %s:  where its data end is not known in a stream; "
+    "skipped\n";
+static const char StreamLost[] =
+    "error [%s]:  cannot find the end of %s in the stream\n";
+static const char StreamNoDescriptor[] = "\n  error:  no data descriptor\n";
+static const char StreamDescDiffers[] =
+    "warning [%s]:  %s:  data descriptor does not match the local header\n";
+static const char StreamCentNotFound[] =
+    "warning [%s]:  %s is in the central directory but not in the stream\n";
+static const char StreamCentDiffers[] =
+    "warning [%s]:  %s differs from its central directory entry\n";
+static const char StreamCentCount[] =
+    "warning [%s]:  %s members in the stream, %s in the central directory\n";
+static const char StreamEndDiffers[] =
+    "warning [%s]:  end of central directory record does not match\n";
+
 /* A growable list of spans. */
 typedef struct {
     off_t beg; /* start of the span */
@@ -305,18 +383,21 @@ int extract_or_test_files(void) /* return PK-type error code */
         ((cover_t *) G.cover)->max = 0;
     }
     ((cover_t *) G.cover)->num = 0;
-    cover_add((cover_t *) G.cover,
-              G.extra_bytes + G.ecrec.offset_start_central_directory,
-              G.extra_bytes + G.ecrec.offset_start_central_directory +
-                  G.ecrec.size_central_directory);
-    if ((G.extra_bytes != 0 &&
-         cover_add((cover_t *) G.cover, 0, G.extra_bytes) != 0) ||
-        (G.ecrec.have_ecr64 &&
-         cover_add((cover_t *) G.cover, G.ecrec.ec64_start, G.ecrec.ec64_end) !=
-             0) ||
-        cover_add((cover_t *) G.cover, G.ecrec.ec_start, G.ecrec.ec_end) != 0) {
-        Info(slide, 1, ((char *) slide, OverlappedComponents));
-        return PK_BOMB;
+    if (!G.zipstream) { /* a stream is read once through:  no overlaps */
+        cover_add((cover_t *) G.cover,
+                  G.extra_bytes + G.ecrec.offset_start_central_directory,
+                  G.extra_bytes + G.ecrec.offset_start_central_directory +
+                      G.ecrec.size_central_directory);
+        if ((G.extra_bytes != 0 &&
+             cover_add((cover_t *) G.cover, 0, G.extra_bytes) != 0) ||
+            (G.ecrec.have_ecr64 &&
+             cover_add((cover_t *) G.cover, G.ecrec.ec64_start,
+                       G.ecrec.ec64_end) != 0) ||
+            cover_add((cover_t *) G.cover, G.ecrec.ec_start, G.ecrec.ec_end) !=
+                0) {
+            Info(slide, 1, ((char *) slide, OverlappedComponents));
+            return PK_BOMB;
+        }
     }
 
     /*---------------------------------------------------------------------------
@@ -361,13 +442,20 @@ int extract_or_test_files(void) /* return PK-type error code */
       un- less the end-of-central-directory record was on this disk, and we
       would not have gotten to this routine unless this is also the disk on
       which the central directory starts.  In practice, this had better be the
-      ONLY disk in the archive, but we'll add multi-disk support soon.
+      ONLY disk in the archive, unless find_volumes() (process.c) has found
+      the others of a split archive and made them all look like one.
       ---------------------------------------------------------------------------*/
 
     members_processed = 0;
     no_endsig_found = FALSE;
     reached_end = FALSE;
-    while (!reached_end) {
+    if (G.zipstream) { /* no central directory to go by */
+        error_in_archive = extract_or_test_stream(
+            &filnum, &num_skipped, &num_bad_pwd, &num_dirs, &dirlist,
+            fn_matched, xn_matched);
+        reached_end = G.disk_full <= 1 && error_in_archive != IZ_CTRLC;
+    }
+    while (!G.zipstream && !reached_end) {
         j = 0;
 
         /*
@@ -461,36 +549,11 @@ int extract_or_test_files(void) /* return PK-type error code */
                     ++j; /* file is OK; info[] stored; continue with next */
                 else
                     ++num_skipped;
-            } else {
-                int do_this_file;
-
-                if (G.filespecs == 0)
-                    do_this_file = TRUE;
-                else { /* check if this entry matches an `include' argument */
-                    do_this_file = FALSE;
-                    for (i = 0; i < G.filespecs; i++)
-                        if (match(G.filename, G.pfnames[i], G.UzO.C_flag)) {
-                            do_this_file = TRUE; /* ^-- ignore case or not? */
-                            if (fn_matched)
-                                fn_matched[i] = TRUE;
-                            break; /* found match, so stop looping */
-                        }
-                }
-                if (do_this_file) { /* check if this is an excluded file */
-                    for (i = 0; i < G.xfilespecs; i++)
-                        if (match(G.filename, G.pxnames[i], G.UzO.C_flag)) {
-                            do_this_file = FALSE; /* ^-- ignore case or not? */
-                            if (xn_matched)
-                                xn_matched[i] = TRUE;
-                            break;
-                        }
-                }
-                if (do_this_file) {
-                    if (store_info())
-                        ++j; /* file is OK */
-                    else
-                        ++num_skipped; /* unsupp. compression or encryption */
-                }
+            } else if (want_member(fn_matched, xn_matched)) {
+                if (store_info())
+                    ++j; /* file is OK */
+                else
+                    ++num_skipped; /* unsupp. compression or encryption */
             } /* end if (process_all_files) */
 
             members_processed++;
@@ -528,8 +591,8 @@ int extract_or_test_files(void) /* return PK-type error code */
          * the next batch of files.
          */
 
-        G.cur_zipfile_bufstart = lseek(G.zipfd, cd_bufstart, SEEK_SET);
-        read(G.zipfd, (char *) G.inbuf, INBUFSIZ); /* been here before... */
+        G.cur_zipfile_bufstart = zip_lseek(cd_bufstart, SEEK_SET);
+        zip_read(G.inbuf, INBUFSIZ); /* been here before... */
         G.inptr = cd_inptr;
         G.incnt = cd_incnt;
         ++blknum;
@@ -605,6 +668,21 @@ int extract_or_test_files(void) /* return PK-type error code */
         }
     }
 
+    /*---------------------------------------------------------------------------
+        With -S, make everything extracted so far durable in one go (-SS has
+        already synced each file as it was closed, but the directories still
+        need it) and report the cost.
+      ---------------------------------------------------------------------------*/
+
+    if (G.UzO.S_flag && G.extract_flag) {
+        if ((error = sync_extracted()) != PK_OK && !error_in_archive)
+            error_in_archive = error;
+        if (QCOND2)
+            printf("synced extracted files to disk in %.3f seconds\n",
+                   G.sync_secs);
+        G.sync_secs = 0.0;
+    }
+
     /*---------------------------------------------------------------------------
         Check for unmatched filespecs on command line and print warning if any
         found.  Free allocated memory.  (But suppress check when central dir
@@ -703,6 +781,7 @@ int extract_or_test_files(void) /* return PK-type error code */
 static int store_info(void) /* return 0 if skipping, 1 if OK */
 {
     int unknown_method;
+    unsigned method = G.crec.compression_method;
 
     /*---------------------------------------------------------------------------
         Check central directory info for version/compatibility requirements.
@@ -714,6 +793,7 @@ static int store_info(void) /* return 0 if skipping, 1 if OK */
     G.pInfo->crc = G.crec.crc32;
     G.pInfo->compr_size = G.crec.csize;
     G.pInfo->uncompr_size = G.crec.ucsize;
+    G.pInfo->aes = 0;
 
     switch (G.UzO.aflag) {
     case 0:
@@ -755,11 +835,19 @@ static int store_info(void) /* return 0 if skipping, 1 if OK */
         return 0;
     }
 
-    unknown_method = (G.crec.compression_method >= REDUCED1 &&
-                      G.crec.compression_method <= REDUCED4) ||
-                     G.crec.compression_method == TOKENIZED ||
-                     (G.crec.compression_method > ENHDEFLATED &&
-                      G.crec.compression_method != BZIPPED);
+    /* WinZip AES:  the real method is in the extra field */
+    if (method == AESENCRED && G.pInfo->encrypted &&
+        getAESData(G.extra_field, G.crec.extra_field_length) == PK_COOL)
+        method = G.pInfo->aes_method;
+
+    unknown_method = (method >= REDUCED1 && method <= REDUCED4) ||
+                     method == TOKENIZED ||
+                     (method > ENHDEFLATED && method != BZIPPED &&
+                      method != LZMAED
+#ifdef USE_ZSTD
+                      && method != ZSTDED
+#endif
+                      );
 
     if (unknown_method) {
         if (!((G.UzO.tflag && G.UzO.qflag) || (!G.UzO.tflag && !QCOND2))) {
@@ -778,6 +866,15 @@ static int store_info(void) /* return 0 if skipping, 1 if OK */
         return 0;
     }
 
+    /* in a split archive, the offset is from the start of the member's disk
+       (see find_volumes() in process.c) */
+    if (G.nvol > 0 && G.crec.disk_number_start >= G.nvol) {
+        Info(slide, 1,
+             ((char *) slide, NoSuchDisk, FnFilter1(G.filename),
+              (unsigned) G.crec.disk_number_start + 1, G.nvol));
+        return 0;
+    }
+
     /* store a copy of the central header filename for later comparison */
     G.pInfo->cfilname = checked_strdup(G.filename);
 
@@ -786,9 +883,44 @@ static int store_info(void) /* return 0 if skipping, 1 if OK */
 
     G.pInfo->diskstart = G.crec.disk_number_start;
     G.pInfo->offset = (off_t) G.crec.relative_offset_local_header;
+    if (G.nvol > 0)
+        G.pInfo->offset += G.vol[G.pInfo->diskstart].start;
     return 1;
 }
 
+/* Return true if G.filename matches one of the filespecs (or there are
+   none) and none of the excluded ones, marking the specs that match. */
+static int want_member(fn_matched, xn_matched)
+int *fn_matched;
+int *xn_matched;
+{
+    int do_this_file;
+    unsigned i;
+
+    if (G.filespecs == 0)
+        do_this_file = TRUE;
+    else { /* check if this entry matches an `include' argument */
+        do_this_file = FALSE;
+        for (i = 0; i < G.filespecs; i++)
+            if (match(G.filename, G.pfnames[i], G.UzO.C_flag)) {
+                do_this_file = TRUE; /* ^-- ignore case or not? */
+                if (fn_matched)
+                    fn_matched[i] = TRUE;
+                break; /* found match, so stop looping */
+            }
+    }
+    if (do_this_file) { /* check if this is an excluded file */
+        for (i = 0; i < G.xfilespecs; i++)
+            if (match(G.filename, G.pxnames[i], G.UzO.C_flag)) {
+                do_this_file = FALSE; /* ^-- ignore case or not? */
+                if (xn_matched)
+                    xn_matched[i] = TRUE;
+                break;
+            }
+    }
+    return do_this_file;
+}
+
 unsigned find_compr_idx(compr_methodnum)
 unsigned compr_methodnum;
 {
@@ -814,15 +946,8 @@ direntry **pdirlist;
 int error_in_archive;
 {
     unsigned i;
-    int renamed, query;
-    int skip_entry;
     off_t bufstart, inbuf_offset, request;
-    int error, errcode;
-
-/* possible values for local skip_entry flag: */
-#define SKIP_NO         0 /* do not skip this entry */
-#define SKIP_Y_EXISTING 1 /* skip this entry, do not overwrite file */
-#define SKIP_Y_NONEXIST 2 /* skip this entry, do not create new file */
+    int error, r;
 
     /*-----------------------------------------------------------------------
         Second loop:  process files in current block, extracting or testing
@@ -879,8 +1004,8 @@ int error_in_archive;
 
         if (bufstart != G.cur_zipfile_bufstart) {
             Trace((stderr, "debug: bufstart != cur_zipfile_bufstart\n"));
-            G.cur_zipfile_bufstart = lseek(G.zipfd, bufstart, SEEK_SET);
-            if ((G.incnt = read(G.zipfd, (char *) G.inbuf, INBUFSIZ)) <= 0) {
+            G.cur_zipfile_bufstart = zip_lseek(bufstart, SEEK_SET);
+            if ((G.incnt = zip_read(G.inbuf, INBUFSIZ)) <= 0) {
                 Info(slide, 1,
                      ((char *) slide, OffsetMsg, *pfilnum, "lseek",
                       (long) bufstart));
@@ -991,242 +1116,846 @@ int error_in_archive;
         }
         free(G.pInfo->cfilname);
         G.pInfo->cfilname = NULL;
-        /* Size consistency checks must come after reading in the local extra
-         * field, so that any Zip64 extension local e.f. block has already
-         * been processed.
-         */
-        if (G.lrec.compression_method == STORED) {
-            uint64_t csiz_decrypted = G.lrec.csize;
+        r = extract_or_test_local(pnum_bad_pwd, pnum_dirs, pdirlist,
+                                  &error_in_archive);
+        if (r == ENTRY_SKIPPED)
+            continue; /* go on to next file */
+        if (r == ENTRY_STOP)
+            return error_in_archive;
+        error = cover_add((cover_t *) G.cover, request,
+                          G.cur_zipfile_bufstart + (G.inptr - G.inbuf));
+        if (error != 0) {
+            Info(slide, 1, ((char *) slide, OverlappedComponents));
+            return PK_BOMB;
+        }
+    } /* end for-loop (i:  files in current block) */
 
-            if (G.pInfo->encrypted) {
-                if (csiz_decrypted < 12) {
-                    /* handle the error now to prevent unsigned overflow */
-                    Info(slide, 1,
-                         ((char *) slide, ErrUnzipNoFile, InvalidComprData,
-                          Inflate));
-                    return PK_ERR;
-                }
-                csiz_decrypted -= 12;
-            }
-            if (G.lrec.ucsize != csiz_decrypted) {
+    return error_in_archive;
+}
+
+/* Extract or test the member whose local header, name and extra field
+   have just been read (into G.lrec, G.filename and G.extra_field), the
+   input being at the start of its data:  check the sizes, get the
+   password, find the name to extract to and whether to overwrite it. */
+static int extract_or_test_local(pnum_bad_pwd, pnum_dirs, pdirlist,
+                                 perror_in_archive)
+uint32_t *pnum_bad_pwd;
+unsigned *pnum_dirs;
+direntry **pdirlist;
+int *perror_in_archive;
+{
+    int renamed, query;
+    int skip_entry;
+    int error, errcode;
+
+/* possible values for local skip_entry flag: */
+#define SKIP_NO         0 /* do not skip this entry */
+#define SKIP_Y_EXISTING 1 /* skip this entry, do not overwrite file */
+#define SKIP_Y_NONEXIST 2 /* skip this entry, do not create new file */
+
+    /* Size consistency checks must come after reading in the local extra
+     * field, so that any Zip64 extension local e.f. block has already
+     * been processed.
+     */
+    if (G.pInfo->aes) {
+        /* WinZip AES:  the data are in the real method, and followed by
+           an authentication code that is not for the decompressor */
+        G.lrec.compression_method = G.pInfo->aes_method;
+        if (G.lrec.csize < (uint64_t) AES_OVERHEAD(G.pInfo->aes)) {
+            Info(slide, 1,
+                 ((char *) slide, ErrUnzipFile, InvalidComprData,
+                  "decrypt", FnFilter1(G.filename)));
+            if (*perror_in_archive < PK_ERR)
+                *perror_in_archive = PK_ERR;
+            return ENTRY_SKIPPED;
+        }
+        G.csize -= AES_MACLEN;
+    }
+    if (G.lrec.compression_method == STORED) {
+        uint64_t csiz_decrypted = G.lrec.csize;
+
+        if (G.pInfo->encrypted) {
+            unsigned head = G.pInfo->aes ? AES_OVERHEAD(G.pInfo->aes)
+                                         : RAND_HEAD_LEN;
+
+            if (csiz_decrypted < head) {
+                /* handle the error now to prevent unsigned overflow */
                 Info(slide, 1,
-                     ((char *) slide, WrnStorUCSizCSizDiff,
-                      FnFilter1(G.filename),
-                      format_off_t(G.lrec.ucsize, NULL, "u"),
-                      format_off_t(csiz_decrypted, NULL, "u")));
-                G.lrec.ucsize = csiz_decrypted;
-                if (error_in_archive < PK_WARN)
-                    error_in_archive = PK_WARN;
+                     ((char *) slide, ErrUnzipNoFile, InvalidComprData,
+                      Inflate));
+                if (*perror_in_archive < PK_ERR)
+                    *perror_in_archive = PK_ERR;
+                return ENTRY_STOP;
             }
+            csiz_decrypted -= head;
         }
+        if (G.lrec.ucsize != csiz_decrypted) {
+            Info(slide, 1,
+                 ((char *) slide, WrnStorUCSizCSizDiff,
+                  FnFilter1(G.filename),
+                  format_off_t(G.lrec.ucsize, NULL, "u"),
+                  format_off_t(csiz_decrypted, NULL, "u")));
+            G.lrec.ucsize = csiz_decrypted;
+            if (*perror_in_archive < PK_WARN)
+                *perror_in_archive = PK_WARN;
+        }
+    }
 
-        if (G.pInfo->encrypted && (error = decrypt(G.UzO.pwdarg)) != PK_COOL) {
-            if (error == PK_WARN) {
-                if (!((G.UzO.tflag && G.UzO.qflag) ||
-                      (!G.UzO.tflag && !QCOND2)))
-                    Info(slide, 1,
-                         ((char *) slide, SkipIncorrectPasswd,
-                          FnFilter1(G.filename)));
-                ++(*pnum_bad_pwd);
-            } else { /* (error > PK_WARN) */
-                if (error > error_in_archive)
-                    error_in_archive = error;
+    if (G.pInfo->encrypted && (error = decrypt(G.UzO.pwdarg)) != PK_COOL) {
+        if (error == PK_WARN) {
+            if (!((G.UzO.tflag && G.UzO.qflag) ||
+                  (!G.UzO.tflag && !QCOND2)))
                 Info(slide, 1,
-                     ((char *) slide, SkipCannotGetPasswd,
+                     ((char *) slide, SkipIncorrectPasswd,
                       FnFilter1(G.filename)));
-            }
-            continue; /* go on to next file */
+            ++(*pnum_bad_pwd);
+        } else { /* (error > PK_WARN) */
+            if (error > *perror_in_archive)
+                *perror_in_archive = error;
+            Info(slide, 1,
+                 ((char *) slide, SkipCannotGetPasswd,
+                  FnFilter1(G.filename)));
         }
+        return ENTRY_SKIPPED; /* go on to next file */
+    }
 
-        /*
-         * just about to extract file:  if extracting to disk, check if
-         * already exists, and if so, take appropriate action according to
-         * fflag/uflag/overwrite_all/etc. (we couldn't do this in upper
-         * loop because we don't store the possibly renamed filename[] in
-         * info[])
+    /*
+     * just about to extract file:  if extracting to disk, check if
+     * already exists, and if so, take appropriate action according to
+     * fflag/uflag/overwrite_all/etc. (we couldn't do this in upper
+     * loop because we don't store the possibly renamed filename[] in
+     * info[])
+     */
+    if (!G.UzO.tflag && !G.UzO.cflag) {
+        renamed = FALSE; /* user hasn't renamed output file yet */
+
+    startover:
+        query = FALSE;
+        skip_entry = SKIP_NO;
+        /* for files from DOS FAT, check for use of backslash instead
+         *  of slash as directory separator (bug in some zipper(s); so
+         *  far, not a problem in HPFS, NTFS or VFAT systems)
          */
-        if (!G.UzO.tflag && !G.UzO.cflag) {
-            renamed = FALSE; /* user hasn't renamed output file yet */
-
-        startover:
-            query = FALSE;
-            skip_entry = SKIP_NO;
-            /* for files from DOS FAT, check for use of backslash instead
-             *  of slash as directory separator (bug in some zipper(s); so
-             *  far, not a problem in HPFS, NTFS or VFAT systems)
-             */
-            if (G.pInfo->hostnum == FS_FAT_ && !MBSCHR(G.filename, '/')) {
-                char *p = G.filename;
-
-                if (*p)
-                    do {
-                        if (*p == '\\') {
-                            if (!G.reported_backslash) {
-                                Info(slide, 0x21,
-                                     ((char *) slide, BackslashPathSep,
-                                      G.zipfn));
-                                G.reported_backslash = TRUE;
-                                if (!error_in_archive)
-                                    error_in_archive = PK_WARN;
-                            }
-                            *p = '/';
+        if (G.pInfo->hostnum == FS_FAT_ && !MBSCHR(G.filename, '/')) {
+            char *p = G.filename;
+
+            if (*p)
+                do {
+                    if (*p == '\\') {
+                        if (!G.reported_backslash) {
+                            Info(slide, 0x21,
+                                 ((char *) slide, BackslashPathSep,
+                                  G.zipfn));
+                            G.reported_backslash = TRUE;
+                            if (!*perror_in_archive)
+                                *perror_in_archive = PK_WARN;
                         }
-                    } while (*PREINCSTR(p));
-            }
+                        *p = '/';
+                    }
+                } while (*PREINCSTR(p));
+        }
 
-            /* remove absolute path specs */
-            if (!renamed && G.filename[0] == '/') {
-                Info(slide, 1,
-                     ((char *) slide, AbsolutePathWarning,
-                      FnFilter1(G.filename)));
-                if (!error_in_archive)
-                    error_in_archive = PK_WARN;
+        /* remove absolute path specs */
+        if (!renamed && G.filename[0] == '/') {
+            Info(slide, 1,
+                 ((char *) slide, AbsolutePathWarning,
+                  FnFilter1(G.filename)));
+            if (!*perror_in_archive)
+                *perror_in_archive = PK_WARN;
+            do {
+                char *p = G.filename + 1;
                 do {
-                    char *p = G.filename + 1;
-                    do {
-                        *(p - 1) = *p;
-                    } while (*p++ != '\0');
-                } while (G.filename[0] == '/');
-            }
+                    *(p - 1) = *p;
+                } while (*p++ != '\0');
+            } while (G.filename[0] == '/');
+        }
 
-            /* mapname can create dirs if not freshening or if renamed */
-            error = mapname(renamed);
-            if ((errcode = error & ~MPN_MASK) != PK_OK &&
-                error_in_archive < errcode)
-                error_in_archive = errcode;
-            if ((errcode = error & MPN_MASK) > MPN_INF_TRUNC) {
-                if (errcode == MPN_CREATED_DIR) {
-                    direntry *d_entry;
-                    error = defer_dir_attribs(&d_entry);
-                    d_entry->next = (*pdirlist);
-                    (*pdirlist) = d_entry;
-                    ++(*pnum_dirs);
-                } else if (errcode == MPN_VOL_LABEL) {
-                    Info(slide, 1,
-                         ((char *) slide, SkipVolumeLabel,
-                          FnFilter1(G.filename), ""));
-                } else if (errcode > MPN_INF_SKIP && error_in_archive < PK_ERR)
-                    error_in_archive = PK_ERR;
-                Trace((stderr, "mapname(%s) returns error code = %d\n",
-                       FnFilter1(G.filename), error));
-                continue; /* go on to next file */
-            }
+        /* mapname can create dirs if not freshening or if renamed */
+        error = mapname(renamed);
+        if ((errcode = error & ~MPN_MASK) != PK_OK &&
+            *perror_in_archive < errcode)
+            *perror_in_archive = errcode;
+        if ((errcode = error & MPN_MASK) > MPN_INF_TRUNC) {
+            if (errcode == MPN_CREATED_DIR) {
+                direntry *d_entry;
+                error = defer_dir_attribs(&d_entry);
+                d_entry->next = (*pdirlist);
+                (*pdirlist) = d_entry;
+                ++(*pnum_dirs);
+            } else if (errcode == MPN_VOL_LABEL) {
+                Info(slide, 1,
+                     ((char *) slide, SkipVolumeLabel,
+                      FnFilter1(G.filename), ""));
+            } else if (errcode > MPN_INF_SKIP && *perror_in_archive < PK_ERR)
+                *perror_in_archive = PK_ERR;
+            Trace((stderr, "mapname(%s) returns error code = %d\n",
+                   FnFilter1(G.filename), error));
+            return ENTRY_SKIPPED; /* go on to next file */
+        }
 
-            switch (check_for_newer(G.filename)) {
-            case DOES_NOT_EXIST:
-                /* freshen (no new files): skip unless just renamed */
-                if (G.UzO.fflag && !renamed)
-                    skip_entry = SKIP_Y_NONEXIST;
+        switch (check_for_newer(G.filename)) {
+        case DOES_NOT_EXIST:
+            /* freshen (no new files): skip unless just renamed */
+            if (G.UzO.fflag && !renamed)
+                skip_entry = SKIP_Y_NONEXIST;
+            break;
+        case EXISTS_AND_OLDER:
+            if (IS_OVERWRT_NONE)
+                /* never overwrite:  skip file */
+                skip_entry = SKIP_Y_EXISTING;
+            else if (!IS_OVERWRT_ALL)
+                query = TRUE;
+            break;
+        case EXISTS_AND_NEWER: /* (or equal) */
+            if (IS_OVERWRT_NONE || (G.UzO.uflag && !renamed)) {
+                /* skip if update/freshen & orig name */
+                skip_entry = SKIP_Y_EXISTING;
+            } else {
+                query = TRUE;
+            }
+            break;
+        }
+        if (query) {
+            size_t fnlen;
+        reprompt:
+            Info(slide, 1,
+                 ((char *) slide, ReplaceQuery, FnFilter1(G.filename)));
+            if (fgets(G.answerbuf, sizeof(G.answerbuf), stdin) == NULL) {
+                Info(slide, 1, ((char *) slide, AssumeNone));
+                *G.answerbuf = 'N';
+                if (!*perror_in_archive)
+                    *perror_in_archive = 1; /* not extracted:  warning */
+            }
+            switch (*G.answerbuf) {
+            case 'r':
+            case 'R':
+                do {
+                    Info(slide, 1, ((char *) slide, NewNameQuery));
+                    fgets(G.filename, FILNAMSIZ, stdin);
+                    /* usually get \n here:  better check for it */
+                    fnlen = strlen(G.filename);
+                    if (lastchar(G.filename, fnlen) == '\n')
+                        G.filename[--fnlen] = '\0';
+                } while (fnlen == 0);
+                renamed = TRUE;
+                goto startover; /* sorry for a goto */
+            case 'A':           /* dangerous option:  force caps */
+                G.overwrite_mode = OVERWRT_ALWAYS;
                 break;
-            case EXISTS_AND_OLDER:
-                if (IS_OVERWRT_NONE)
-                    /* never overwrite:  skip file */
-                    skip_entry = SKIP_Y_EXISTING;
-                else if (!IS_OVERWRT_ALL)
-                    query = TRUE;
+            case 'y':
+            case 'Y':
                 break;
-            case EXISTS_AND_NEWER: /* (or equal) */
-                if (IS_OVERWRT_NONE || (G.UzO.uflag && !renamed)) {
-                    /* skip if update/freshen & orig name */
-                    skip_entry = SKIP_Y_EXISTING;
-                } else {
-                    query = TRUE;
-                }
+            case 'N':
+                G.overwrite_mode = OVERWRT_NEVER;
+                /* FALL THROUGH, skip */
+            case 'n':
+                /* skip file */
+                skip_entry = SKIP_Y_EXISTING;
                 break;
+            case '\n':
+            case '\r':
+                /* Improve echo of '\n' and/or '\r'
+                   (sizeof(G.answerbuf) == 10 (see globals.h), so
+                   there is enough space for the provided text...) */
+                strcpy(G.answerbuf, "{ENTER}");
+                /* fall through ... */
+            default:
+                /* usually get \n here:  remove it for nice display
+                   (fnlen can be re-used here, we are outside the
+                   "enter new filename" loop) */
+                fnlen = strlen(G.answerbuf);
+                if (lastchar(G.answerbuf, fnlen) == '\n')
+                    G.answerbuf[--fnlen] = '\0';
+                Info(slide, 1,
+                     ((char *) slide, InvalidResponse, G.answerbuf));
+                goto reprompt; /* yet another goto? */
+            }                  /* end switch (*answerbuf) */
+        }                      /* end if (query) */
+        if (skip_entry != SKIP_NO) {
+            return ENTRY_SKIPPED;
+        }
+    } /* end if (extracting to disk) */
+
+    G.disk_full = 0;
+    if ((error = extract_or_test_member()) != PK_COOL) {
+        if (error > *perror_in_archive)
+            *perror_in_archive = error; /* ...and keep going */
+        if (G.disk_full > 1) {
+            return ENTRY_STOP; /* (unless disk full) */
+        }
+    }
+    return ENTRY_DONE;
+}
+
+/*---------------------------------------------------------------------------
+    Extract or test the members of a stream (see do_stream() in process.c)
+    in the order in which their local headers come, making up for each the
+    central directory entry that store_info() goes by.  A member with bit 3
+    set has its CRC and sizes in a data descriptor after its data.  If the
+    local header has the sizes too (zip -0, zip -P), they are used and
+    checked against the descriptor, whose CRC the data are checked against
+    (the header has none); if the descriptor comes right away, the member
+    is empty; otherwise its method must find the end of its data by itself
+    (stream_self_ending()).  A member whose end cannot be told that way is
+    skipped up to the first descriptor that fits (stream_resync()), and so
+    is one that fails to decode.  The central directory, once it comes, is
+    checked against what was found.
+  ---------------------------------------------------------------------------*/
+
+static int extract_or_test_stream(pfilnum, pnum_skipped, pnum_bad_pwd,
+                                  pnum_dirs, pdirlist, fn_matched, xn_matched)
+uint32_t *pfilnum;
+uint32_t *pnum_skipped;
+uint32_t *pnum_bad_pwd;
+unsigned *pnum_dirs;
+direntry **pdirlist;
+int *fn_matched;
+int *xn_matched;
+{
+    static const char span_sig[4] = {0x50, 0x4b, 0x07, 0x08};
+    streamlist_t list;
+    off_t start, data;
+    size_t len;
+    int descr, nodata, r;
+    int error = PK_COOL, error_in_archive = PK_COOL;
+
+    list.m = NULL;
+    list.num = list.max = 0;
+    G.pInfo = G.info;
+    for (;;) {
+        start = STREAMPOS();
+        if (G.zipfollow)
+            follow_settle(start);
+        if (readbuf(G.sig, 4) != 4) {
+            Info(slide, 1, ((char *) slide, StreamEnded, G.zipfn));
+            error = PK_EOF;
+            break;
+        }
+        if (start == 0 && memcmp(G.sig, span_sig, 4) == 0)
+            continue; /* split archive that fit on one disk */
+        if (memcmp(G.sig, central_hdr_sig, 4) == 0 ||
+            memcmp(G.sig, end_central64_sig, 4) == 0 ||
+            memcmp(G.sig, end_central_sig, 4) == 0) {
+            error = stream_cdir(&list, start);
+            break;
+        }
+        if (memcmp(G.sig, local_hdr_sig, 4) != 0) {
+            Info(slide, 1,
+                 ((char *) slide, StreamBadSig, G.zipfn,
+                  format_off_t(start, NULL, NULL)));
+            error = PK_BADERR;
+            break;
+        }
+        if ((error = process_stream_file_hdr()) != PK_COOL) {
+            Info(slide, 0x21, ((char *) slide, BadLocalHdr, *pfilnum + 1));
+            break;
+        }
+        if ((error = do_string_read_filename(G.lrec.filename_length, 1)) !=
+            PK_COOL) {
+            if (error > error_in_archive)
+                error_in_archive = error;
+            if (error > PK_WARN) {
+                Info(slide, 1,
+                     ((char *) slide, FilNamMsg, FnFilter1(G.filename),
+                      "local"));
+                break; /* cannot tell where the next one is */
             }
-            if (query) {
-                size_t fnlen;
-            reprompt:
+        }
+        free(G.extra_field);
+        G.extra_field = NULL;
+        if ((error = do_string_extra_field(G.lrec.extra_field_length)) != 0) {
+            if (error > error_in_archive)
+                error_in_archive = error;
+            if (error > PK_WARN) {
                 Info(slide, 1,
-                     ((char *) slide, ReplaceQuery, FnFilter1(G.filename)));
-                if (fgets(G.answerbuf, sizeof(G.answerbuf), stdin) == NULL) {
-                    Info(slide, 1, ((char *) slide, AssumeNone));
-                    *G.answerbuf = 'N';
-                    if (!error_in_archive)
-                        error_in_archive = 1; /* not extracted:  warning */
-                }
-                switch (*G.answerbuf) {
-                case 'r':
-                case 'R':
-                    do {
-                        Info(slide, 1, ((char *) slide, NewNameQuery));
-                        fgets(G.filename, FILNAMSIZ, stdin);
-                        /* usually get \n here:  better check for it */
-                        fnlen = strlen(G.filename);
-                        if (lastchar(G.filename, fnlen) == '\n')
-                            G.filename[--fnlen] = '\0';
-                    } while (fnlen == 0);
-                    renamed = TRUE;
-                    goto startover; /* sorry for a goto */
-                case 'A':           /* dangerous option:  force caps */
-                    G.overwrite_mode = OVERWRT_ALWAYS;
-                    break;
-                case 'y':
-                case 'Y':
-                    break;
-                case 'N':
-                    G.overwrite_mode = OVERWRT_NEVER;
-                    /* FALL THROUGH, skip */
-                case 'n':
-                    /* skip file */
-                    skip_entry = SKIP_Y_EXISTING;
+                     ((char *) slide, ExtFieldMsg, FnFilter1(G.filename),
+                      "local"));
+                break;
+            }
+        }
+        data = STREAMPOS();
+
+        /* what the central directory would have said */
+        len = strlen(G.filename);
+        if (len > 0 && G.filename[len - 1] == '/')
+            G.crec.external_file_attributes = (uint32_t) 040755 << 16 | 0x10;
+        G.crec.relative_offset_local_header = (uint64_t) start;
+        G.pInfo->offset = start;
+
+        /* where the data end, if the local header does not say */
+        descr = (G.lrec.general_purpose_bit_flag & 8) != 0;
+        G.streamlost = descr && G.lrec.csize == 0;
+        descr = descr && !G.streamlost; /* to be checked after the data */
+        G.streamdescr = descr;
+        if (descr && G.lrec.compression_method == STORED &&
+            (G.lrec.general_purpose_bit_flag & 1) != 0 &&
+            G.lrec.csize == G.lrec.ucsize) { /* zip -0 -P leaves out */
+            G.lrec.csize += RAND_HEAD_LEN;  /* the encryption header */
+            G.crec.csize = G.lrec.csize;
+            G.csize = (off_t) G.lrec.csize;
+        }
+        nodata = FALSE;
+        if (G.streamlost && G.lrec.compression_method == STORED &&
+            stream_read_descriptor((off_t) 0, TRUE, &G.lrec.crc32,
+                                   &G.lrec.ucsize)) {
+            G.crec.crc32 = G.lrec.crc32;
+            G.crec.ucsize = G.lrec.ucsize;
+            G.streamlost = FALSE; /* an empty member */
+        } else if (G.streamlost && !stream_self_ending())
+            nodata = TRUE;
+        if (G.streamlost)
+            G.csize = STREAMCSIZE;
+
+        if (nodata) {
+            if (G.process_all_files || want_member(fn_matched, xn_matched)) {
+                Info(slide, 1,
+                     ((char *) slide, StreamNoEnd, G.zipfn,
+                      FnFilter1(G.filename)));
+                ++*pnum_skipped;
+                if (error_in_archive < PK_WARN)
+                    error_in_archive = PK_WARN;
+            }
+        } else if (G.process_all_files ||
+                   want_member(fn_matched, xn_matched)) {
+            if (store_info()) {
+                free(G.pInfo->cfilname); /* it is G.filename */
+                G.pInfo->cfilname = NULL;
+                ++*pfilnum;
+                r = extract_or_test_local(pnum_bad_pwd, pnum_dirs, pdirlist,
+                                          &error_in_archive);
+                if (r == ENTRY_STOP) {
+                    error = PK_COOL;
                     break;
-                case '\n':
-                case '\r':
-                    /* Improve echo of '\n' and/or '\r'
-                       (sizeof(G.answerbuf) == 10 (see globals.h), so
-                       there is enough space for the provided text...) */
-                    strcpy(G.answerbuf, "{ENTER}");
-                    /* fall through ... */
-                default:
-                    /* usually get \n here:  remove it for nice display
-                       (fnlen can be re-used here, we are outside the
-                       "enter new filename" loop) */
-                    fnlen = strlen(G.answerbuf);
-                    if (lastchar(G.answerbuf, fnlen) == '\n')
-                        G.answerbuf[--fnlen] = '\0';
-                    Info(slide, 1,
-                         ((char *) slide, InvalidResponse, G.answerbuf));
-                    goto reprompt; /* yet another goto? */
-                }                  /* end switch (*answerbuf) */
-            }                      /* end if (query) */
-            if (skip_entry != SKIP_NO) {
-                continue;
+                }
+            } else
+                ++*pnum_skipped;
+        }
+
+        /* on to the next local header */
+        if (!G.streamlost) {
+            if (G.streamdescr && /* not read by extract_or_test_member() */
+                (r = stream_sized_descriptor()) > error_in_archive)
+                error_in_archive = r;
+            stream_skip(data + (off_t) G.lrec.csize - STREAMPOS());
+        } else {
+            if (!nodata && STREAMPOS() == data && /* left alone */
+                (error = stream_skip_member()) > error_in_archive)
+                error_in_archive = error;
+            if (G.streamlost && stream_resync(data) != PK_COOL) {
+                Info(slide, 1,
+                     ((char *) slide, StreamLost, G.zipfn,
+                      FnFilter1(G.filename)));
+                error = PK_BADERR;
+                break;
             }
-        } /* end if (extracting to disk) */
+        }
+        if (list.num == list.max) {
+            list.max = list.max ? 2 * list.max : 64;
+            list.m = checked_realloc(list.m, list.max * sizeof(streamed_t));
+        }
+        list.m[list.num].offset = start;
+        list.m[list.num].csize = G.lrec.csize;
+        list.m[list.num].ucsize = G.lrec.ucsize;
+        list.m[list.num].crc = G.lrec.crc32;
+        list.num++;
+    }
+    if (error > error_in_archive)
+        error_in_archive = error;
+    G.streamlost = G.streamdescr = FALSE;
+    free(list.m);
+    return error_in_archive;
+}
 
-        G.disk_full = 0;
-        if ((error = extract_or_test_member()) != PK_COOL) {
-            if (error > error_in_archive)
-                error_in_archive = error; /* ...and keep going */
-            if (G.disk_full > 1) {
-                return error_in_archive; /* (unless disk full) */
+/* In a stream, make sure that the next n bytes are in G.inbuf, if there
+   are that many left:  returns how many there are. */
+static unsigned stream_peek(n)
+unsigned n;
+{
+    int k;
+
+    if (G.incnt < 0)
+        G.incnt = 0;
+    if ((unsigned) G.incnt < n) {
+        memmove(G.inbuf, G.inptr, (size_t) G.incnt);
+        G.inptr = G.inbuf;
+        while ((unsigned) G.incnt < n &&
+               (k = zip_read(G.inbuf + G.incnt, n - (unsigned) G.incnt)) > 0)
+            G.incnt += k;
+    }
+    return (unsigned) G.incnt;
+}
+
+/* Whether the method of the current member finds the end of its data by
+   itself, as it has to in a stream if the local header has no sizes.  With
+   traditional encryption, the input it decrypts past the end of its data
+   is put back by restore_input(); WinZip AES (method 99) is not self-ending
+   either way. */
+static int stream_self_ending()
+{
+    switch (G.lrec.compression_method) {
+    case DEFLATED:
+    case ENHDEFLATED:
+    case BZIPPED:
+#ifdef USE_ZSTD
+    case ZSTDED: /* as zip writes it, one frame */
+#endif
+        return TRUE;
+    case LZMAED: /* only with the end marker */
+        return (G.lrec.general_purpose_bit_flag & 2) != 0;
+    default:
+        return FALSE;
+    }
+}
+
+/* In a stream, read past the next n bytes (or what is left of them). */
+static void stream_skip(n)
+off_t n;
+{
+    unsigned k;
+
+    while (n > 0 &&
+           (k = readbuf((char *) G.outbuf,
+                        n < (off_t) OUTBUFSIZ ? (unsigned) n : OUTBUFSIZ)) > 0)
+        n -= k;
+}
+
+/* Get past the data of a member with bit 3 set that was left alone,
+   which in a stream only decoding it does:  test it, quietly.  An encrypted
+   one, without the password, is left to stream_resync(). */
+static int stream_skip_member()
+{
+    int tflag = G.UzO.tflag, qflag = G.UzO.qflag;
+    int error;
+
+    if ((G.lrec.general_purpose_bit_flag & 1) != 0)
+        return PK_COOL; /* no password:  stream_resync() finds the end */
+    G.UzO.tflag = TRUE;
+    G.UzO.qflag = 2;
+    G.pInfo->encrypted = FALSE;
+    G.pInfo->aes = FALSE;
+    G.pInfo->symlink = FALSE;
+    G.csize = STREAMCSIZE;
+    error = extract_or_test_member();
+    G.UzO.tflag = tflag;
+    G.UzO.qflag = qflag;
+    return error;
+}
+
+/* In a stream, if the bytes at G.inptr are the data descriptor of a
+   member whose data took up len bytes, read past them and return TRUE,
+   with the CRC and uncompressed size at *pcrc and *pucsize.  It may or may
+   not start with a signature, and its sizes are eight bytes long if the
+   local header has a Zip64 block (or if four-byte ones do not match):  the
+   compressed size must be len.  When looking for it (sync), one without a
+   signature must have another signature right after it, too. */
+static int stream_read_descriptor(len, sync, pcrc, pucsize)
+off_t len;
+int sync;
+uint32_t *pcrc;
+uint64_t *pucsize;
+{
+    unsigned have = stream_peek(28), n, i;
+    uint8_t *d;
+    int wide, zip64;
+
+    zip64 = zip64_block(G.extra_field, G.lrec.extra_field_length, &n) != NULL;
+    for (i = 0; i < 2; i++) {
+        wide = zip64 ? i == 0 : i == 1;
+        n = wide ? 20 : 12;
+        d = G.inptr;
+        if (have >= n + 4 && makeint32(d) == 0x08074b50 && /* signature */
+            (wide ? makeint64(d + 8) : makeint32(d + 8)) == (uint64_t) len)
+            d += 4;
+        else if (have < n + (sync ? 4 : 0) ||
+                 (wide ? makeint64(d + 4) : makeint32(d + 4)) !=
+                     (uint64_t) len ||
+                 (sync && memcmp(d + n, local_hdr_sig, 2) != 0)) /* PK */
+            continue;
+        *pcrc = makeint32(d);
+        *pucsize = wide ? makeint64(d + 12) : makeint32(d + 8);
+        n += (unsigned) (d - G.inptr);
+        G.inptr += n;
+        G.incnt -= (int) n;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* Read the data descriptor that follows the data of a member with bit 3
+   set in a stream, the input being right after the data, and take the CRC
+   and sizes from it. */
+static int stream_descriptor()
+{
+    off_t len = STREAMPOS() - G.pInfo->offset - (4 + LREC_SIZE) -
+                G.lrec.filename_length - G.lrec.extra_field_length;
+
+    if (stream_read_descriptor(len, FALSE, &G.lrec.crc32, &G.lrec.ucsize)) {
+        G.lrec.csize = (uint64_t) len;
+        G.streamlost = FALSE;
+        return PK_COOL;
+    }
+    if ((G.UzO.tflag && G.UzO.qflag) || (!G.UzO.tflag && !QCOND2))
+        Info(slide, 1, ((char *) slide, "%-22s ", FnFilter1(G.filename)));
+    Info(slide, 1, ((char *) slide, StreamNoDescriptor));
+    return PK_BADERR;
+}
+
+/* Read the data descriptor of a member with bit 3 set in a stream whose
+   local header has the sizes, skipping what is left of its data, and take
+   the CRC from it:  the header has the sizes only.  Returns PK_WARN if it
+   is not there or has other sizes. */
+static int stream_sized_descriptor()
+{
+    off_t data = G.pInfo->offset + (4 + LREC_SIZE) + G.lrec.filename_length +
+                 G.lrec.extra_field_length;
+    uint32_t crc;
+    uint64_t ucsize;
+
+    G.streamdescr = FALSE;
+    stream_skip(data + (off_t) G.lrec.csize - STREAMPOS());
+    if (stream_read_descriptor((off_t) G.lrec.csize, FALSE, &crc, &ucsize)) {
+        G.lrec.crc32 = crc;
+        if (ucsize == G.lrec.ucsize)
+            return PK_COOL;
+    }
+    Info(slide, 1,
+         ((char *) slide, StreamDescDiffers, G.zipfn, FnFilter1(G.filename)));
+    return PK_WARN;
+}
+
+/* Get past the rest of the data of a member with bit 3 set in a stream
+   whose end is not known, its data having started at offset data:  up to
+   the first data descriptor that has the length so far as compressed
+   size.  Returns PK_EOF if the stream ends first. */
+static int stream_resync(data)
+off_t data;
+{
+    off_t len;
+
+    while (stream_peek(28) >= 12) {
+        len = STREAMPOS() - data;
+        if (stream_read_descriptor(len, TRUE, &G.lrec.crc32,
+                                   &G.lrec.ucsize)) {
+            G.lrec.csize = (uint64_t) len;
+            G.streamlost = FALSE;
+            return PK_COOL;
+        }
+        G.inptr++;
+        G.incnt--;
+    }
+    return PK_EOF;
+}
+
+/* The data of the Zip64 extra block in the ef_len bytes at ef, and their
+   length, or NULL if there is none. */
+static uint8_t *zip64_block(ef, ef_len, plen)
+uint8_t *ef;
+unsigned ef_len;
+unsigned *plen;
+{
+    unsigned i, len;
+
+    for (i = 0; ef != NULL && i + EB_HEADSIZE <= ef_len;
+         i += EB_HEADSIZE + len) {
+        len = makeint16(ef + i + EB_LEN);
+        if (makeint16(ef + i + EB_ID) == EF_PKSZ64 &&
+            i + EB_HEADSIZE + len <= ef_len) {
+            *plen = len;
+            return ef + i + EB_HEADSIZE;
+        }
+    }
+    return NULL;
+}
+
+/* In follow mode (-F), read the n bytes at offset in the zipfile, waiting
+   for them to be written:  FALSE if they will not be. */
+static int follow_read(buf, n, offset)
+uint8_t *buf;
+unsigned n;
+off_t offset;
+{
+    ssize_t r;
+    unsigned k = 0;
+
+    while (k < n) {
+        if ((r = pread(G.zipfd, buf + k, n - k, offset + k)) > 0)
+            k += (unsigned) r;
+        else if (r < 0 && errno == EINTR)
+            continue;
+        else if (r < 0 || follow_wait(offset + k) != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* In follow mode (-F), the writer may come back to a local header once
+   the data are written, to fill in the CRC and sizes (bit 3 not set).  The
+   one at start is taken to be final when another signature has come right
+   after the data it says there are.  If what the stream has read ahead of
+   it is out of date, it is read again from start. */
+static void follow_settle(start)
+off_t start;
+{
+    uint8_t *h = NULL, *z, sig[4];
+    unsigned have = 0, hlen, eflen, zlen;
+    uint64_t csize;
+    struct stat st;
+
+    for (;;) {
+        h = checked_realloc(h, hlen = 4 + LREC_SIZE);
+        if (!follow_read(h, hlen, start) || memcmp(h, local_hdr_sig, 4) != 0 ||
+            (makeint16(h + 4 + L_GENERAL_PURPOSE_BIT_FLAG) & 8) != 0)
+            break; /* the stream will see to it */
+        eflen = makeint16(h + 4 + L_EXTRA_FIELD_LENGTH);
+        hlen += makeint16(h + 4 + L_FILENAME_LENGTH) + eflen;
+        h = checked_realloc(h, hlen);
+        if (!follow_read(h, hlen, start))
+            break;
+        have = hlen;
+        csize = makeint32(h + 4 + L_COMPRESSED_SIZE);
+        z = zip64_block(h + hlen - eflen, eflen, &zlen);
+        if (csize == 0xffffffff && z != NULL) {
+            if (makeint32(h + 4 + L_UNCOMPRESSED_SIZE) == 0xffffffff) {
+                z += 8; /* the uncompressed size comes first */
+                zlen = zlen < 8 ? 0 : zlen - 8;
             }
+            if (zlen >= 8)
+                csize = makeint64(z);
         }
-        error = cover_add((cover_t *) G.cover, request,
-                          G.cur_zipfile_bufstart + (G.inptr - G.inbuf));
-        if (error != 0) {
-            Info(slide, 1, ((char *) slide, OverlappedComponents));
-            return PK_BOMB;
+        if (!follow_read(sig, 4, start + hlen + (off_t) csize))
+            break;
+        if (memcmp(sig, local_hdr_sig, 4) == 0 ||
+            memcmp(sig, central_hdr_sig, 4) == 0 ||
+            memcmp(sig, end_central64_sig, 4) == 0 ||
+            memcmp(sig, end_central_sig, 4) == 0)
+            break;
+        Trace((stderr, "follow_settle:  local header at %s not final yet\n",
+               format_off_t(start, NULL, NULL)));
+        have = 0;
+        if (fstat(G.zipfd, &st) != 0 || follow_wait(st.st_size) != 0)
+            break;
+    }
+    if (G.incnt > 0 && memcmp(G.inptr, h, MIN((unsigned) G.incnt, have))) {
+        lseek(G.zipfd, start, SEEK_SET);
+        G.ziplen = start;
+        G.inptr = G.inbuf;
+        G.incnt = 0;
+    }
+    free(h);
+}
+
+/* Check the central directory at the end of a stream, the first signature
+   of which (a central header's, or an end record's if there are no
+   members) has just been read at cdstart, against the members found on
+   the way. */
+static int stream_cdir(list, cdstart)
+streamlist_t *list;
+off_t cdstart;
+{
+    ec_byte_rec64 rec;
+    uint64_t n = 0, total = 0, offset = 0;
+    size_t j = 0, lo, hi, mid;
+    streamed_t *m;
+    int have64 = FALSE, error = PK_COOL;
+
+    while (memcmp(G.sig, central_hdr_sig, 4) == 0) {
+        if (process_cdir_file_hdr() != PK_COOL ||
+            do_string_read_filename(G.crec.filename_length, 0) > PK_WARN ||
+            do_string_extra_field(G.crec.extra_field_length) > PK_WARN)
+            goto ended;
+        stream_skip((off_t) G.crec.file_comment_length);
+
+        /* its member:  usually the next one in the list */
+        m = NULL;
+        if (j < list->num && list->m[j].offset ==
+                                 (off_t) G.crec.relative_offset_local_header)
+            m = &list->m[j];
+        for (lo = 0, hi = list->num; m == NULL && lo < hi;) {
+            mid = lo + (hi - lo) / 2;
+            if (list->m[mid].offset <
+                (off_t) G.crec.relative_offset_local_header)
+                lo = mid + 1;
+            else if (list->m[mid].offset >
+                     (off_t) G.crec.relative_offset_local_header)
+                hi = mid;
+            else
+                m = &list->m[mid];
         }
-    } /* end for-loop (i:  files in current block) */
+        if (m == NULL) {
+            Info(slide, 1,
+                 ((char *) slide, StreamCentNotFound, G.zipfn,
+                  FnFilter1(G.filename)));
+            error = PK_WARN;
+        } else {
+            if (m->crc != G.crec.crc32 || m->csize != G.crec.csize ||
+                m->ucsize != G.crec.ucsize) {
+                Info(slide, 1,
+                     ((char *) slide, StreamCentDiffers, G.zipfn,
+                      FnFilter1(G.filename)));
+                error = PK_WARN;
+            }
+            j = (size_t) (m - list->m) + 1;
+        }
+        n++;
+        if (readbuf(G.sig, 4) != 4)
+            goto ended;
+    }
+    if (n != list->num) {
+        Info(slide, 1,
+             ((char *) slide, StreamCentCount, G.zipfn,
+              format_off_t((off_t) list->num, NULL, "u"),
+              format_off_t((off_t) n, NULL, "u")));
+        error = PK_WARN;
+    }
 
-    return error_in_archive;
+    if (memcmp(G.sig, end_central64_sig, 4) == 0) {
+        if (readbuf((char *) rec + 4, ECREC64_SIZE) != ECREC64_SIZE)
+            goto ended;
+        /* its size does not count the signature and the size itself */
+        stream_skip((off_t) makeint64(rec + ECREC64_LENGTH) -
+                    (ECREC64_SIZE - 8));
+        total = makeint64(rec + TOTAL_ENTRIES_CENTRAL_DIR64);
+        offset = makeint64(rec + OFFSET_START_CENTRAL_DIRECT64);
+        have64 = TRUE;
+        if (readbuf(G.sig, 4) != 4)
+            goto ended;
+        if (memcmp(G.sig, end_centloc64_sig, 4) == 0 &&
+            (readbuf((char *) rec, ECLOC64_SIZE) != ECLOC64_SIZE ||
+             readbuf(G.sig, 4) != 4))
+            goto ended;
+    }
+    if (memcmp(G.sig, end_central_sig, 4) != 0) {
+        Info(slide, 1, ((char *) slide, EndSigMsg));
+        return PK_WARN;
+    }
+    if (readbuf((char *) rec + 4, ECREC_SIZE) != ECREC_SIZE)
+        goto ended;
+    if (!have64) {
+        total = makeint16(rec + TOTAL_ENTRIES_CENTRAL_DIR);
+        offset = makeint32(rec + OFFSET_START_CENTRAL_DIRECTORY);
+    }
+    if (total != n || offset != (uint64_t) cdstart) {
+        Info(slide, 1, ((char *) slide, StreamEndDiffers, G.zipfn));
+        error = PK_WARN;
+    }
+    return error;
+
+ended:
+    Info(slide, 1, ((char *) slide, StreamEnded, G.zipfn));
+    return PK_EOF;
 }
 
 static int extract_or_test_member(void) /* return PK-type error code */
 {
     char *nul = "[empty] ", *txt = "[text]  ", *bin = "[binary]";
-    register int b;
+    unsigned n;
     int r, error = PK_COOL;
 
     /*---------------------------------------------------------------------------
         Initialize variables, buffers, etc.
       ---------------------------------------------------------------------------*/
 
-    G.bits_left = 0;
-    G.bitbuf = 0L; /* unreduce and unshrink only */
-    G.zipeof = 0;
+    G.biteofs = 0; /* bit reader (see bitread.h) */
     G.newfile = TRUE;
     G.crc32val = CRCVAL_INITIAL;
 
@@ -1243,12 +1972,14 @@ static int extract_or_test_member(void) /* return PK-type error code */
         G.outfile = stdout;
     } else if (open_outfile())
         return PK_DISK;
+    select_flush();
 
     /*---------------------------------------------------------------------------
         Unpack the file.
       ---------------------------------------------------------------------------*/
 
     defer_leftover_input(); /* so NEXTBYTE bounds check will work */
+    pipe_start();           /* reader/writer threads for a large member */
     switch (G.lrec.compression_method) {
     case STORED:
         if (!G.UzO.tflag && QCOND2) {
@@ -1268,10 +1999,22 @@ static int extract_or_test_member(void) /* return PK-type error code */
         }
         G.outptr = redirSlide;
         G.outcnt = 0L;
-        while ((b = NEXTBYTE) != EOF) {
-            *G.outptr++ = (uint8_t) b;
-            if (++G.outcnt == WSIZE) {
-                error = flush(redirSlide, G.outcnt, 0);
+        /* copy whole runs of the input buffer rather than going through
+           NEXTBYTE:  the bounds are checked once per run, not per byte */
+        for (;;) {
+            if (G.incnt <= 0) {
+                if (readbyte() == EOF) /* refill (and decrypt) */
+                    break;
+                G.inptr--; /* put it back */
+                G.incnt++;
+            }
+            n = MIN((unsigned) G.incnt, WSIZE - (unsigned) G.outcnt);
+            memcpy(G.outptr, G.inptr, n);
+            G.inptr += n;
+            G.incnt -= (int) n;
+            G.outptr += n;
+            if ((G.outcnt += n) == WSIZE) {
+                error = FLUSH(G.outcnt);
                 G.outptr = redirSlide;
                 G.outcnt = 0L;
                 if (error != PK_COOL || G.disk_full)
@@ -1279,7 +2022,7 @@ static int extract_or_test_member(void) /* return PK-type error code */
             }
         }
         if (G.outcnt) { /* flush final (partial) buffer */
-            r = flush(redirSlide, G.outcnt, 0);
+            r = FLUSH(G.outcnt);
             if (error < r)
                 error = r;
         }
@@ -1376,7 +2119,6 @@ static int extract_or_test_member(void) /* return PK-type error code */
                 printf("\n");
             }
         }
-#define UZinflate inflate
         if ((r = UZinflate((G.lrec.compression_method == ENHDEFLATED))) == 0) {
             break;
         }
@@ -1423,27 +2165,96 @@ static int extract_or_test_member(void) /* return PK-type error code */
         error = PK_ERR;
         break;
 
+    case LZMAED:
+        if (!G.UzO.tflag && QCOND2) {
+            printf(ExtractMsg, "unlzma", FnFilter1(G.filename));
+            if (G.UzO.aflag == 1) {
+                printf("%s", G.lrec.ucsize == 0L
+                                 ? nul
+                                 : (G.pInfo->textfile ? txt : bin));
+            }
+            if (G.UzO.cflag) {
+                printf("\n");
+            }
+        }
+        if ((r = unlzma()) == 0) {
+            break;
+        }
+        if (r >= PK_DISK) {
+            error = r;
+            break;
+        }
+        if ((G.UzO.tflag && G.UzO.qflag) || (!G.UzO.tflag && !QCOND2))
+            Info(slide, 1,
+                 ((char *) slide, ErrUnzipFile, InvalidComprData, Unlzma,
+                  FnFilter1(G.filename)));
+        else
+            Info(slide, 1,
+                 ((char *) slide, ErrUnzipNoFile, InvalidComprData, Unlzma));
+        error = PK_ERR;
+        break;
+
+#ifdef USE_ZSTD
+    case ZSTDED:
+        if (!G.UzO.tflag && QCOND2) {
+            printf(ExtractMsg, "unzstd", FnFilter1(G.filename));
+            if (G.UzO.aflag == 1) {
+                printf("%s", G.lrec.ucsize == 0L
+                                 ? nul
+                                 : (G.pInfo->textfile ? txt : bin));
+            }
+            if (G.UzO.cflag) {
+                printf("\n");
+            }
+        }
+        if ((r = UZunzstd()) == 0) {
+            break;
+        }
+        if (r >= PK_DISK) {
+            error = r;
+            break;
+        }
+        if ((G.UzO.tflag && G.UzO.qflag) || (!G.UzO.tflag && !QCOND2))
+            Info(slide, 1,
+                 ((char *) slide, ErrUnzipFile, InvalidComprData, Unzstd,
+                  FnFilter1(G.filename)));
+        else
+            Info(slide, 1,
+                 ((char *) slide, ErrUnzipNoFile, InvalidComprData, Unzstd));
+        error = PK_ERR;
+        break;
+#endif /* USE_ZSTD */
+
     default: /* should never get to this point */
         Info(slide, 1,
              ((char *) slide, FileUnknownCompMethod, FnFilter1(G.filename)));
         /* close and delete file before return? */
+        (void) pipe_stop();
+        (void) unmap_output();
         undefer_input();
         return PK_WARN;
 
     } /* end switch (compression method) */
 
+    if (G.streamlost && G.pInfo->encrypted && !G.pInfo->aes)
+        restore_input(); /* what follows the data, still encrypted */
+
+    if ((r = pipe_stop()) > error) /* output still queued is written here */
+        error = r;
+    if ((r = unmap_output()) > error) /* output file mapped as the window */
+        error = r;
+
     /*---------------------------------------------------------------------------
         Close the file and set its date and time (not necessarily in that
       order), and make sure the CRC checked out OK.  Logical-AND the CRC for
       64-bit machines (redundant on 32-bit machines).
       ---------------------------------------------------------------------------*/
 
-    if (!G.UzO.tflag && !G.UzO.cflag) /* don't close NULL file or stdout */
-        close_outfile();
+    /* don't close NULL file or stdout */
+    if (!G.UzO.tflag && !G.UzO.cflag && (r = close_outfile()) > error)
+        error = r;
 
-    /* GRR: CONVERT close_outfile() TO NON-VOID:  CHECK FOR ERRORS! */
-
-    if (G.disk_full) { /* set by flush() */
+    if (G.disk_full) { /* set by the output sink */
         if (G.disk_full > 1) {
             /* delete the incomplete file if we can */
             if (unlink(G.filename) != 0)
@@ -1460,7 +2271,22 @@ static int extract_or_test_member(void) /* return PK-type error code */
         undefer_input();
         return error;
     }
-    if (G.crc32val != G.lrec.crc32) {
+    if (G.streamlost) { /* the CRC and sizes come after the data */
+        undefer_input();
+        if ((r = stream_descriptor()) != PK_COOL)
+            return r;
+    } else if (G.streamdescr) { /* only the CRC comes after the data */
+        undefer_input();
+        if ((r = stream_sized_descriptor()) > error)
+            error = r;
+    }
+    if (G.pInfo->aes && aes_authenticate() != 0) {
+        if ((G.UzO.tflag && G.UzO.qflag) || (!G.UzO.tflag && !QCOND2))
+            Info(slide, 1, ((char *) slide, "%-22s ", FnFilter1(G.filename)));
+        Info(slide, 1, ((char *) slide, BadAESMac));
+        error = PK_ERR;
+    } else if (G.crc32val != G.lrec.crc32 &&
+               !(G.pInfo->aes && G.pInfo->aes_v2)) { /* AE-2:  no CRC */
         /* if quiet enough, we haven't output the filename yet:  do it */
         if ((G.UzO.tflag && G.UzO.qflag) || (!G.UzO.tflag && !QCOND2))
             Info(slide, 1, ((char *) slide, "%-22s ", FnFilter1(G.filename)));
@@ -1482,7 +2308,7 @@ static int extract_or_test_member(void) /* return PK-type error code */
 
     undefer_input();
 
-    if ((G.lrec.general_purpose_bit_flag & 8) != 0) {
+    if ((G.lrec.general_purpose_bit_flag & 8) != 0 && !G.zipstream) {
         /* skip over data descriptor (harder than it sounds, due to signature
          * ambiguity)
          */
@@ -1513,6 +2339,24 @@ static int extract_or_test_member(void) /* return PK-type error code */
     return error;
 }
 
+/* WinZip AES:  hash whatever of the member's data the method left unread,
+   then read the authentication code that follows them and check it.
+   Returns 0 if it matches. */
+static int aes_authenticate()
+{
+    uint8_t mac[AES_MACLEN];
+
+    while (G.csize > 0 && fillinbuf() > 0)
+        ;
+    if (G.incnt > 0) /* hashed when it was read */
+        G.inptr += G.incnt;
+    G.incnt = 0;
+    undefer_input(); /* back to where the code starts */
+    if (readbuf((char *) mac, AES_MACLEN) != AES_MACLEN)
+        return 1;
+    return aes_check_mac(mac);
+}
+
 static int TestExtraField(uint8_t *ef, unsigned ef_len)
 {
     uint16_t ebID;
@@ -1724,6 +2568,7 @@ int memextract(uint8_t *tgt, uint32_t tgtsize, const uint8_t *src,
     off_t old_csize = G.csize;
     uint8_t *old_inptr = G.inptr;
     int old_incnt = G.incnt;
+    FlushFn *old_flush = G.flush;
     int r, error = PK_OK;
     uint16_t method;
     uint32_t extra_field_crc;
@@ -1735,6 +2580,7 @@ int memextract(uint8_t *tgt, uint32_t tgtsize, const uint8_t *src,
     G.inptr = (uint8_t *) src + (2 + 4); /* method and extra_field_crc */
     G.incnt = (int) (G.csize = (long) (srcsize - (2 + 4)));
     G.mem_mode = TRUE;
+    G.flush = memflush;
     G.outbufptr = tgt;
     G.outsize = tgtsize;
 
@@ -1770,6 +2616,7 @@ int memextract(uint8_t *tgt, uint32_t tgtsize, const uint8_t *src,
     G.incnt = old_incnt;
     G.csize = old_csize;
     G.mem_mode = FALSE;
+    G.flush = old_flush;
 
     if (!error) {
         register uint32_t crcval =
@@ -1789,7 +2636,8 @@ int memextract(uint8_t *tgt, uint32_t tgtsize, const uint8_t *src,
     return error;
 }
 
-int memflush(const uint8_t *rawbuf, uint32_t size)
+/* output sink for memextract() */
+int memflush(uint8_t *rawbuf, uint32_t size)
 {
     if (size > G.outsize)
         /* Here, PK_DISK is a bit off-topic, but in the sense of marking
@@ -1919,6 +2767,12 @@ int UZbunzip2(void)
         Trace((stderr, "UZbunzip2() got empty input\n"));
         return 2;
     }
+#ifdef USE_PIPELINE
+    /* a large member is decoded a block per thread (see bzpar.c) */
+    if ((retval = UZbunzip2_par()) >= 0)
+        return retval;
+    retval = 0;
+#endif
 
     bstrm.next_out = (char *) redirSlide;
     bstrm.avail_out = WSIZE;
@@ -1941,9 +2795,11 @@ int UZbunzip2(void)
     else if (err != BZ_OK)
         Trace((stderr, "oops!  (BZ2_bzDecompressInit() err = %d)\n", err));
 
-    while (G.csize > 0) {
+    /* in a stream, the member's data may end before G.csize does (see
+       extract_or_test_stream()):  at the end of the bzip2 stream */
+    while (G.csize > 0 && err != BZ_STREAM_END) {
         Trace((stderr, "first loop:  G.csize = %ld\n", G.csize));
-        while (bstrm.avail_out > 0) {
+        while (bstrm.avail_out > 0 && err != BZ_STREAM_END) {
             err = BZ2_bzDecompress(&bstrm);
 
             if (err == BZ_DATA_ERROR) {
@@ -2016,7 +2872,7 @@ int UZbunzip2(void)
 #endif
 
     G.inptr = (uint8_t *) bstrm.next_in;
-    G.incnt -= G.inptr - G.inbuf; /* reset for other routines */
+    G.incnt = (int) bstrm.avail_in; /* reset for other routines */
 
 uzbunzip_cleanup_exit:
     err = BZ2_bzDecompressEnd(&bstrm);
@@ -2025,3 +2881,66 @@ uzbunzip_cleanup_exit:
 
     return retval;
 }
+
+#ifdef USE_ZSTD
+/* decompress a Zstandard entry (one or more frames) using libzstd */
+int UZunzstd(void)
+{
+    int retval = 0; /* return code: 0 = "no error" */
+    size_t err = 1; /* 0 once a frame is complete */
+    ZSTD_DStream *zds;
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+
+    if ((zds = ZSTD_createDStream()) == NULL)
+        return 3;
+    if (ZSTD_isError(ZSTD_initDStream(zds))) {
+        retval = 3;
+        goto unzstd_cleanup_exit;
+    }
+
+    in.src = G.inptr;
+    in.size = G.incnt > 0 ? (size_t) G.incnt : 0;
+    in.pos = 0;
+    out.dst = redirSlide;
+    out.size = WSIZE;
+    out.pos = 0;
+
+    for (;;) {
+        err = ZSTD_decompressStream(zds, &out, &in);
+        if (ZSTD_isError(err)) {
+            Trace((stderr, "UZunzstd:  %s\n", ZSTD_getErrorName(err)));
+            retval = 2;
+            goto unzstd_cleanup_exit;
+        }
+        if (err == 0 && G.streamlost) /* in a stream, one frame is all */
+            break;
+        if (out.pos == out.size) { /* flush slide[] and go on */
+            if ((retval = FLUSH(out.pos)) != 0)
+                goto unzstd_cleanup_exit;
+            out.pos = 0;
+            continue;
+        }
+        if (in.pos == in.size) { /* all output for this input is out */
+            if (G.csize <= 0L || fillinbuf() == 0)
+                break;
+            in.src = G.inptr;
+            in.size = (size_t) G.incnt;
+            in.pos = 0;
+        }
+    }
+    G.inptr = (uint8_t *) in.src + in.pos;
+    G.incnt = (int) (in.size - in.pos);
+
+    if (out.pos && (retval = FLUSH(out.pos)) != 0)
+        goto unzstd_cleanup_exit;
+    if (err != 0) { /* input ended in the middle of a frame */
+        Trace((stderr, "UZunzstd:  truncated frame\n"));
+        retval = 2;
+    }
+
+unzstd_cleanup_exit:
+    ZSTD_freeDStream(zds);
+    return retval;
+}
+#endif /* USE_ZSTD */
@@ -15,6 +15,7 @@
 #include "unzip.h"
 #include "crc32.h"
 #include "crypt.h"
+#include "aescrypt.h"
 #include "ttyio.h"
 
 /* setup of codepage conversion for decryption passwords */
@@ -26,13 +27,83 @@
 #endif
 #include "ebcdic.h" /* definition/initialization of ebcdic[] */
 
+#ifdef __SSE2__
+#include <emmintrin.h> /* eol_scan() looks at 16 bytes at a time */
+#endif
+#ifdef USE_PIPELINE
+#include <pthread.h>
+#endif
+#include <poll.h>
+#ifdef HAVE_INOTIFY_INIT1
+#include <sys/inotify.h>
+#endif
+
 #define WriteError(buf, len, strm)                                   \
     ((size_t) write(fileno(strm), (char *) (buf), (size_t) (len)) != \
      (size_t) (len))
 
 #define WriteTxtErr(buf, len, strm) WriteError(buf, len, strm)
 
+static uint8_t *eol_scan(uint8_t *p, uint8_t *end);
+static uint8_t *eol_convert(uint8_t *rawbuf, uint32_t size, uint8_t **pend);
+static int flush_test(uint8_t *rawbuf, uint32_t size);
+static int flush_binary(uint8_t *rawbuf, uint32_t size);
+static int flush_mapped(uint8_t *rawbuf, uint32_t size);
+static int flush_text(uint8_t *rawbuf, uint32_t size);
+static int flush_stdout(uint8_t *rawbuf, uint32_t size);
+static int flush_stdout_text(uint8_t *rawbuf, uint32_t size);
 static int disk_error(void);
+static int write_failed(void);
+static int vol_read(uint8_t *buf, unsigned len);
+static int map_output(void);
+static void fill_output(void);
+#ifdef USE_PIPELINE
+static int read_inbuf(void);
+static int pipe_write(uint8_t *buf, unsigned len);
+#else
+#define read_inbuf() zip_read(G.inbuf, INBUFSIZ)
+#endif
+
+#define MAPMIN  0x100000L /* smallest member inflated into a mapped file */
+#define MAPFILL 0x400000L /* mapped output faulted in at a time */
+
+#define FOLLOWPOLL 500 /* ms between looks at a followed zipfile (-F) */
+
+#ifdef USE_PIPELINE
+#define PIPESLOTS 8         /* entries per queue (power of two) */
+#define PIPEREAD  0x10000   /* bytes per read() in the reader thread */
+#define PIPEMIN   0x100000L /* smallest member worth the extra threads */
+
+typedef struct pipeblk {
+    uint8_t *buf;
+    long len; /* bytes at buf (reader:  the read() result) */
+} pipeblk;
+
+/* single-producer/single-consumer queue:  head is advanced only by the
+   producer, tail only by the consumer */
+typedef struct pipeq {
+    pipeblk blk[PIPESLOTS];
+    unsigned head;  /* next entry to fill */
+    unsigned tail;  /* next entry to drain */
+    int closed;     /* no more entries (or:  producer, stop) */
+    int sleepers;   /* threads blocked in pipeq_wait() */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int running;    /* thread was started */
+} pipeq;
+
+struct pipeline {
+    pipeq in;       /* reader thread -> read_inbuf() */
+    pipeq out;      /* flush_window() -> writer thread */
+    long used;      /* bytes of in.blk[in.tail] already handed out */
+    off_t left;     /* compressed bytes the reader still has to fetch */
+    uint8_t *bufs;  /* PIPESLOTS reader buffers of PIPEREAD bytes */
+    int status;     /* worst output sink return so far */
+    int err;        /* errno of the write that failed, if one did */
+    int asked;      /* disk_error() was called about it */
+};
+#endif /* USE_PIPELINE */
 
 static const char CannotOpenZipfile[] =
     "error:  cannot open zipfile [ %s ]\n        %s\n";
@@ -184,7 +255,7 @@ register unsigned size;
     n = size;
     while (size) {
         if (G.incnt <= 0) {
-            if ((G.incnt = read(G.zipfd, (char *) G.inbuf, INBUFSIZ)) == 0)
+            if ((G.incnt = read_inbuf()) == 0)
                 return (n - size);
             else if (G.incnt < 0) {
                 /* another hack, but no real harm copying same thing twice */
@@ -217,7 +288,7 @@ int readbyte()
         return EOF;
     }
     if (G.incnt <= 0) {
-        if ((G.incnt = read(G.zipfd, (char *) G.inbuf, INBUFSIZ)) == 0) {
+        if ((G.incnt = read_inbuf()) == 0) {
             return EOF;
         } else if (G.incnt < 0) { /* "fail" (abort, retry, ...) returns this */
             /* another hack, but no real harm copying same thing twice */
@@ -232,15 +303,14 @@ int readbyte()
     }
 
     if (G.pInfo->encrypted) {
-        uint8_t *p;
-        int n;
-
         /* This was previously set to decrypt one byte beyond G.csize, when
          * incnt reached that far.  GRR said, "but it's required:  why?"  This
          * was a bug in fillinbuf() -- was it also a bug here?
          */
-        for (n = G.incnt, p = G.inptr; n--; p++)
-            zdecode(*p);
+        if (G.pInfo->aes)
+            aes_decrypt_buffer(G.inptr, (unsigned) G.incnt);
+        else
+            decrypt_input((unsigned) G.incnt);
     }
 
     --G.incnt;
@@ -251,18 +321,17 @@ int readbyte()
 int fillinbuf()
 {
     if (G.mem_mode ||
-        (G.incnt = read(G.zipfd, (char *) G.inbuf, INBUFSIZ)) <= 0)
+        (G.incnt = read_inbuf()) <= 0)
         return 0;
     G.cur_zipfile_bufstart += INBUFSIZ; /* always starts on a block boundary */
     G.inptr = G.inbuf;
     defer_leftover_input(); /* decrements G.csize */
 
     if (G.pInfo->encrypted) {
-        uint8_t *p;
-        int n;
-
-        for (n = G.incnt, p = G.inptr; n--; p++)
-            zdecode(*p);
+        if (G.pInfo->aes) /* the whole buffer in one go */
+            aes_decrypt_buffer(G.inptr, (unsigned) G.incnt);
+        else
+            decrypt_input((unsigned) G.incnt);
     }
 
     return G.incnt;
@@ -301,7 +370,7 @@ off_t abs_offset;
         Trace((stderr, "fpos_zip: abs_offset = %s, G.extra_bytes = %s\n",
                format_off_t(abs_offset, NULL, NULL),
                format_off_t(G.extra_bytes, NULL, NULL)));
-        G.cur_zipfile_bufstart = lseek(G.zipfd, bufstart, SEEK_SET);
+        G.cur_zipfile_bufstart = zip_lseek(bufstart, SEEK_SET);
         Trace((stderr,
                "       request = %s, (abs+extra) = %s, inbuf_offset = %s\n",
                format_off_t(request, NULL, NULL),
@@ -310,7 +379,7 @@ off_t abs_offset;
         Trace((stderr, "       bufstart = %s, cur_zipfile_bufstart = %s\n",
                format_off_t(bufstart, NULL, NULL),
                format_off_t(G.cur_zipfile_bufstart, NULL, NULL)));
-        if ((G.incnt = read(G.zipfd, (char *) G.inbuf, INBUFSIZ)) <= 0)
+        if ((G.incnt = zip_read(G.inbuf, INBUFSIZ)) <= 0)
             return (PK_EOF);
         G.incnt -= (int) inbuf_offset;
         G.inptr = G.inbuf + (int) inbuf_offset;
@@ -321,100 +390,447 @@ off_t abs_offset;
     return (PK_OK);
 }
 
-int flush(rawbuf, size, unshrink)
-uint8_t *rawbuf;
-uint32_t size;
-int unshrink;
+/* read(G.zipfd, buf, len), except that after recover_cdir() the central
+   directory it rebuilt (G.rcd) seems to follow the end of the zipfile, and
+   that a stream (see do_stream()) fills buf unless it ends, counting what
+   it has read in G.ziplen; one that is followed (-F) returns what there is
+   so far, waiting only if there is nothing */
+int zip_read(buf, len)
+uint8_t *buf;
+unsigned len;
 {
-    register uint8_t *p;
-    register uint8_t *q;
-    uint8_t *transbuf;
+    off_t pos;
+    size_t k;
+    int n = 0, r = 0;
+
+    if (G.zipstream) {
+        while ((unsigned) n < len) {
+            if ((r = read(G.zipfd, (char *) buf + n, len - n)) > 0)
+                n += r;
+            else if (r == 0 && n == 0 && G.zipfollow &&
+                     follow_wait(G.ziplen) == 0)
+                continue; /* it has grown */
+            else if (r == 0 || errno != EINTR)
+                break;
+        }
+        if (n == 0 && r < 0)
+            return r;
+        G.ziplen += n;
+        return n;
+    }
+    if (G.rcd == NULL)
+        return vol_read(buf, len);
+    if ((pos = zip_lseek(0, SEEK_CUR)) < 0)
+        return -1;
+    if (pos < G.ziplen) {
+        n = vol_read(buf, (unsigned) MIN(len, G.ziplen - pos));
+        if (n < 0)
+            return n;
+    }
+    pos += n;
+    if ((unsigned) n < len && pos >= G.ziplen &&
+        (size_t) (pos - G.ziplen) < G.rcdlen) {
+        k = MIN(len - n, G.rcdlen - (size_t) (pos - G.ziplen));
+        memcpy(buf + n, G.rcd + (pos - G.ziplen), k);
+        n += (int) k;
+        zip_lseek(pos + k, SEEK_SET);
+    }
+    return n;
+}
 
-    /*---------------------------------------------------------------------------
-        Compute the CRC first; if testing or if disk is full, that's it.
-      ---------------------------------------------------------------------------*/
+/* read(G.zipfd, buf, len), or the same from the files of a split archive
+   (see find_volumes() in process.c), as if they were one:  a read that
+   gets to the end of one goes on in the next one.  Every one of them is
+   kept open, and read with pread() at G.volpos. */
+static int vol_read(buf, len)
+uint8_t *buf;
+unsigned len;
+{
+    zipvol *v;
+    ssize_t r = 0;
+    unsigned n = 0;
+
+    if (G.nvol == 0)
+        return read(G.zipfd, (char *) buf, len);
+    while (n < len) {
+        while (G.volcur + 1 < G.nvol &&
+               G.volpos >= G.vol[G.volcur].start + G.vol[G.volcur].size)
+            G.volcur++;
+        while (G.volcur > 0 && G.volpos < G.vol[G.volcur].start)
+            G.volcur--;
+        v = &G.vol[G.volcur];
+        if (G.volpos >= v->start + v->size) /* the end of the last one */
+            break;
+        r = pread(v->fd, buf + n,
+                  (size_t) MIN(len - n, v->start + v->size - G.volpos),
+                  G.volpos - v->start);
+        if (r > 0) {
+            n += (unsigned) r;
+            G.volpos += r;
+        } else if (r == 0 || errno != EINTR)
+            break;
+    }
+    return n == 0 && r < 0 ? -1 : (int) n;
+}
 
-    G.crc32val = crc32(G.crc32val, rawbuf, (size_t) size);
+/* lseek(G.zipfd, ofs, whence), for a split archive as well */
+off_t zip_lseek(ofs, whence)
+off_t ofs;
+int whence;
+{
+    if (G.nvol == 0)
+        return lseek(G.zipfd, ofs, whence);
+    if (whence == SEEK_CUR)
+        ofs += G.volpos;
+    else if (whence == SEEK_END)
+        ofs += G.vol[G.nvol - 1].start + G.vol[G.nvol - 1].size;
+    if (ofs < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return G.volpos = ofs;
+}
 
-    if (G.UzO.tflag || size == 0L) /* testing or nothing to write:  all done */
-        return PK_OK;
+/* Close the zipfile, and all the other files of a split archive. */
+void close_infile()
+{
+    unsigned i;
+
+    for (i = 0; i + 1 < G.nvol; i++)
+        close(G.vol[i].fd);
+    free(G.vol);
+    G.vol = NULL;
+    G.nvol = 0;
+    close(G.zipfd);
+}
 
-    if (G.disk_full)
-        return PK_DISK; /* disk already full:  ignore rest of file */
+/* In follow mode (-F), wait until the zipfile is longer than len bytes,
+   as it is still being written.  inotify wakes us up when a local process
+   writes to it; the writer may be on another host of a network file
+   system, though, so it is looked at every FOLLOWPOLL ms anyway.  Returns
+   -1 if it will not grow:  it was deleted, or cut back to len or less. */
+int follow_wait(len)
+off_t len;
+{
+    struct stat st;
+    struct pollfd p;
+#ifdef HAVE_INOTIFY_INIT1
+    char ev[sizeof(struct inotify_event) + 256]; /* and some name */
+
+    if (G.followfd == -1) { /* first time:  -2 if inotify cannot be used */
+        if ((G.followfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+            G.followfd = -2;
+        else if (inotify_add_watch(G.followfd, G.zipfn,
+                                   IN_MODIFY | IN_CLOSE_WRITE |
+                                       IN_DELETE_SELF) < 0) {
+            close(G.followfd); /* e.g. "-" */
+            G.followfd = -2;
+        }
+    }
+#endif
+    p.fd = G.followfd;
+    p.events = POLLIN;
+    for (;;) {
+        if (fstat(G.zipfd, &st) != 0 || st.st_size < len)
+            return -1;
+        if (st.st_size > len)
+            return 0;
+        if (st.st_nlink == 0)
+            return -1;
+        Trace((stderr, "follow_wait:  %s has %s bytes\n", FnFilter1(G.zipfn),
+               format_off_t(len, NULL, NULL)));
+        if (poll(&p, p.fd >= 0 ? 1 : 0, FOLLOWPOLL) < 0 && errno != EINTR)
+            return -1;
+#ifdef HAVE_INOTIFY_INIT1
+        while (p.fd >= 0 && read(p.fd, ev, sizeof(ev)) > 0)
+            ; /* we only care that something happened */
+#endif
+    }
+}
 
-    /*---------------------------------------------------------------------------
-        Write the bytes rawbuf[0..size-1] to the output device, first converting
-        end-of-lines and ASCII/EBCDIC as needed.  If SMALL_MEM or MED_MEM are
-      NOT defined, outbuf is assumed to be at least as large as rawbuf and is
-      not necessarily checked for overflow.
-      ---------------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------
+    Return a pointer to the first CR or ^Z in [p, end), or end if there is
+    none.  Everything before it can be copied through the text-mode
+    conversion in eol_convert() unchanged.  SSE2 compares 16 bytes per step;
+    elsewhere a word-at-a-time test does 8.
+  ---------------------------------------------------------------------------*/
 
-    if (!G.pInfo->textmode) { /* write raw binary data */
-        /* GRR:  note that for standard MS-DOS compilers, size argument to
-         * fwrite() can never be more than 65534, so WriteError macro will
-         * have to be rewritten if size can ever be that large.  For now,
-         * never more than 32K.  Also note that write() returns an int, which
-         * doesn't necessarily limit size to 32767 bytes if write() is used
-         * on 16-bit systems but does make it more of a pain; however, because
-         * at least MSC 5.1 has a lousy implementation of fwrite() (as does
-         * DEC Ultrix cc), write() is used anyway.
-         */
-        if (!G.UzO.cflag && WriteError(rawbuf, size, G.outfile))
-            return disk_error();
-        return PK_OK;
+static uint8_t *eol_scan(p, end)
+uint8_t *p;
+uint8_t *end;
+{
+#ifdef __SSE2__
+    const __m128i cr = _mm_set1_epi8(CR);
+    const __m128i ctrlz = _mm_set1_epi8(CTRLZ);
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) p);
+        int hits = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, ctrlz)));
+
+        if (hits)
+            return p + __builtin_ctz((unsigned) hits);
+        p += 16;
     }
-    if (unshrink) {
-        /* rawbuf = outbuf */
-        transbuf = G.outbuf2;
-    } else {
-        /* rawbuf = slide */
-        transbuf = G.outbuf;
+#else
+#define ONES      0x0101010101010101ULL
+#define HASZERO(v) (((v) - ONES) & ~(v) & (ONES << 7))
+    while (end - p >= 8) {
+        uint64_t w;
+
+        memcpy(&w, p, 8);
+        if (HASZERO(w ^ (ONES * CR)) | HASZERO(w ^ (ONES * CTRLZ)))
+            break; /* the byte loop below finds it */
+        p += 8;
     }
+#undef HASZERO
+#undef ONES
+#endif
+    while (p < end && *p != CR && *p != CTRLZ)
+        ++p;
+    return p;
+}
+
+/*---------------------------------------------------------------------------
+    Convert rawbuf[0..size-1] to native (LF) end-of-lines.  Algorithm:
+    CR/LF => native; lone CR => native; lone LF => native; ^Z is dropped.
+    This is only for stream-oriented files, not record-oriented ones.  Since
+    native is LF, only CRs and ^Zs need attention:  the runs of bytes between
+    them are copied as they are into G.outbuf (G.outbuf2 if rawbuf is
+    G.outbuf, i.e. for unshrink), and a buffer without any is returned in
+    place.  Returns the start of the converted data and its end in *pend.
+  ---------------------------------------------------------------------------*/
+
+static uint8_t *eol_convert(rawbuf, size, pend)
+uint8_t *rawbuf;
+uint32_t size;
+uint8_t **pend;
+{
+    uint8_t *p, *q, *r, *end, *transbuf;
+
+    transbuf = rawbuf == G.outbuf ? G.outbuf2 : G.outbuf;
     if (G.newfile) {
         G.didCRlast = FALSE; /* no previous buffers written */
         G.newfile = FALSE;
     }
 
-    /*-----------------------------------------------------------------------
-        Algorithm:  CR/LF => native; lone CR => native; lone LF => native.
-        This routine is only for non-raw-VMS, non-raw-VM/CMS files (i.e.,
-        stream-oriented files, not record-oriented).
-      -----------------------------------------------------------------------*/
-
     p = rawbuf;
+    end = rawbuf + size;
     if (*p == LF && G.didCRlast)
         ++p;
     G.didCRlast = FALSE;
-    for (q = transbuf; (size_t) (p - rawbuf) < (size_t) size; ++p) {
-        if (*p == CR) { /* lone CR or CR/LF: treat as EOL  */
+    if ((r = eol_scan(p, end)) == end) { /* nothing to convert */
+        *pend = end;
+        return p;
+    }
+    for (q = transbuf;; p = r + 1, r = eol_scan(p, end)) {
+        memcpy(q, p, (size_t) (r - p));
+        q += r - p;
+        if (r == end)
+            break;
+        if (*r == CR) { /* lone CR or CR/LF: treat as EOL  */
             *q++ = LF;
-            if ((size_t) (p - rawbuf) == (size_t) size - 1)
-                /* last char in buffer */
+            if (r == end - 1) /* last char in buffer */
                 G.didCRlast = TRUE;
-            else if (p[1] == LF) /* get rid of accompanying LF */
-                ++p;
-        } else if (*p == LF) { /* lone LF */
-            *q++ = LF;
-        } else if (*p != CTRLZ) { /* lose all ^Z's */
-            *q++ = *p;
-        }
+            else if (r[1] == LF) /* get rid of accompanying LF */
+                ++r;
+        } /* else lose all ^Z's */
     }
+    Trace((stderr, "eol_convert:  size = %u   q - transbuf = %u\n", size,
+           (unsigned) (q - transbuf)));
+    *pend = q;
+    return transbuf;
+}
+
+/*---------------------------------------------------------------------------
+    Output sinks.  Each one computes the CRC of rawbuf[0..size-1] first and
+    then disposes of the bytes in its own way; select_flush() picks the one
+    that fits the current member before it is decompressed, so none of them
+    has to re-examine the options on every call.
+  ---------------------------------------------------------------------------*/
+
+void select_flush()
+{
+    if (G.UzO.tflag)
+        G.flush = flush_test;
+    else if (G.UzO.cflag)
+        G.flush = G.pInfo->textmode ? flush_stdout_text : flush_stdout;
+    else if (G.pInfo->textmode)
+        G.flush = flush_text;
+    else
+        G.flush = map_output() ? flush_mapped : flush_binary;
+}
+
+/* Inflating a large member to a file, use the file itself as the window:
+   map it at its full size (plus RINGROOM, for a window that runs past the
+   flush point) and make that G.ring.  inflate() then decodes straight into
+   the file, and matches copy from output already there, so the flush only
+   has to take the CRC; without this, every byte goes through a window in
+   memory and is copied again by write().  The file is cut to the length
+   flushed by unmap_output().  Returns TRUE if the output is mapped. */
+static int map_output()
+{
+    unsigned m = G.lrec.compression_method;
+    size_t len = (size_t) G.lrec.ucsize + RINGROOM;
+    uint8_t *map;
+
+    if ((m != DEFLATED && m != ENHDEFLATED) || G.symlnk ||
+        G.lrec.ucsize < MAPMIN || (uint64_t) (len - RINGROOM) != G.lrec.ucsize)
+        return FALSE; /* not inflated, re-read as a link, small or huge */
+    if ((map = map_outfile(G.outfile, len)) == NULL)
+        return FALSE;
+    Trace((stderr, "map_output:  %s mapped at %p\n", FnFilter1(G.filename),
+           map));
+    G.ring = map;
+    G.outmaplen = len;
+    G.outmapfill = 0;
+    fill_output();
+    return TRUE;
+}
+
+/* Fault in the next MAPFILL bytes of the mapped output file in one go,
+   which costs less than a page fault at a time as inflate() gets
+   there (flush_window() keeps it RINGROOM ahead). */
+static void fill_output()
+{
+    size_t n = MIN(MAPFILL, G.outmaplen - G.outmapfill);
+
+    fault_outfile(G.ring + G.outmapfill, n);
+    G.outmapfill += n;
+}
+
+/* Done with the current member:  if its output file was mapped, unmap it
+   and give it the length of the output flushed. */
+int unmap_output()
+{
+    int r;
+
+    if (G.outmaplen == 0)
+        return PK_OK;
+    r = unmap_outfile(G.outfile, G.ring, G.outmaplen, (off_t) G.wf);
+    G.ring = G.mirror;
+    G.outmaplen = 0;
+    return r != 0 ? disk_error() : PK_OK;
+}
+
+/* Hand the w bytes pending at WINDOW to the output sink and advance the
+   start of the ring past them (inflate() and explode()). */
+int flush_window(w)
+unsigned w;
+{
+    int r;
+
+#ifdef USE_PIPELINE
+    if (G.pipe != NULL && G.pipe->out.running)
+        r = pipe_write(WINDOW, w); /* the writer thread calls G.flush */
+    else
+#endif
+        r = (*G.flush)(WINDOW, (uint32_t) w);
+
+    if (G.outmaplen != 0) {
+        /* the mapped output file:  a member longer than its header says
+           would run off the end of the mapping */
+        if ((G.wf += w) > (size_t) G.lrec.ucsize && r == PK_OK)
+            r = PK_ERR;
+        if (G.wf + RINGROOM > G.outmapfill && G.outmapfill < G.outmaplen)
+            fill_output();
+    } else if (G.ring != NULL)
+        G.wf = (G.wf + w) & (RINGSIZ - 1);
+    return r;
+}
+
+/* -t:  nothing to write */
+static int flush_test(rawbuf, size)
+uint8_t *rawbuf;
+uint32_t size;
+{
+    G.crc32val = crc32(G.crc32val, rawbuf, (size_t) size);
+    return PK_OK;
+}
+
+/* the output is already in the mapped file (see map_output()) */
+static int flush_mapped(rawbuf, size)
+uint8_t *rawbuf;
+uint32_t size;
+{
+    G.crc32val = crc32(G.crc32val, rawbuf, (size_t) size);
+    return PK_OK;
+}
+
+/* write raw binary data to G.outfile */
+static int flush_binary(rawbuf, size)
+uint8_t *rawbuf;
+uint32_t size;
+{
+    G.crc32val = crc32(G.crc32val, rawbuf, (size_t) size);
+
+    if (size == 0L)
+        return PK_OK;
+    if (G.disk_full)
+        return PK_DISK; /* disk already full:  ignore rest of file */
+
+    /* GRR:  note that write() returns an int, which doesn't necessarily
+     * limit size to 32767 bytes if write() is used on 16-bit systems but
+     * does make it more of a pain; however, because at least MSC 5.1 has a
+     * lousy implementation of fwrite() (as does DEC Ultrix cc), write() is
+     * used anyway.
+     */
+    if (WriteError(rawbuf, size, G.outfile))
+        return write_failed();
+    return PK_OK;
+}
 
-    /*-----------------------------------------------------------------------
-        Done translating:  write whatever we've got to file (or screen).
-      -----------------------------------------------------------------------*/
-
-    Trace((stderr, "p - rawbuf = %u   q-transbuf = %u   size = %u\n",
-           (unsigned) (p - rawbuf), (unsigned) (q - transbuf), size));
-    if (q > transbuf) {
-        if (!G.UzO.cflag &&
-            WriteError(transbuf, (size_t) (q - transbuf), G.outfile))
-            return disk_error();
-        else if (G.UzO.cflag &&
-                 (*G.message)(transbuf, (uint32_t) (q - transbuf), 0))
-            return PK_OK;
+/* -a:  convert end-of-lines, then write to G.outfile */
+static int flush_text(rawbuf, size)
+uint8_t *rawbuf;
+uint32_t size;
+{
+    uint8_t *p, *end;
+    uint32_t n;
+
+    G.crc32val = crc32(G.crc32val, rawbuf, (size_t) size);
+
+    if (G.disk_full && size > 0L)
+        return PK_DISK;
+
+    /* the ring window may hand over more than outbuf can take at once */
+    for (; size > 0L; rawbuf += n, size -= n) {
+        n = MIN(size, OUTBUFSIZ);
+        p = eol_convert(rawbuf, n, &end);
+        if (end > p && WriteError(p, (size_t) (end - p), G.outfile))
+            return write_failed();
     }
+    return PK_OK;
+}
+
+/* -c/-p:  pass raw data to the screen (or pipe) */
+static int flush_stdout(rawbuf, size)
+uint8_t *rawbuf;
+uint32_t size;
+{
+    G.crc32val = crc32(G.crc32val, rawbuf, (size_t) size);
+
+    if (size > 0L)
+        (*G.message)(rawbuf, size, 0);
+    return PK_OK;
+}
+
+/* -c/-p with -a:  convert end-of-lines for the screen (or pipe) */
+static int flush_stdout_text(rawbuf, size)
+uint8_t *rawbuf;
+uint32_t size;
+{
+    uint8_t *p, *end;
+    uint32_t n;
 
+    G.crc32val = crc32(G.crc32val, rawbuf, (size_t) size);
+
+    for (; size > 0L; rawbuf += n, size -= n) {
+        n = MIN(size, OUTBUFSIZ);
+        p = eol_convert(rawbuf, n, &end);
+        if (end > p)
+            (*G.message)(p, (uint32_t) (end - p), 0);
+    }
     return PK_OK;
 }
 
@@ -432,6 +848,305 @@ static int disk_error(void)
     return PK_DISK;
 }
 
+/* A write to G.outfile failed.  On the writer thread (see pipe_writer()),
+   only say so:  the main thread asks what to do about it, as disk_error()
+   reads stdin and sets G.disk_full. */
+static int write_failed()
+{
+#ifdef USE_PIPELINE
+    if (G.pipe != NULL && G.pipe->out.running &&
+        pthread_equal(pthread_self(), G.pipe->out.thread))
+        return PK_DISK;
+#endif
+    return disk_error();
+}
+
+#ifdef USE_PIPELINE
+
+/*---------------------------------------------------------------------------
+    Pipelined extraction.  For a large member, pipe_start() hands the read()
+    calls behind readbyte() and fillinbuf() to a reader thread that fetches
+    compressed data ahead into PIPESLOTS buffers, and the output sink (CRC
+    and write) to a writer thread that drains the windows inflate() and
+    explode() pass to flush_window(), so the disk never waits for the
+    decoder or the other way around.  The writer reads straight from the
+    mirrored ring, which is why it needs G.ring; flush_window() only waits
+    when the undrained windows leave less than RINGROOM of it free.
+
+    The queues take no lock while there is work to do:  each index is
+    stored by one side only, and a side that finds its queue empty (or
+    full) sleeps on the condition variable, which the other side signals
+    only when it sees a sleeper.  Loads and stores of the shared fields are
+    sequentially consistent, so that check cannot miss a wakeup.
+  ---------------------------------------------------------------------------*/
+
+#define ALOAD(p)     __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define ASTORE(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+
+/* sleep until *idx moves away from val or the queue is closed */
+static void pipeq_wait(q, idx, val)
+pipeq *q;
+unsigned *idx;
+unsigned val;
+{
+    pthread_mutex_lock(&q->lock);
+    __atomic_add_fetch(&q->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (ALOAD(idx) == val && !ALOAD(&q->closed))
+        pthread_cond_wait(&q->cond, &q->lock);
+    __atomic_sub_fetch(&q->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void pipeq_wake(q)
+pipeq *q;
+{
+    if (ALOAD(&q->sleepers)) {
+        pthread_mutex_lock(&q->lock);
+        pthread_cond_broadcast(&q->cond);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+/* publish a new head or tail */
+static void pipeq_post(q, idx, val)
+pipeq *q;
+unsigned *idx;
+unsigned val;
+{
+    ASTORE(idx, val);
+    pipeq_wake(q);
+}
+
+static void pipeq_close(q)
+pipeq *q;
+{
+    ASTORE(&q->closed, 1);
+    pipeq_wake(q);
+}
+
+static void *pipe_reader(arg)
+void *arg;
+{
+    struct pipeline *P = (struct pipeline *) arg;
+    pipeq *q = &P->in;
+    unsigned head = q->head;
+    pipeblk *b;
+
+    while (P->left > 0 && !ALOAD(&q->closed)) {
+        unsigned tail = ALOAD(&q->tail);
+
+        if (head - tail == PIPESLOTS) {
+            pipeq_wait(q, &q->tail, tail);
+            continue;
+        }
+        b = &q->blk[head % PIPESLOTS];
+        b->len = (long) vol_read(b->buf, PIPEREAD);
+        pipeq_post(q, &q->head, ++head);
+        if (b->len <= 0) /* EOF or error:  read_inbuf() passes it on */
+            break;
+        P->left -= b->len;
+    }
+    pipeq_close(q); /* from here on, G.zipfd is read_inbuf()'s again */
+    return NULL;
+}
+
+static void *pipe_writer(arg)
+void *arg;
+{
+    struct pipeline *P = (struct pipeline *) arg;
+    FlushFn *sink = G.flush;
+    pipeq *q = &P->out;
+    unsigned tail = q->tail;
+    pipeblk *b;
+    int r, worst = PK_OK;
+
+    for (;;) {
+        int closed = ALOAD(&q->closed);
+
+        if (ALOAD(&q->head) == tail) {
+            if (closed) /* everything queued before the close is written */
+                break;
+            pipeq_wait(q, &q->head, tail);
+            continue;
+        }
+        b = &q->blk[tail % PIPESLOTS];
+        r = (*sink)(b->buf, (uint32_t) b->len);
+        if (r > worst) {
+            if (r == PK_DISK) { /* stop writing, but keep the CRC going */
+                ASTORE(&P->err, errno);
+                sink = flush_test;
+            }
+            ASTORE(&P->status, worst = r);
+        }
+        pipeq_post(q, &q->tail, ++tail);
+    }
+    return NULL;
+}
+
+/* like zip_read(G.inbuf, INBUFSIZ), from the reader thread's buffers */
+static int read_inbuf()
+{
+    struct pipeline *P = G.pipe;
+    pipeq *q;
+    pipeblk *b;
+    int n;
+
+    if (P == NULL || !P->in.running)
+        return zip_read(G.inbuf, INBUFSIZ);
+    q = &P->in;
+    for (;;) {
+        int closed = ALOAD(&q->closed);
+
+        if (ALOAD(&q->head) != q->tail)
+            break;
+        if (closed) /* reader is done:  carry on where it stopped */
+            return zip_read(G.inbuf, INBUFSIZ);
+        pipeq_wait(q, &q->head, q->tail);
+    }
+    b = &q->blk[q->tail % PIPESLOTS];
+    if (b->len <= 0) {
+        n = (int) b->len;
+    } else {
+        /* the reader fetches whole multiples of INBUFSIZ, so the blocks
+           handed out stay aligned for cur_zipfile_bufstart */
+        n = (int) MIN(b->len - P->used, INBUFSIZ);
+        memcpy(G.inbuf, b->buf + P->used, n);
+        if ((P->used += n) < b->len)
+            return n;
+        P->used = 0;
+    }
+    pipeq_post(q, &q->tail, q->tail + 1);
+    return n;
+}
+
+/* The worst output sink status so far.  If the writer thread failed to
+   write, ask about it (once) here on the main thread. */
+static int pipe_disk_error(P)
+struct pipeline *P;
+{
+    int r = ALOAD(&P->status);
+
+    if (r == PK_DISK && !P->asked) {
+        P->asked = TRUE;
+        errno = ALOAD(&P->err);
+        r = disk_error();
+    }
+    return r;
+}
+
+/* queue len bytes of the ring for the writer thread (flush_window()) */
+static int pipe_write(buf, len)
+uint8_t *buf;
+unsigned len;
+{
+    struct pipeline *P = G.pipe;
+    pipeq *q = &P->out;
+    unsigned head = q->head;
+    unsigned i, tail;
+    long busy;
+
+    /* wait for a free entry and for RINGROOM bytes of ring behind this
+       window that the writer is done with */
+    for (;;) {
+        tail = ALOAD(&q->tail);
+        for (busy = (long) len, i = tail; i != head; i++)
+            busy += q->blk[i % PIPESLOTS].len;
+        if (head - tail < PIPESLOTS && busy <= RINGSIZ - RINGROOM)
+            break;
+        pipeq_wait(q, &q->tail, tail);
+    }
+    q->blk[head % PIPESLOTS].buf = buf;
+    q->blk[head % PIPESLOTS].len = (long) len;
+    pipeq_post(q, &q->head, head + 1);
+    return pipe_disk_error(P);
+}
+
+static int pipeq_start(q, fn, P)
+pipeq *q;
+void *(*fn)(void *);
+struct pipeline *P;
+{
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->running = pthread_create(&q->thread, NULL, fn, P) == 0;
+    if (!q->running) {
+        pthread_cond_destroy(&q->cond);
+        pthread_mutex_destroy(&q->lock);
+    }
+    return q->running;
+}
+
+static void pipeq_stop(q)
+pipeq *q;
+{
+    pipeq_close(q);
+    pthread_join(q->thread, NULL);
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->lock);
+    q->running = FALSE;
+}
+
+/* Start the reader and/or writer thread for the current member, once its
+   output sink is chosen and its data are about to be read.  Any failure
+   just leaves that stage to the decoder, as without USE_PIPELINE. */
+void pipe_start()
+{
+    struct pipeline *P;
+    unsigned m = G.lrec.compression_method;
+    int i, rd, wr;
+
+    rd = G.csize >= PIPEMIN && !G.zipstream; /* a pipe cannot go back */
+    wr = G.ring != NULL && G.lrec.ucsize >= PIPEMIN &&
+         (m == DEFLATED || m == ENHDEFLATED || m == IMPLODED) &&
+         (G.flush == flush_test || G.flush == flush_binary ||
+          G.flush == flush_text || G.flush == flush_mapped);
+    if (!rd && !wr)
+        return;
+    if ((P = (struct pipeline *) calloc(1, sizeof(struct pipeline))) == NULL)
+        return;
+
+    if (rd && (P->bufs = (uint8_t *) malloc(PIPESLOTS * PIPEREAD)) != NULL) {
+        for (i = 0; i < PIPESLOTS; i++)
+            P->in.blk[i].buf = P->bufs + i * PIPEREAD;
+        P->left = G.csize;
+        pipeq_start(&P->in, pipe_reader, P);
+    }
+    if (wr)
+        pipeq_start(&P->out, pipe_writer, P);
+    G.pipe = P;
+}
+
+/* Wait for the writer to drain, stop the reader and put the zipfile back
+   where the decoder left it.  Returns the worst output sink status. */
+int pipe_stop()
+{
+    struct pipeline *P = G.pipe;
+    int r = PK_OK;
+    off_t back;
+    unsigned i;
+
+    if (P == NULL)
+        return PK_OK;
+    if (P->out.running) {
+        pipeq_stop(&P->out);
+        r = pipe_disk_error(P);
+    }
+    if (P->in.running) {
+        pipeq_stop(&P->in);
+        for (back = -P->used, i = P->in.tail; i != P->in.head; i++)
+            if (P->in.blk[i % PIPESLOTS].len > 0)
+                back += P->in.blk[i % PIPESLOTS].len;
+        if (back > 0)
+            zip_lseek(-back, SEEK_CUR);
+    }
+    free(P->bufs);
+    free(P);
+    G.pipe = NULL;
+    return r;
+}
+
+#endif /* USE_PIPELINE */
+
 int UzpMessagePrnt(buf, size, flag)
 uint8_t *buf;  /* preformatted string to be printed */
 uint32_t size; /* length of string (may include nulls) */
@@ -10,6 +10,8 @@
 
 #include "bzlib.h"
 
+#define SYNC_MAXFS 8 /* -S: output file systems tracked one by one */
+
 struct globals {
 
     /* command options of general use */
@@ -46,17 +48,25 @@ struct globals {
     uint8_t *inptr; /* pointer into input buffer */
     int incnt;
 
-    uint32_t bitbuf;
-    int bits_left; /* unreduce and unshrink only */
-    int zipeof;
+    unsigned biteofs; /* bit reader:  EOFs from readbyte() */
     char *wildzipfn;
     char *zipfn; /* GRR:  WINDLL:  must nuke any malloc'd zipfn... */
     int zipfd;   /* zipfile file handle */
-    off_t ziplen;
+    off_t ziplen;  /* in a stream:  the bytes read so far */
+    int zipstream; /* zipfile is a pipe, read once through (do_stream()) */
+    int streamlost; /* stream:  the end of the member is not known yet */
+    int streamdescr; /* stream:  its CRC is in the descriptor to come */
+    int zipfollow; /* stream:  wait at the end of the zipfile (-F) */
+    int followfd;  /* inotify descriptor watching it, or -1 */
+    zipvol *vol;   /* split archive:  its files (the last one is zipfd) */
+    unsigned nvol; /* how many, or 0 if zipfd is all of the zipfile */
+    unsigned volcur; /* split archive:  the file volpos is in */
+    off_t volpos;    /* split archive:  where zip_read() reads next */
+    uint8_t *rcd;  /* central directory rebuilt by recover.c, or NULL */
+    size_t rcdlen; /* its length; it is read as if it followed ziplen */
     off_t cur_zipfile_bufstart; /* extract_or_test, readbuf, ReadByte */
     off_t extra_bytes;          /* used in unzip.c, misc.c */
     uint8_t *extra_field;       /* Unix, VMS, Mac, OS/2, Acorn, ... */
-    uint8_t *hold;
 
     local_file_hdr lrec; /* used in unzip.c, extract.c */
     cdir_file_hdr crec;  /* used in unzip.c, extract.c, misc.c */
@@ -81,6 +91,12 @@ struct globals {
     slinkentry *slink_head; /* pointer to head of symlinks list */
     slinkentry *slink_last; /* pointer to last entry in symlinks list */
 
+    int syncfd[SYNC_MAXFS]; /* -S: open fd on each output file system */
+    dev_t syncdev[SYNC_MAXFS]; /* -S: device of each syncfd[] */
+    int nsyncfd;       /* -S: entries used in syncfd[] */
+    int syncall;       /* -S: too many file systems, sync() them all */
+    double sync_secs;  /* -S: seconds spent making output durable */
+
     FILE *outfile;
     uint8_t *outbuf;
 
@@ -101,32 +117,34 @@ struct globals {
     char *key;        /* crypt static: decryption password or NULL */
     int nopwd;        /* crypt static */
     uint32_t keys[3]; /* crypt static: keys defining pseudo-random sequence */
+    uint8_t *cryptsave; /* crypt static: stream input as it was before */
+    uint8_t *cryptfrom; /*   decrypt_input() decrypted it, from here on */
+    unsigned cryptlen;  /*   for this many bytes */
+    struct aes_ctx *aes; /* crypt static: WinZip AES keys (aescrypt.c) */
 
     int echofd; /* ttyio static: file descriptor whose echo is off */
 
     unsigned hufts; /* track memory usage */
 
-    struct huft *fixed_tl;           /* inflate static */
-    struct huft *fixed_td;           /* inflate static */
-    unsigned fixed_bl, fixed_bd;     /* inflate static */
-    struct huft *fixed_tl64;         /* inflate static */
-    struct huft *fixed_td64;         /* inflate static */
-    unsigned fixed_bl64, fixed_bd64; /* inflate static */
-    struct huft *fixed_tl32;         /* inflate static */
-    struct huft *fixed_td32;         /* inflate static */
-    unsigned fixed_bl32, fixed_bd32; /* inflate static */
-    const uint16_t *cplens;          /* inflate static */
-    const uint8_t *cplext;           /* inflate static */
-    const uint8_t *cpdext;           /* inflate static */
-    unsigned wp; /* inflate static: current position in slide */
-    uint32_t bb; /* inflate static: bit buffer */
-    unsigned bk; /* inflate static: bits count in bit buffer */
+    const struct inflater *inflater; /* -I: Deflate backend (infsel.c) */
+
+    struct xtree xtrees[3];          /* explode static */
+    uint8_t *ring;    /* output window:  mirror, the mapped output file
+                         (outmaplen) or NULL (use slide) */
+    size_t wf;        /* start of pending output in ring */
+    uint8_t *mirror;  /* mirrored ring (map_ring()), or NULL */
+    size_t outmaplen; /* length of the output file mapping, if it is ring */
+    size_t outmapfill; /* how much of that is faulted in */
 
     /* cylindric buffer space for formatting off_t values (fileio static) */
     char fofft_buf[OFF_T_NUM][OFF_T_LEN];
     int fofft_index;
 
     MsgFn *message;
+    FlushFn *flush; /* output sink for the current member */
+#ifdef USE_PIPELINE
+    struct pipeline *pipe; /* reader/writer threads for this member, or NULL */
+#endif
     PasswdFn *decr_passwd;
 
     int incnt_leftover; /* so improved NEXTBYTE does not waste input */
@@ -0,0 +1,410 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* infblock.h -- the decoder of inflate.c, once per Deflate variant
+
+   inflate.c includes this twice, with DEFL64 defined as 0 and as 1, to get
+   inflate_run32() for Deflate and inflate_run64() for Deflate64.  In each,
+   the length and distance tables and the fixed Huffman tables are
+   constants, where they used to be picked at run time through globals:
+
+                       Deflate (method 8)      Deflate64 (method 9)
+        code 285       length 258              length 3 + 16 extra bits
+        distances      0..29                   0..31
+
+   The window is not:  it is s->wsize bytes, as given to inflate_init(),
+   which inflate_builtin() makes 32K for Deflate and 64K for Deflate64 when
+   it decodes into slide[].
+
+   inflate_run() is a state machine (s->mode) whose steps each ask for all
+   the input bits they can use up front (LENBITS, DISTBITS), so that it
+   can stop between any two of them when the input runs out, or when the
+   window holds s->wend bytes of output for the caller.
+
+   With BITS_BMI2 (see bitread.h) it is included twice more with BMI2 set
+   to 1, for inflate_bmi2_32() and inflate_bmi2_64():  the same decoder,
+   built for CPUs with BMI2.  Those use the tables of the first two. */
+
+#if DEFL64
+#define INFL(f)  f##64
+#define CPLENS   cplens64
+#define CPLEXT   cplext64
+#define CPDEXT   cpdext64
+#define FIXED_TL fixed_tl64
+#define FIXED_TD fixed_td64
+#define LENBITS  31 /* most bits in a literal/length:  15 + 16 extra */
+#define DISTBITS 29 /* most bits in a distance:  15 + 14 extra */
+#else
+#define INFL(f)  f##32
+#define CPLENS   cplens32
+#define CPLEXT   cplext32
+#define CPDEXT   cpdext32
+#define FIXED_TL fixed_tl32
+#define FIXED_TD fixed_td32
+#define LENBITS  20 /* 15 + 5 extra */
+#define DISTBITS 28 /* 15 + 13 extra */
+#endif
+
+#if BMI2
+#define INFL_RUN INFL(inflate_bmi2_)
+#define LOWBITS  BITS_LOW_BMI2
+#define TARGET   BITS_TARGET_BMI2
+#else
+#define INFL_RUN INFL(inflate_run)
+#define LOWBITS  BITS_LOW
+#define TARGET
+#endif
+
+#if !BMI2
+static int INFL(inflate_tables)(struct inflate_state *s);
+#endif
+TARGET static int INFL_RUN(struct inflate_state *s);
+
+#if !BMI2
+/* Build the decoding tables of a dynamic block from the code lengths in
+   s->ll.  Return an error code or zero if it all goes ok. */
+static int INFL(inflate_tables)(s)
+struct inflate_state *s;
+{
+    int retval;
+
+    s->bl = lbits;
+    retval = huft_build(s->ll, s->nl, 257, CPLENS, CPLEXT, &s->dtl, &s->bl);
+    if (s->bl == 0) /* no literals or lengths */
+        retval = 1;
+    if (retval) {
+        if (retval == 1 && !G.UzO.qflag)
+            MESSAGE((uint8_t *) "(incomplete l-tree)  ", 21L, 1);
+        return retval; /* incomplete code set */
+    }
+    s->bd = dbits;
+    retval = huft_build(s->ll + s->nl, s->nd, 0, cpdist, CPDEXT, &s->dtd,
+                        &s->bd);
+    if (retval == 1)
+        retval = 0;
+    if (s->bd == 0 && s->nl > 257) /* lengths but no distances */
+        retval = 1;
+    if (retval) {
+        if (retval == 1 && !G.UzO.qflag)
+            MESSAGE((uint8_t *) "(incomplete d-tree)  ", 21L, 1);
+        return retval;
+    }
+    s->tl = s->dtl;
+    s->td = s->dtd;
+    return 0;
+}
+#endif /* !BMI2 */
+
+/* Decode until the input runs out (INF_NEED_INPUT), there is output for
+   the caller (INF_HAVE_OUTPUT), the stream ends (0) or it is found to be
+   bad (an error code). */
+TARGET static int INFL_RUN(s)
+struct inflate_state *s;
+{
+    register bitbuf_t b = s->b; /* bit buffer */
+    register int k = s->k;      /* number of bits in bit buffer */
+    const uint8_t *in = s->next_in;
+    unsigned left = s->avail_in;
+    uint8_t *out = s->window + s->wf; /* start of pending output */
+    UINT_D64 w = s->w;                /* bytes pending */
+    UINT_D64 wend = s->wend;          /* flush point */
+    const struct huft *t;             /* pointer to table entry */
+    unsigned e;                       /* table entry flag/extra bits */
+    UINT_D64 n;                       /* length of copy */
+    unsigned d;                       /* distance of copy */
+    unsigned ml = mask_bits[s->bl];   /* masks for bl and bd bits */
+    unsigned md = mask_bits[s->bd];
+    int retval;
+
+    for (;;)
+        switch (s->mode) {
+        case INF_HEAD:
+            PULLBITS(3, INF_HEAD);
+            s->last = (int) b & 1;
+            e = (unsigned) (b >> 1) & 3;
+            DUMPBITS(3);
+            if (e == 2) {
+                Trace((stderr, "\ndynamic block"));
+                s->mode = INF_TABLE;
+            } else if (e == 1) {
+                Trace((stderr, "\nliteral block"));
+                s->tl = FIXED_TL;
+                s->td = FIXED_TD;
+                ml = mask_bits[s->bl = FIXED_BL];
+                md = mask_bits[s->bd = FIXED_BD];
+                s->mode = INF_CODES;
+            } else if (e == 0) {
+                Trace((stderr, "\nstored block"));
+                s->mode = INF_STORED;
+            } else
+                FAIL(2); /* bad block type */
+            break;
+
+        case INF_STORED:
+            DUMPBITS(k & 7); /* go to byte boundary */
+            PULLBITS(32, INF_STORED);
+            n = (unsigned) b & 0xffff;
+            if (n != ((unsigned) ~(b >> 16) & 0xffff))
+                FAIL(1); /* error in compressed data */
+            DUMPBITS(32);
+            s->n = n;
+            s->mode = INF_COPY;
+            break;
+
+        case INF_COPY:
+            /* the bytes left in the bit buffer first, then straight from
+               the input */
+            n = s->n;
+            while (n > 0 && k >= 8 && w < wend) {
+                out[w++] = (uint8_t) b;
+                DUMPBITS(8);
+                n--;
+            }
+            if (k == 0)
+                b = 0; /* above k:  input about to be copied below */
+            if (n > 0 && w < wend) {
+                if (left == 0) {
+                    s->n = n;
+                    if (s->last_in)
+                        FAIL(1);
+                    SUSPEND(INF_NEED_INPUT);
+                }
+                e = (unsigned) MIN(MIN(n, (UINT_D64) left), wend - w);
+                memcpy(out + w, in, e);
+                in += e;
+                left -= e;
+                w += e;
+                n -= e;
+            }
+            s->n = n;
+            if (n == 0)
+                s->mode = s->last ? INF_DONE : INF_HEAD;
+            if (w == wend)
+                SUSPEND(INF_HAVE_OUTPUT);
+            break;
+
+        case INF_TABLE:
+            PULLBITS(14, INF_TABLE);
+            s->nl = 257 + ((unsigned) b & 0x1f); /* literal/length codes */
+            s->nd = 1 + ((unsigned) (b >> 5) & 0x1f); /* distance codes */
+            s->nb = 4 + ((unsigned) (b >> 10) & 0xf); /* bit length codes */
+            DUMPBITS(14);
+            if (s->nl > MAXLITLENS || s->nd > MAXDISTS)
+                FAIL(1); /* bad lengths */
+            s->i = 0;
+            s->mode = INF_LENLENS;
+            /* fall through */
+
+        case INF_LENLENS:
+            /* read in bit-length-code lengths */
+            while (s->i < s->nb) {
+                PULLBITS(3, INF_LENLENS);
+                s->ll[border[s->i++]] = (unsigned) b & 7;
+                DUMPBITS(3);
+            }
+            while (s->i < 19)
+                s->ll[border[s->i++]] = 0;
+
+            /* build decoding table for trees--single level, 7 bit lookup */
+            s->bl = 7;
+            retval = huft_build(s->ll, 19, 19, NULL, NULL, &s->dtl, &s->bl);
+            if (s->bl == 0) /* no bit lengths */
+                retval = 1;
+            if (retval)
+                FAIL(retval); /* incomplete code set */
+            ml = mask_bits[s->bl];
+            s->i = s->l = 0;
+            s->mode = INF_CODELENS;
+            /* fall through */
+
+        case INF_CODELENS:
+            /* read in literal and distance code lengths */
+            while (s->i < s->nl + s->nd) {
+                PULLBITS(14, INF_CODELENS);
+                t = s->dtl + ((unsigned) b & ml);
+                DUMPBITS(t->b);
+                if ((e = t->v.n) < 16) { /* length of code in bits (0..15) */
+                    s->ll[s->i++] = s->l = e; /* save last length in l */
+                    continue;
+                }
+                if (e == 16) { /* repeat last length 3 to 6 times */
+                    n = 3 + ((unsigned) b & 3);
+                    DUMPBITS(2);
+                    d = s->l;
+                } else if (e == 17) { /* 3 to 10 zero length codes */
+                    n = 3 + ((unsigned) b & 7);
+                    DUMPBITS(3);
+                    d = s->l = 0;
+                } else { /* e == 18: 11 to 138 zero length codes */
+                    n = 11 + ((unsigned) b & 0x7f);
+                    DUMPBITS(7);
+                    d = s->l = 0;
+                }
+                if (s->i + (unsigned) n > s->nl + s->nd)
+                    FAIL(1);
+                while (n--)
+                    s->ll[s->i++] = d;
+            }
+
+            /* free decoding table for trees */
+            huft_free(s->dtl);
+            s->dtl = NULL;
+
+            /* build the decoding tables for literal/length and distance
+               codes */
+            if ((retval = INFL(inflate_tables)(s)) != 0)
+                FAIL(retval);
+            ml = mask_bits[s->bl];
+            md = mask_bits[s->bd];
+            s->mode = INF_CODES;
+            break;
+
+        case INF_DIST:
+            n = s->n;
+            s->mode = INF_CODES;
+            goto inflate_dist;
+
+        case INF_CODES:
+            /* do until end of block */
+            for (;;) {
+                PULLBITS(LENBITS, INF_CODES);
+                t = s->tl + ((unsigned) b & ml);
+                while ((e = t->e) > 32) {
+                    if (IS_INVALID_CODE(e))
+                        FAIL(1);
+                    DUMPBITS(t->b);
+                    t = t->v.t + LOWBITS(b, e & 31);
+                }
+                DUMPBITS(t->b);
+
+                if (e == 32) { /* then it's a literal */
+                    out[w++] = (uint8_t) t->v.n;
+                    if (w >= wend)
+                        SUSPEND(INF_HAVE_OUTPUT);
+                    continue;
+                }
+                if (e == 31) /* it's the EOB signal */
+                    break;
+
+                /* it's a length:  get the length of block to copy */
+                n = t->v.n + LOWBITS(b, e);
+                DUMPBITS(e);
+
+            inflate_dist:
+                /* decode distance of block to copy */
+                s->n = n;
+                PULLBITS(DISTBITS, INF_DIST);
+                t = s->td + ((unsigned) b & md);
+                while ((e = t->e) > 32) {
+                    if (IS_INVALID_CODE(e))
+                        FAIL(1);
+                    DUMPBITS(t->b);
+                    t = t->v.t + LOWBITS(b, e & 31);
+                }
+                DUMPBITS(t->b);
+                d = t->v.n + LOWBITS(b, e); /* distance */
+                DUMPBITS(e);
+
+                if (s->how != INF_SLIDE) {
+                    /* mirrored window (or an output file, which does not
+                       wrap):  one straight copy, no wrap checks; keep src
+                       and dst in the same view of the ring so an
+                       overlapping copy overlaps in memory, too */
+                    register uint8_t *dst = out + w, *src;
+
+                    if (s->wf + w < d) {
+                        if (s->how == INF_FILE) /* before the start */
+                            FAIL(1);
+                        dst += s->wsize;
+                    }
+                    src = dst - d;
+                    w += n;
+                    if (d >= n)
+                        memcpy(dst, src, (size_t) n);
+                    else
+                        do {
+                            *dst++ = *src++;
+                        } while (--n);
+                    if (w >= wend)
+                        SUSPEND(INF_HAVE_OUTPUT);
+                    continue;
+                }
+
+                /* slide[]:  copy in pieces, up to where it wraps */
+                s->n = n;
+                s->d = (unsigned) w - d;
+                break;
+            }
+            if (e == 31) {
+                if (s->dtl != NULL) {
+                    huft_free(s->dtl);
+                    huft_free(s->dtd);
+                    s->dtl = s->dtd = NULL;
+                }
+                s->mode = s->last ? INF_DONE : INF_HEAD;
+            } else
+                s->mode = INF_MATCH;
+            break;
+
+        case INF_MATCH:
+            n = s->n;
+            d = s->d;
+            do {
+                d &= (unsigned) (s->wsize - 1);
+                e = (unsigned) (s->wsize - (d > (unsigned) w ? (UINT_D64) d
+                                                             : w));
+                if ((UINT_D64) e > n)
+                    e = (unsigned) n;
+                n -= e;
+                do {
+                    out[w++] = out[d++];
+                } while (--e);
+                if (w == wend && n > 0) {
+                    s->n = n;
+                    s->d = d;
+                    SUSPEND(INF_HAVE_OUTPUT);
+                }
+            } while (n);
+            s->mode = INF_CODES;
+            if (w == wend)
+                SUSPEND(INF_HAVE_OUTPUT);
+            break;
+
+        case INF_DONE:
+            if (w > 0) /* the last of the output */
+                SUSPEND(INF_HAVE_OUTPUT);
+            retval = 0;
+            goto inflate_suspend;
+
+        default:
+            retval = s->err;
+            goto inflate_suspend;
+        }
+
+inflate_suspend:
+    s->b = b;
+    s->k = k;
+    s->next_in = in;
+    s->avail_in = left;
+    s->w = w;
+    if (retval == INF_HAVE_OUTPUT) {
+        s->out = out;
+        s->avail_out = (unsigned) w;
+    }
+    return retval;
+}
+
+#undef INFL
+#undef INFL_RUN
+#undef LOWBITS
+#undef TARGET
+#undef CPLENS
+#undef CPLEXT
+#undef CPDEXT
+#undef FIXED_TL
+#undef FIXED_TD
+#undef LENBITS
+#undef DISTBITS
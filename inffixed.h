@@ -0,0 +1,255 @@
+/* inffixed.h -- fixed Huffman tables for inflate.c
+   Generated by mkfixed.c:  do not edit. */
+
+#define FIXED_BL 9 /* lookup bits of fixed_tl32/64 */
+#define FIXED_BD 5 /* lookup bits of fixed_td32/64 */
+
+static const struct huft fixed_tl32[512] = {
+    {31, 7, {256}}, {32, 8, {80}}, {32, 8, {16}}, {4, 8, {115}}, {2, 7, {31}},
+    {32, 8, {112}}, {32, 8, {48}}, {32, 9, {192}}, {0, 7, {10}},
+    {32, 8, {96}}, {32, 8, {32}}, {32, 9, {160}}, {32, 8, {0}},
+    {32, 8, {128}}, {32, 8, {64}}, {32, 9, {224}}, {0, 7, {6}}, {32, 8, {88}},
+    {32, 8, {24}}, {32, 9, {144}}, {3, 7, {59}}, {32, 8, {120}},
+    {32, 8, {56}}, {32, 9, {208}}, {1, 7, {17}}, {32, 8, {104}},
+    {32, 8, {40}}, {32, 9, {176}}, {32, 8, {8}}, {32, 8, {136}},
+    {32, 8, {72}}, {32, 9, {240}}, {0, 7, {4}}, {32, 8, {84}}, {32, 8, {20}},
+    {5, 8, {227}}, {3, 7, {43}}, {32, 8, {116}}, {32, 8, {52}},
+    {32, 9, {200}}, {1, 7, {13}}, {32, 8, {100}}, {32, 8, {36}},
+    {32, 9, {168}}, {32, 8, {4}}, {32, 8, {132}}, {32, 8, {68}},
+    {32, 9, {232}}, {0, 7, {8}}, {32, 8, {92}}, {32, 8, {28}}, {32, 9, {152}},
+    {4, 7, {83}}, {32, 8, {124}}, {32, 8, {60}}, {32, 9, {216}}, {2, 7, {23}},
+    {32, 8, {108}}, {32, 8, {44}}, {32, 9, {184}}, {32, 8, {12}},
+    {32, 8, {140}}, {32, 8, {76}}, {32, 9, {248}}, {0, 7, {3}}, {32, 8, {82}},
+    {32, 8, {18}}, {5, 8, {163}}, {3, 7, {35}}, {32, 8, {114}}, {32, 8, {50}},
+    {32, 9, {196}}, {1, 7, {11}}, {32, 8, {98}}, {32, 8, {34}},
+    {32, 9, {164}}, {32, 8, {2}}, {32, 8, {130}}, {32, 8, {66}},
+    {32, 9, {228}}, {0, 7, {7}}, {32, 8, {90}}, {32, 8, {26}}, {32, 9, {148}},
+    {4, 7, {67}}, {32, 8, {122}}, {32, 8, {58}}, {32, 9, {212}}, {2, 7, {19}},
+    {32, 8, {106}}, {32, 8, {42}}, {32, 9, {180}}, {32, 8, {10}},
+    {32, 8, {138}}, {32, 8, {74}}, {32, 9, {244}}, {0, 7, {5}}, {32, 8, {86}},
+    {32, 8, {22}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {118}}, {32, 8, {54}},
+    {32, 9, {204}}, {1, 7, {15}}, {32, 8, {102}}, {32, 8, {38}},
+    {32, 9, {172}}, {32, 8, {6}}, {32, 8, {134}}, {32, 8, {70}},
+    {32, 9, {236}}, {0, 7, {9}}, {32, 8, {94}}, {32, 8, {30}}, {32, 9, {156}},
+    {4, 7, {99}}, {32, 8, {126}}, {32, 8, {62}}, {32, 9, {220}}, {2, 7, {27}},
+    {32, 8, {110}}, {32, 8, {46}}, {32, 9, {188}}, {32, 8, {14}},
+    {32, 8, {142}}, {32, 8, {78}}, {32, 9, {252}}, {31, 7, {256}},
+    {32, 8, {81}}, {32, 8, {17}}, {5, 8, {131}}, {2, 7, {31}}, {32, 8, {113}},
+    {32, 8, {49}}, {32, 9, {194}}, {0, 7, {10}}, {32, 8, {97}}, {32, 8, {33}},
+    {32, 9, {162}}, {32, 8, {1}}, {32, 8, {129}}, {32, 8, {65}},
+    {32, 9, {226}}, {0, 7, {6}}, {32, 8, {89}}, {32, 8, {25}}, {32, 9, {146}},
+    {3, 7, {59}}, {32, 8, {121}}, {32, 8, {57}}, {32, 9, {210}}, {1, 7, {17}},
+    {32, 8, {105}}, {32, 8, {41}}, {32, 9, {178}}, {32, 8, {9}},
+    {32, 8, {137}}, {32, 8, {73}}, {32, 9, {242}}, {0, 7, {4}}, {32, 8, {85}},
+    {32, 8, {21}}, {0, 8, {258}}, {3, 7, {43}}, {32, 8, {117}}, {32, 8, {53}},
+    {32, 9, {202}}, {1, 7, {13}}, {32, 8, {101}}, {32, 8, {37}},
+    {32, 9, {170}}, {32, 8, {5}}, {32, 8, {133}}, {32, 8, {69}},
+    {32, 9, {234}}, {0, 7, {8}}, {32, 8, {93}}, {32, 8, {29}}, {32, 9, {154}},
+    {4, 7, {83}}, {32, 8, {125}}, {32, 8, {61}}, {32, 9, {218}}, {2, 7, {23}},
+    {32, 8, {109}}, {32, 8, {45}}, {32, 9, {186}}, {32, 8, {13}},
+    {32, 8, {141}}, {32, 8, {77}}, {32, 9, {250}}, {0, 7, {3}}, {32, 8, {83}},
+    {32, 8, {19}}, {5, 8, {195}}, {3, 7, {35}}, {32, 8, {115}}, {32, 8, {51}},
+    {32, 9, {198}}, {1, 7, {11}}, {32, 8, {99}}, {32, 8, {35}},
+    {32, 9, {166}}, {32, 8, {3}}, {32, 8, {131}}, {32, 8, {67}},
+    {32, 9, {230}}, {0, 7, {7}}, {32, 8, {91}}, {32, 8, {27}}, {32, 9, {150}},
+    {4, 7, {67}}, {32, 8, {123}}, {32, 8, {59}}, {32, 9, {214}}, {2, 7, {19}},
+    {32, 8, {107}}, {32, 8, {43}}, {32, 9, {182}}, {32, 8, {11}},
+    {32, 8, {139}}, {32, 8, {75}}, {32, 9, {246}}, {0, 7, {5}}, {32, 8, {87}},
+    {32, 8, {23}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {119}}, {32, 8, {55}},
+    {32, 9, {206}}, {1, 7, {15}}, {32, 8, {103}}, {32, 8, {39}},
+    {32, 9, {174}}, {32, 8, {7}}, {32, 8, {135}}, {32, 8, {71}},
+    {32, 9, {238}}, {0, 7, {9}}, {32, 8, {95}}, {32, 8, {31}}, {32, 9, {158}},
+    {4, 7, {99}}, {32, 8, {127}}, {32, 8, {63}}, {32, 9, {222}}, {2, 7, {27}},
+    {32, 8, {111}}, {32, 8, {47}}, {32, 9, {190}}, {32, 8, {15}},
+    {32, 8, {143}}, {32, 8, {79}}, {32, 9, {254}}, {31, 7, {256}},
+    {32, 8, {80}}, {32, 8, {16}}, {4, 8, {115}}, {2, 7, {31}}, {32, 8, {112}},
+    {32, 8, {48}}, {32, 9, {193}}, {0, 7, {10}}, {32, 8, {96}}, {32, 8, {32}},
+    {32, 9, {161}}, {32, 8, {0}}, {32, 8, {128}}, {32, 8, {64}},
+    {32, 9, {225}}, {0, 7, {6}}, {32, 8, {88}}, {32, 8, {24}}, {32, 9, {145}},
+    {3, 7, {59}}, {32, 8, {120}}, {32, 8, {56}}, {32, 9, {209}}, {1, 7, {17}},
+    {32, 8, {104}}, {32, 8, {40}}, {32, 9, {177}}, {32, 8, {8}},
+    {32, 8, {136}}, {32, 8, {72}}, {32, 9, {241}}, {0, 7, {4}}, {32, 8, {84}},
+    {32, 8, {20}}, {5, 8, {227}}, {3, 7, {43}}, {32, 8, {116}}, {32, 8, {52}},
+    {32, 9, {201}}, {1, 7, {13}}, {32, 8, {100}}, {32, 8, {36}},
+    {32, 9, {169}}, {32, 8, {4}}, {32, 8, {132}}, {32, 8, {68}},
+    {32, 9, {233}}, {0, 7, {8}}, {32, 8, {92}}, {32, 8, {28}}, {32, 9, {153}},
+    {4, 7, {83}}, {32, 8, {124}}, {32, 8, {60}}, {32, 9, {217}}, {2, 7, {23}},
+    {32, 8, {108}}, {32, 8, {44}}, {32, 9, {185}}, {32, 8, {12}},
+    {32, 8, {140}}, {32, 8, {76}}, {32, 9, {249}}, {0, 7, {3}}, {32, 8, {82}},
+    {32, 8, {18}}, {5, 8, {163}}, {3, 7, {35}}, {32, 8, {114}}, {32, 8, {50}},
+    {32, 9, {197}}, {1, 7, {11}}, {32, 8, {98}}, {32, 8, {34}},
+    {32, 9, {165}}, {32, 8, {2}}, {32, 8, {130}}, {32, 8, {66}},
+    {32, 9, {229}}, {0, 7, {7}}, {32, 8, {90}}, {32, 8, {26}}, {32, 9, {149}},
+    {4, 7, {67}}, {32, 8, {122}}, {32, 8, {58}}, {32, 9, {213}}, {2, 7, {19}},
+    {32, 8, {106}}, {32, 8, {42}}, {32, 9, {181}}, {32, 8, {10}},
+    {32, 8, {138}}, {32, 8, {74}}, {32, 9, {245}}, {0, 7, {5}}, {32, 8, {86}},
+    {32, 8, {22}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {118}}, {32, 8, {54}},
+    {32, 9, {205}}, {1, 7, {15}}, {32, 8, {102}}, {32, 8, {38}},
+    {32, 9, {173}}, {32, 8, {6}}, {32, 8, {134}}, {32, 8, {70}},
+    {32, 9, {237}}, {0, 7, {9}}, {32, 8, {94}}, {32, 8, {30}}, {32, 9, {157}},
+    {4, 7, {99}}, {32, 8, {126}}, {32, 8, {62}}, {32, 9, {221}}, {2, 7, {27}},
+    {32, 8, {110}}, {32, 8, {46}}, {32, 9, {189}}, {32, 8, {14}},
+    {32, 8, {142}}, {32, 8, {78}}, {32, 9, {253}}, {31, 7, {256}},
+    {32, 8, {81}}, {32, 8, {17}}, {5, 8, {131}}, {2, 7, {31}}, {32, 8, {113}},
+    {32, 8, {49}}, {32, 9, {195}}, {0, 7, {10}}, {32, 8, {97}}, {32, 8, {33}},
+    {32, 9, {163}}, {32, 8, {1}}, {32, 8, {129}}, {32, 8, {65}},
+    {32, 9, {227}}, {0, 7, {6}}, {32, 8, {89}}, {32, 8, {25}}, {32, 9, {147}},
+    {3, 7, {59}}, {32, 8, {121}}, {32, 8, {57}}, {32, 9, {211}}, {1, 7, {17}},
+    {32, 8, {105}}, {32, 8, {41}}, {32, 9, {179}}, {32, 8, {9}},
+    {32, 8, {137}}, {32, 8, {73}}, {32, 9, {243}}, {0, 7, {4}}, {32, 8, {85}},
+    {32, 8, {21}}, {0, 8, {258}}, {3, 7, {43}}, {32, 8, {117}}, {32, 8, {53}},
+    {32, 9, {203}}, {1, 7, {13}}, {32, 8, {101}}, {32, 8, {37}},
+    {32, 9, {171}}, {32, 8, {5}}, {32, 8, {133}}, {32, 8, {69}},
+    {32, 9, {235}}, {0, 7, {8}}, {32, 8, {93}}, {32, 8, {29}}, {32, 9, {155}},
+    {4, 7, {83}}, {32, 8, {125}}, {32, 8, {61}}, {32, 9, {219}}, {2, 7, {23}},
+    {32, 8, {109}}, {32, 8, {45}}, {32, 9, {187}}, {32, 8, {13}},
+    {32, 8, {141}}, {32, 8, {77}}, {32, 9, {251}}, {0, 7, {3}}, {32, 8, {83}},
+    {32, 8, {19}}, {5, 8, {195}}, {3, 7, {35}}, {32, 8, {115}}, {32, 8, {51}},
+    {32, 9, {199}}, {1, 7, {11}}, {32, 8, {99}}, {32, 8, {35}},
+    {32, 9, {167}}, {32, 8, {3}}, {32, 8, {131}}, {32, 8, {67}},
+    {32, 9, {231}}, {0, 7, {7}}, {32, 8, {91}}, {32, 8, {27}}, {32, 9, {151}},
+    {4, 7, {67}}, {32, 8, {123}}, {32, 8, {59}}, {32, 9, {215}}, {2, 7, {19}},
+    {32, 8, {107}}, {32, 8, {43}}, {32, 9, {183}}, {32, 8, {11}},
+    {32, 8, {139}}, {32, 8, {75}}, {32, 9, {247}}, {0, 7, {5}}, {32, 8, {87}},
+    {32, 8, {23}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {119}}, {32, 8, {55}},
+    {32, 9, {207}}, {1, 7, {15}}, {32, 8, {103}}, {32, 8, {39}},
+    {32, 9, {175}}, {32, 8, {7}}, {32, 8, {135}}, {32, 8, {71}},
+    {32, 9, {239}}, {0, 7, {9}}, {32, 8, {95}}, {32, 8, {31}}, {32, 9, {159}},
+    {4, 7, {99}}, {32, 8, {127}}, {32, 8, {63}}, {32, 9, {223}}, {2, 7, {27}},
+    {32, 8, {111}}, {32, 8, {47}}, {32, 9, {191}}, {32, 8, {15}},
+    {32, 8, {143}}, {32, 8, {79}}, {32, 9, {255}}};
+
+static const struct huft fixed_tl64[512] = {
+    {31, 7, {256}}, {32, 8, {80}}, {32, 8, {16}}, {4, 8, {115}}, {2, 7, {31}},
+    {32, 8, {112}}, {32, 8, {48}}, {32, 9, {192}}, {0, 7, {10}},
+    {32, 8, {96}}, {32, 8, {32}}, {32, 9, {160}}, {32, 8, {0}},
+    {32, 8, {128}}, {32, 8, {64}}, {32, 9, {224}}, {0, 7, {6}}, {32, 8, {88}},
+    {32, 8, {24}}, {32, 9, {144}}, {3, 7, {59}}, {32, 8, {120}},
+    {32, 8, {56}}, {32, 9, {208}}, {1, 7, {17}}, {32, 8, {104}},
+    {32, 8, {40}}, {32, 9, {176}}, {32, 8, {8}}, {32, 8, {136}},
+    {32, 8, {72}}, {32, 9, {240}}, {0, 7, {4}}, {32, 8, {84}}, {32, 8, {20}},
+    {5, 8, {227}}, {3, 7, {43}}, {32, 8, {116}}, {32, 8, {52}},
+    {32, 9, {200}}, {1, 7, {13}}, {32, 8, {100}}, {32, 8, {36}},
+    {32, 9, {168}}, {32, 8, {4}}, {32, 8, {132}}, {32, 8, {68}},
+    {32, 9, {232}}, {0, 7, {8}}, {32, 8, {92}}, {32, 8, {28}}, {32, 9, {152}},
+    {4, 7, {83}}, {32, 8, {124}}, {32, 8, {60}}, {32, 9, {216}}, {2, 7, {23}},
+    {32, 8, {108}}, {32, 8, {44}}, {32, 9, {184}}, {32, 8, {12}},
+    {32, 8, {140}}, {32, 8, {76}}, {32, 9, {248}}, {0, 7, {3}}, {32, 8, {82}},
+    {32, 8, {18}}, {5, 8, {163}}, {3, 7, {35}}, {32, 8, {114}}, {32, 8, {50}},
+    {32, 9, {196}}, {1, 7, {11}}, {32, 8, {98}}, {32, 8, {34}},
+    {32, 9, {164}}, {32, 8, {2}}, {32, 8, {130}}, {32, 8, {66}},
+    {32, 9, {228}}, {0, 7, {7}}, {32, 8, {90}}, {32, 8, {26}}, {32, 9, {148}},
+    {4, 7, {67}}, {32, 8, {122}}, {32, 8, {58}}, {32, 9, {212}}, {2, 7, {19}},
+    {32, 8, {106}}, {32, 8, {42}}, {32, 9, {180}}, {32, 8, {10}},
+    {32, 8, {138}}, {32, 8, {74}}, {32, 9, {244}}, {0, 7, {5}}, {32, 8, {86}},
+    {32, 8, {22}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {118}}, {32, 8, {54}},
+    {32, 9, {204}}, {1, 7, {15}}, {32, 8, {102}}, {32, 8, {38}},
+    {32, 9, {172}}, {32, 8, {6}}, {32, 8, {134}}, {32, 8, {70}},
+    {32, 9, {236}}, {0, 7, {9}}, {32, 8, {94}}, {32, 8, {30}}, {32, 9, {156}},
+    {4, 7, {99}}, {32, 8, {126}}, {32, 8, {62}}, {32, 9, {220}}, {2, 7, {27}},
+    {32, 8, {110}}, {32, 8, {46}}, {32, 9, {188}}, {32, 8, {14}},
+    {32, 8, {142}}, {32, 8, {78}}, {32, 9, {252}}, {31, 7, {256}},
+    {32, 8, {81}}, {32, 8, {17}}, {5, 8, {131}}, {2, 7, {31}}, {32, 8, {113}},
+    {32, 8, {49}}, {32, 9, {194}}, {0, 7, {10}}, {32, 8, {97}}, {32, 8, {33}},
+    {32, 9, {162}}, {32, 8, {1}}, {32, 8, {129}}, {32, 8, {65}},
+    {32, 9, {226}}, {0, 7, {6}}, {32, 8, {89}}, {32, 8, {25}}, {32, 9, {146}},
+    {3, 7, {59}}, {32, 8, {121}}, {32, 8, {57}}, {32, 9, {210}}, {1, 7, {17}},
+    {32, 8, {105}}, {32, 8, {41}}, {32, 9, {178}}, {32, 8, {9}},
+    {32, 8, {137}}, {32, 8, {73}}, {32, 9, {242}}, {0, 7, {4}}, {32, 8, {85}},
+    {32, 8, {21}}, {16, 8, {3}}, {3, 7, {43}}, {32, 8, {117}}, {32, 8, {53}},
+    {32, 9, {202}}, {1, 7, {13}}, {32, 8, {101}}, {32, 8, {37}},
+    {32, 9, {170}}, {32, 8, {5}}, {32, 8, {133}}, {32, 8, {69}},
+    {32, 9, {234}}, {0, 7, {8}}, {32, 8, {93}}, {32, 8, {29}}, {32, 9, {154}},
+    {4, 7, {83}}, {32, 8, {125}}, {32, 8, {61}}, {32, 9, {218}}, {2, 7, {23}},
+    {32, 8, {109}}, {32, 8, {45}}, {32, 9, {186}}, {32, 8, {13}},
+    {32, 8, {141}}, {32, 8, {77}}, {32, 9, {250}}, {0, 7, {3}}, {32, 8, {83}},
+    {32, 8, {19}}, {5, 8, {195}}, {3, 7, {35}}, {32, 8, {115}}, {32, 8, {51}},
+    {32, 9, {198}}, {1, 7, {11}}, {32, 8, {99}}, {32, 8, {35}},
+    {32, 9, {166}}, {32, 8, {3}}, {32, 8, {131}}, {32, 8, {67}},
+    {32, 9, {230}}, {0, 7, {7}}, {32, 8, {91}}, {32, 8, {27}}, {32, 9, {150}},
+    {4, 7, {67}}, {32, 8, {123}}, {32, 8, {59}}, {32, 9, {214}}, {2, 7, {19}},
+    {32, 8, {107}}, {32, 8, {43}}, {32, 9, {182}}, {32, 8, {11}},
+    {32, 8, {139}}, {32, 8, {75}}, {32, 9, {246}}, {0, 7, {5}}, {32, 8, {87}},
+    {32, 8, {23}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {119}}, {32, 8, {55}},
+    {32, 9, {206}}, {1, 7, {15}}, {32, 8, {103}}, {32, 8, {39}},
+    {32, 9, {174}}, {32, 8, {7}}, {32, 8, {135}}, {32, 8, {71}},
+    {32, 9, {238}}, {0, 7, {9}}, {32, 8, {95}}, {32, 8, {31}}, {32, 9, {158}},
+    {4, 7, {99}}, {32, 8, {127}}, {32, 8, {63}}, {32, 9, {222}}, {2, 7, {27}},
+    {32, 8, {111}}, {32, 8, {47}}, {32, 9, {190}}, {32, 8, {15}},
+    {32, 8, {143}}, {32, 8, {79}}, {32, 9, {254}}, {31, 7, {256}},
+    {32, 8, {80}}, {32, 8, {16}}, {4, 8, {115}}, {2, 7, {31}}, {32, 8, {112}},
+    {32, 8, {48}}, {32, 9, {193}}, {0, 7, {10}}, {32, 8, {96}}, {32, 8, {32}},
+    {32, 9, {161}}, {32, 8, {0}}, {32, 8, {128}}, {32, 8, {64}},
+    {32, 9, {225}}, {0, 7, {6}}, {32, 8, {88}}, {32, 8, {24}}, {32, 9, {145}},
+    {3, 7, {59}}, {32, 8, {120}}, {32, 8, {56}}, {32, 9, {209}}, {1, 7, {17}},
+    {32, 8, {104}}, {32, 8, {40}}, {32, 9, {177}}, {32, 8, {8}},
+    {32, 8, {136}}, {32, 8, {72}}, {32, 9, {241}}, {0, 7, {4}}, {32, 8, {84}},
+    {32, 8, {20}}, {5, 8, {227}}, {3, 7, {43}}, {32, 8, {116}}, {32, 8, {52}},
+    {32, 9, {201}}, {1, 7, {13}}, {32, 8, {100}}, {32, 8, {36}},
+    {32, 9, {169}}, {32, 8, {4}}, {32, 8, {132}}, {32, 8, {68}},
+    {32, 9, {233}}, {0, 7, {8}}, {32, 8, {92}}, {32, 8, {28}}, {32, 9, {153}},
+    {4, 7, {83}}, {32, 8, {124}}, {32, 8, {60}}, {32, 9, {217}}, {2, 7, {23}},
+    {32, 8, {108}}, {32, 8, {44}}, {32, 9, {185}}, {32, 8, {12}},
+    {32, 8, {140}}, {32, 8, {76}}, {32, 9, {249}}, {0, 7, {3}}, {32, 8, {82}},
+    {32, 8, {18}}, {5, 8, {163}}, {3, 7, {35}}, {32, 8, {114}}, {32, 8, {50}},
+    {32, 9, {197}}, {1, 7, {11}}, {32, 8, {98}}, {32, 8, {34}},
+    {32, 9, {165}}, {32, 8, {2}}, {32, 8, {130}}, {32, 8, {66}},
+    {32, 9, {229}}, {0, 7, {7}}, {32, 8, {90}}, {32, 8, {26}}, {32, 9, {149}},
+    {4, 7, {67}}, {32, 8, {122}}, {32, 8, {58}}, {32, 9, {213}}, {2, 7, {19}},
+    {32, 8, {106}}, {32, 8, {42}}, {32, 9, {181}}, {32, 8, {10}},
+    {32, 8, {138}}, {32, 8, {74}}, {32, 9, {245}}, {0, 7, {5}}, {32, 8, {86}},
+    {32, 8, {22}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {118}}, {32, 8, {54}},
+    {32, 9, {205}}, {1, 7, {15}}, {32, 8, {102}}, {32, 8, {38}},
+    {32, 9, {173}}, {32, 8, {6}}, {32, 8, {134}}, {32, 8, {70}},
+    {32, 9, {237}}, {0, 7, {9}}, {32, 8, {94}}, {32, 8, {30}}, {32, 9, {157}},
+    {4, 7, {99}}, {32, 8, {126}}, {32, 8, {62}}, {32, 9, {221}}, {2, 7, {27}},
+    {32, 8, {110}}, {32, 8, {46}}, {32, 9, {189}}, {32, 8, {14}},
+    {32, 8, {142}}, {32, 8, {78}}, {32, 9, {253}}, {31, 7, {256}},
+    {32, 8, {81}}, {32, 8, {17}}, {5, 8, {131}}, {2, 7, {31}}, {32, 8, {113}},
+    {32, 8, {49}}, {32, 9, {195}}, {0, 7, {10}}, {32, 8, {97}}, {32, 8, {33}},
+    {32, 9, {163}}, {32, 8, {1}}, {32, 8, {129}}, {32, 8, {65}},
+    {32, 9, {227}}, {0, 7, {6}}, {32, 8, {89}}, {32, 8, {25}}, {32, 9, {147}},
+    {3, 7, {59}}, {32, 8, {121}}, {32, 8, {57}}, {32, 9, {211}}, {1, 7, {17}},
+    {32, 8, {105}}, {32, 8, {41}}, {32, 9, {179}}, {32, 8, {9}},
+    {32, 8, {137}}, {32, 8, {73}}, {32, 9, {243}}, {0, 7, {4}}, {32, 8, {85}},
+    {32, 8, {21}}, {16, 8, {3}}, {3, 7, {43}}, {32, 8, {117}}, {32, 8, {53}},
+    {32, 9, {203}}, {1, 7, {13}}, {32, 8, {101}}, {32, 8, {37}},
+    {32, 9, {171}}, {32, 8, {5}}, {32, 8, {133}}, {32, 8, {69}},
+    {32, 9, {235}}, {0, 7, {8}}, {32, 8, {93}}, {32, 8, {29}}, {32, 9, {155}},
+    {4, 7, {83}}, {32, 8, {125}}, {32, 8, {61}}, {32, 9, {219}}, {2, 7, {23}},
+    {32, 8, {109}}, {32, 8, {45}}, {32, 9, {187}}, {32, 8, {13}},
+    {32, 8, {141}}, {32, 8, {77}}, {32, 9, {251}}, {0, 7, {3}}, {32, 8, {83}},
+    {32, 8, {19}}, {5, 8, {195}}, {3, 7, {35}}, {32, 8, {115}}, {32, 8, {51}},
+    {32, 9, {199}}, {1, 7, {11}}, {32, 8, {99}}, {32, 8, {35}},
+    {32, 9, {167}}, {32, 8, {3}}, {32, 8, {131}}, {32, 8, {67}},
+    {32, 9, {231}}, {0, 7, {7}}, {32, 8, {91}}, {32, 8, {27}}, {32, 9, {151}},
+    {4, 7, {67}}, {32, 8, {123}}, {32, 8, {59}}, {32, 9, {215}}, {2, 7, {19}},
+    {32, 8, {107}}, {32, 8, {43}}, {32, 9, {183}}, {32, 8, {11}},
+    {32, 8, {139}}, {32, 8, {75}}, {32, 9, {247}}, {0, 7, {5}}, {32, 8, {87}},
+    {32, 8, {23}}, {99, 8, {0}}, {3, 7, {51}}, {32, 8, {119}}, {32, 8, {55}},
+    {32, 9, {207}}, {1, 7, {15}}, {32, 8, {103}}, {32, 8, {39}},
+    {32, 9, {175}}, {32, 8, {7}}, {32, 8, {135}}, {32, 8, {71}},
+    {32, 9, {239}}, {0, 7, {9}}, {32, 8, {95}}, {32, 8, {31}}, {32, 9, {159}},
+    {4, 7, {99}}, {32, 8, {127}}, {32, 8, {63}}, {32, 9, {223}}, {2, 7, {27}},
+    {32, 8, {111}}, {32, 8, {47}}, {32, 9, {191}}, {32, 8, {15}},
+    {32, 8, {143}}, {32, 8, {79}}, {32, 9, {255}}};
+
+static const struct huft fixed_td32[32] = {
+    {0, 5, {1}}, {7, 5, {257}}, {3, 5, {17}}, {11, 5, {4097}}, {1, 5, {5}},
+    {9, 5, {1025}}, {5, 5, {65}}, {13, 5, {16385}}, {0, 5, {3}},
+    {8, 5, {513}}, {4, 5, {33}}, {12, 5, {8193}}, {2, 5, {9}},
+    {10, 5, {2049}}, {6, 5, {129}}, {99, 5, {32769}}, {0, 5, {2}},
+    {7, 5, {385}}, {3, 5, {25}}, {11, 5, {6145}}, {1, 5, {7}}, {9, 5, {1537}},
+    {5, 5, {97}}, {13, 5, {24577}}, {0, 5, {4}}, {8, 5, {769}}, {4, 5, {49}},
+    {12, 5, {12289}}, {2, 5, {13}}, {10, 5, {3073}}, {6, 5, {193}},
+    {99, 5, {49153}}};
+
+static const struct huft fixed_td64[32] = {
+    {0, 5, {1}}, {7, 5, {257}}, {3, 5, {17}}, {11, 5, {4097}}, {1, 5, {5}},
+    {9, 5, {1025}}, {5, 5, {65}}, {13, 5, {16385}}, {0, 5, {3}},
+    {8, 5, {513}}, {4, 5, {33}}, {12, 5, {8193}}, {2, 5, {9}},
+    {10, 5, {2049}}, {6, 5, {129}}, {14, 5, {32769}}, {0, 5, {2}},
+    {7, 5, {385}}, {3, 5, {25}}, {11, 5, {6145}}, {1, 5, {7}}, {9, 5, {1537}},
+    {5, 5, {97}}, {13, 5, {24577}}, {0, 5, {4}}, {8, 5, {769}}, {4, 5, {49}},
+    {12, 5, {12289}}, {2, 5, {13}}, {10, 5, {3073}}, {6, 5, {193}},
+    {14, 5, {49153}}};
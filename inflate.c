@@ -230,6 +230,12 @@
  */
 
 #include "unzip.h"
+#include "bitread.h"  /* bitbuf_t, BITS_LOAD64, DUMPBITS(), BITS_LOW() */
+#include "inflate.h"
+#include "inffixed.h" /* fixed_tl32/64, fixed_td32/64 (from mkfixed.c) */
+#ifdef BITS_BMI2
+#include <cpuid.h>
+#endif
 
 /* #define DEBUG */
 
@@ -244,21 +250,10 @@
 /* some buffer counters must be capable of holding 64k for Deflate64 */
 #define UINT_D64 unsigned
 
-#ifndef NEXTBYTE /* default is to simply get a byte from stdin */
-#define NEXTBYTE getchar()
-#endif
-
 #ifndef MESSAGE /* only used twice, for fixed strings--NOT general-purpose */
 #define MESSAGE(str, len, flag) fprintf(stderr, (char *) (str))
 #endif
 
-#ifndef FLUSH /* default is to simply write the buffer to stdout */
-#define FLUSH(n)                                                            \
-    (((size_t) fwrite(redirSlide, 1, (size_t) (n), stdout) == (size_t) (n)) \
-         ? 0                                                                \
-         : PKDISK)
-#endif
-
 #ifndef Trace
 #ifdef DEBUG
 #define Trace(x) fprintf x
@@ -269,28 +264,22 @@
 
 /*---------------------------------------------------------------------------*/
 
-/* Function prototypes */
-int inflate_codes(struct huft *tl, struct huft *td, unsigned bl, unsigned bd);
-static int inflate_stored(void);
-static int inflate_fixed(void);
-static int inflate_dynamic(void);
-static int inflate_block(int *e);
-
 /* The inflate algorithm uses a sliding 32K byte window on the uncompressed
    stream to find repeated byte strings.  This is implemented here as a
    circular buffer.  The index is updated simply by incrementing and then
-   and'ing with 0x7fff (32K-1). */
-/* It is left to other modules to supply the 32K area.  It is assumed
-   to be usable as if it were declared "uint8_t slide[32768];" or as just
-   "uint8_t *slide;" and then malloc'ed in the latter case.  The definition
-   must be in unzip.h, included above. */
+   and'ing with the window size less one.  When the mirrored ring window
+   is available (G.ring, see RINGSIZ in unzpriv.h), or the output file
+   itself, matches are copied straight through instead and output is
+   flushed in RINGFLUSH-sized pieces (see inflate.h). */
+/* It is left to the caller of inflate_init() to supply the window, for
+   inflate_builtin() one of those or slide[], defined in unzip.h. */
 
 /* Tables for deflate from PKZIP's appnote.txt. */
 /* - Order of the bit length code lengths */
 static const unsigned border[] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
                                   11, 4,  12, 3, 13, 2, 14, 1, 15};
 
-/* - Copy lengths for literal codes 257..285 */
+/* - Copy lengths for literal codes 257..285 (also in mkfixed.c) */
 static const uint16_t cplens64[] = {
     3,  4,  5,  6,  7,  8,  9,  10,  11,  13,  15,  17,  19, 23, 27, 31,
     35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 3,  0,  0};
@@ -328,18 +317,12 @@ static const uint8_t cpdext32[] = {
 #define MAXLITLENS 288
 #define MAXDISTS   32
 
-/* Macros for inflate() bit peeking and grabbing.
-   The usage is:
-
-        NEEDBITS(j);
-        x = b & mask_bits[j];
-        DUMPBITS(j);
-
-   where NEEDBITS makes sure that b has at least j bits in it, and
-   DUMPBITS removes the bits from b.  The macros use the variable k
-   for the number of bits in b.  Normally, b and k are register
-   variables for speed and are initialized at the beginning of a
-   routine that uses these macros from a global bit buffer and count.
+/* inflate_run() reads its bits much as the decoders using bitread.h do,
+   except that the input is s->next_in rather than NEXTBYTE, and that
+   running out of it does not end the stream.  PULLBITS(j, m) makes sure
+   that b holds at least j bits (at most 56); if the input has no more,
+   the state is saved and inflate_run() returns INF_NEED_INPUT, to go on
+   at step m with more.  b and k are local variables while it runs.
 
    In order to not ask for more bits than there are in the compressed
    stream, the Huffman tables are constructed to only ask for just
@@ -349,42 +332,74 @@ static const uint8_t cpdext32[] = {
 
    Actually, the precautions mentioned above are not sufficient to
    prevent fetches of bits beyound the end of the last block in every
-   case. When the last code fetched before the end-of-block code was
-   a very short distance code (shorter than "distance-prefetch-bits" -
-   "end-of-block code bits"), this last distance code fetch already
-   exausts the available data.  To prevent failure of extraction in this
-   case, the "read beyond EOF" check delays the raise of the "invalid
-   data" error until an actual overflow of "used data" is detected.
-   This error condition is only fulfilled when the "number of available
-   bits" counter k is found to be negative in the NEEDBITS() macro.
-
-   An alternate fix for that problem adjusts the size of the distance code
-   base table so that it does not exceed the length of the end-of-block code
-   plus the minimum length of a distance code. This alternate fix can be
-   enabled by defining the preprocessor symbol FIX_PAST_EOB_BY_TABLEADJUST.
- */
+   case, and each step now asks for the most bits it may use anyway.
+   So once s->last_in says that the input is all there, a step may look
+   at the zero bits past the end of it, and k goes negative if some of
+   them are used; only when more bits are needed after that does
+   PULLBITS() give up. */
+
+#ifdef BITS_LOAD64
+#define PULLFAST()                                 \
+    if (left >= 8) {                               \
+        bitbuf_t v_;                               \
+                                                   \
+        memcpy(&v_, in, 8);                        \
+        b |= v_ << k;                              \
+        in += (63 - k) >> 3;                       \
+        left -= (unsigned) ((63 - k) >> 3);        \
+        k |= 56; /* k + 8 * (bytes added) */       \
+    } else
+#else
+#define PULLFAST()
+#endif
 
-#define NEEDBITS(n)                    \
-    do {                               \
-        while ((int) k < (int) (n)) {  \
-            int c = NEXTBYTE;          \
-            if (c == EOF) {            \
-                if ((int) k >= 0)      \
-                    break;             \
-                retval = 1;            \
-                goto cleanup_and_exit; \
-            }                          \
-            b |= ((uint32_t) c) << k;  \
-            k += 8;                    \
-        }                              \
+#define PULLBITS(j, m)                             \
+    do {                                           \
+        if (k < (j)) {                             \
+            PULLFAST()                             \
+            while (left > 0 && k <= 56) {          \
+                b |= (bitbuf_t) *in++ << k;        \
+                left--;                            \
+                k += 8;                            \
+            }                                      \
+            if (k < (j)) {                         \
+                if (!s->last_in) {                 \
+                    s->mode = (m);                 \
+                    SUSPEND(INF_NEED_INPUT);       \
+                }                                  \
+                if (k < 0) /* used up the end */   \
+                    FAIL(1);                       \
+            }                                      \
+        }                                          \
     } while (0)
 
-#define DUMPBITS(n) \
-    do {            \
-        b >>= (n);  \
-        k -= (n);   \
+/* leave inflate_run() with result r, to pick up again at s->mode */
+#define SUSPEND(r)             \
+    do {                       \
+        retval = (r);          \
+        goto inflate_suspend;  \
     } while (0)
 
+/* stop for good with error code r */
+#define FAIL(r)                     \
+    do {                            \
+        s->mode = INF_BAD;          \
+        SUSPEND(s->err = (r));      \
+    } while (0)
+
+/* the steps of inflate_run() (s->mode) */
+#define INF_HEAD     0 /* block header */
+#define INF_STORED   1 /* stored block:  length */
+#define INF_COPY     2 /* stored block:  s->n bytes to copy */
+#define INF_TABLE    3 /* dynamic block:  numbers of codes */
+#define INF_LENLENS  4 /* dynamic block:  code length code lengths */
+#define INF_CODELENS 5 /* dynamic block:  code lengths */
+#define INF_CODES    6 /* literals and lengths */
+#define INF_DIST     7 /* the distance after length s->n */
+#define INF_MATCH    8 /* INF_SLIDE:  s->n bytes to copy from s->d */
+#define INF_DONE     9 /* end of stream */
+#define INF_BAD      10 /* failed with s->err */
+
 /*
    Huffman code decoding is performed using a multi-level table lookup.
    The fastest way to decode is to simply build a lookup table whose
@@ -422,483 +437,161 @@ static const unsigned lbits = 9;
 /* bits in base distance lookup table */
 static const unsigned dbits = 6;
 
-/* inflate (decompress) the codes in a deflated (compressed) block.
-   Return an error code or zero if it all goes ok. */
-int inflate_codes(tl, td, bl, bd)
-struct huft *tl, *td; /* literal/length and distance decoder tables */
-unsigned bl, bd;      /* number of bits decoded by tl[] and td[] */
+/* the block decoders, for each variant */
+#define BMI2 0
+#define DEFL64 0
+#include "infblock.h"
+#undef DEFL64
+#define DEFL64 1
+#include "infblock.h"
+#undef DEFL64
+#undef BMI2
+#ifdef BITS_BMI2
+#define BMI2 1
+#define DEFL64 0
+#include "infblock.h"
+#undef DEFL64
+#define DEFL64 1
+#include "infblock.h"
+#undef DEFL64
+#undef BMI2
+
+/* Return true if the CPU has BMI2 (see bitread.h).  cpuid is asked only
+   the first time. */
+int have_bmi2()
 {
-    register unsigned e; /* table entry flag/number of extra bits */
-    unsigned d;          /* index for copy */
-    UINT_D64 n;          /* length for copy (deflate64: might be 64k+2) */
-    UINT_D64 w;          /* current window position (deflate64: up to 64k) */
-    struct huft *t;      /* pointer to table entry */
-    unsigned ml, md;     /* masks for bl and bd bits */
-    register uint32_t b; /* bit buffer */
-    register unsigned k; /* number of bits in bit buffer */
-    int retval = 0;      /* error code returned: initialized to "no error" */
-
-    /* make local copies of globals */
-    b = G.bb; /* initialize bit buffer */
-    k = G.bk;
-    w = G.wp; /* initialize window position */
-
-    /* inflate the coded data */
-    ml = mask_bits[bl]; /* precompute masks for speed */
-    md = mask_bits[bd];
-    while (1) {
-        /* do until end of block */
-        NEEDBITS(bl);
-        t = tl + ((unsigned) b & ml);
-        while (1) {
-            DUMPBITS(t->b);
-
-            if ((e = t->e) == 32) {
-                /* then it's a literal */
-                redirSlide[w++] = (uint8_t) t->v.n;
-                if (w == WSIZE) {
-                    if ((retval = FLUSH(w)) != 0)
-                        goto cleanup_and_exit;
-                    w = 0;
-                }
-                break;
-            }
+    static int bmi2 = -1;
 
-            if (e < 31) {
-                /* then it's a length */
-                /* get length of block to copy */
-                NEEDBITS(e);
-                n = t->v.n + ((unsigned) b & mask_bits[e]);
-                DUMPBITS(e);
-
-                /* decode distance of block to copy */
-                NEEDBITS(bd);
-                t = td + ((unsigned) b & md);
-                while (1) {
-                    DUMPBITS(t->b);
-                    if ((e = t->e) < 32)
-                        break;
-                    if (IS_INVALID_CODE(e))
-                        return 1;
-                    e &= 31;
-                    NEEDBITS(e);
-                    t = t->v.t + ((unsigned) b & mask_bits[e]);
-                }
-                NEEDBITS(e);
-                d = (unsigned) w - t->v.n - ((unsigned) b & mask_bits[e]);
-                DUMPBITS(e);
-
-                /* do the copy */
-                do {
-                    e = (unsigned) (WSIZE - ((d &= (unsigned) (WSIZE - 1)) >
-                                                     (unsigned) w
-                                                 ? (UINT_D64) d
-                                                 : w));
-                    if ((UINT_D64) e > n)
-                        e = (unsigned) n;
-                    n -= e;
-                    do {
-                        redirSlide[w++] = redirSlide[d++];
-                    } while (--e);
-                    if (w == WSIZE) {
-                        if ((retval = FLUSH(w)) != 0)
-                            goto cleanup_and_exit;
-                        w = 0;
-                    }
-                } while (n);
-                break;
-            }
-
-            if (e == 31) {
-                /* it's the EOB signal */
-                /* sorry for this goto, but we have to exit two loops at once */
-                goto cleanup_decode;
-            }
+    if (bmi2 < 0) {
+        unsigned a, b, c, d;
 
-            if (IS_INVALID_CODE(e))
-                return 1;
-
-            e &= 31;
-            NEEDBITS(e);
-            t = t->v.t + ((unsigned) b & mask_bits[e]);
-        }
+        bmi2 = __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1 << 8));
     }
-cleanup_decode:
-
-    /* restore the globals from the locals */
-    G.wp = (unsigned) w; /* restore global window pointer */
-    G.bb = b;            /* restore global bit buffer */
-    G.bk = k;
-
-cleanup_and_exit:
-    /* done */
-    return retval;
+    return bmi2;
 }
-
-/* "decompress" an inflated type 0 (stored) block. */
-static int inflate_stored()
+#endif /* BITS_BMI2 */
+
+/* Set up s to decode a Deflate (or, if defl64, Deflate64) stream into
+   window, of the kind how (see inflate.h). */
+void inflate_init(s, defl64, window, wsize, how)
+struct inflate_state *s;
+int defl64;
+uint8_t *window;
+size_t wsize;
+int how;
 {
-    UINT_D64 w;          /* current window position (deflate64: up to 64k!) */
-    unsigned n;          /* number of bytes in block */
-    register uint32_t b; /* bit buffer */
-    register unsigned k; /* number of bits in bit buffer */
-    int retval = 0;      /* error code returned: initialized to "no error" */
-
-    /* make local copies of globals */
-    Trace((stderr, "\nstored block"));
-    b = G.bb; /* initialize bit buffer */
-    k = G.bk;
-    w = G.wp; /* initialize window position */
-
-    /* go to byte boundary */
-    n = k & 7;
-    DUMPBITS(n);
-
-    /* get the length and its complement */
-    NEEDBITS(16);
-    n = ((unsigned) b & 0xffff);
-    DUMPBITS(16);
-    NEEDBITS(16);
-    if (n != (unsigned) ((~b) & 0xffff))
-        return 1; /* error in compressed data */
-    DUMPBITS(16);
-
-    /* read and output the compressed data */
-    while (n--) {
-        NEEDBITS(8);
-        redirSlide[w++] = (uint8_t) b;
-        if (w == WSIZE) {
-            if ((retval = FLUSH(w)) != 0)
-                goto cleanup_and_exit;
-            w = 0;
-        }
-        DUMPBITS(8);
-    }
-
-    /* restore the globals from the locals */
-    G.wp = (unsigned) w; /* restore global window pointer */
-    G.bb = b;            /* restore global bit buffer */
-    G.bk = k;
-
-cleanup_and_exit:
-    return retval;
+    memzero(s, sizeof(*s));
+    s->defl64 = defl64;
+    s->how = how;
+    s->window = window;
+    s->wsize = wsize;
+    s->wend = how == INF_SLIDE ? (unsigned) wsize : RINGFLUSH;
+    s->mode = INF_HEAD;
+#ifdef BITS_BMI2
+    s->bmi2 = have_bmi2();
+#endif
 }
 
-/* decompress an inflated type 1 (fixed Huffman codes) block.  We should
-   either replace this with a custom decoder, or at least precompute the
-   Huffman tables. */
-static int inflate_fixed(void)
+/* Decode what there is of the input:  see inflate.h. */
+int inflate_run(s)
+struct inflate_state *s;
 {
-    /* if first time, set up tables for fixed blocks */
-    Trace((stderr, "\nliteral block"));
-    if (G.fixed_tl == NULL) {
-        int i;           /* temporary variable */
-        unsigned l[288]; /* length list for huft_build */
-
-        /* literal table */
-        for (i = 0; i < 144; i++)
-            l[i] = 8;
-        for (; i < 256; i++)
-            l[i] = 9;
-        for (; i < 280; i++)
-            l[i] = 7;
-        for (; i < 288; i++) /* make a complete, but wrong code set */
-            l[i] = 8;
-        G.fixed_bl = 7;
-        if ((i = huft_build(l, 288, 257, G.cplens, G.cplext, &G.fixed_tl,
-                            &G.fixed_bl)) != 0) {
-            G.fixed_tl = NULL;
-            return i;
-        }
-
-        /* distance table */
-        for (i = 0; i < MAXDISTS; i++) /* make an incomplete code set */
-            l[i] = 5;
-        G.fixed_bd = 5;
-        if ((i = huft_build(l, MAXDISTS, 0, cpdist, G.cpdext, &G.fixed_td,
-                            &G.fixed_bd)) > 1) {
-            huft_free(G.fixed_tl);
-            G.fixed_td = G.fixed_tl = NULL;
-            return i;
+    if (s->avail_out != 0) { /* the caller has taken the output */
+        if (s->how == INF_SLIDE)
+            s->wf = 0;
+        else if (s->how == INF_RING)
+            s->wf = (s->wf + s->avail_out) & (s->wsize - 1);
+        else if ((s->wf += s->avail_out) > s->wsize - RINGROOM) {
+            s->mode = INF_BAD; /* more than the file has room for */
+            s->err = 2;
         }
+        s->w = 0;
+        s->avail_out = 0;
     }
-
-    /* decompress until an end-of-block code */
-    return inflate_codes(G.fixed_tl, G.fixed_td, G.fixed_bl, G.fixed_bd);
+#ifdef BITS_BMI2
+    if (s->bmi2)
+        return s->defl64 ? inflate_bmi2_64(s) : inflate_bmi2_32(s);
+#endif
+    return s->defl64 ? inflate_run64(s) : inflate_run32(s);
 }
 
-/* decompress an inflated type 2 (dynamic Huffman codes) block. */
-static int inflate_dynamic(void)
+/* Free what s still has allocated. */
+void inflate_end(s)
+struct inflate_state *s;
 {
-    unsigned i; /* temporary variables */
-    unsigned j;
-    unsigned l;             /* last length */
-    unsigned m;             /* mask for bit lengths table */
-    unsigned n;             /* number of lengths to get */
-    struct huft *tl = NULL; /* literal/length code table */
-    struct huft *td = NULL; /* distance code table */
-    struct huft *th; /* temp huft table pointer used in tables decoding */
-    unsigned bl;     /* lookup bits for tl */
-    unsigned bd;     /* lookup bits for td */
-    unsigned nb;     /* number of bit length codes */
-    unsigned nl;     /* number of literal/length codes */
-    unsigned nd;     /* number of distance codes */
-    unsigned
-        ll[MAXLITLENS + MAXDISTS]; /* lit./length and distance code lengths */
-    register uint32_t b;           /* bit buffer */
-    register unsigned k;           /* number of bits in bit buffer */
-    int retval = 0; /* error code returned: initialized to "no error" */
-
-    /* make local bit buffer */
-    Trace((stderr, "\ndynamic block"));
-    b = G.bb;
-    k = G.bk;
-
-    /* read in table lengths */
-    NEEDBITS(5);
-    nl = 257 + ((unsigned) b & 0x1f); /* number of literal/length codes */
-    DUMPBITS(5);
-    NEEDBITS(5);
-    nd = 1 + ((unsigned) b & 0x1f); /* number of distance codes */
-    DUMPBITS(5);
-    NEEDBITS(4);
-    nb = 4 + ((unsigned) b & 0xf); /* number of bit length codes */
-    DUMPBITS(4);
-    if (nl > MAXLITLENS || nd > MAXDISTS)
-        return 1; /* bad lengths */
-
-    /* read in bit-length-code lengths */
-    for (j = 0; j < nb; j++) {
-        NEEDBITS(3);
-        ll[border[j]] = (unsigned) b & 7;
-        DUMPBITS(3);
-    }
-    for (; j < 19; j++)
-        ll[border[j]] = 0;
-
-    /* build decoding table for trees--single level, 7 bit lookup */
-    bl = 7;
-    retval = huft_build(ll, 19, 19, NULL, NULL, &tl, &bl);
-    if (bl == 0) /* no bit lengths */
-        retval = 1;
-    if (retval) {
-        if (retval == 1)
-            huft_free(tl);
-        return retval; /* incomplete code set */
-    }
-
-    /* read in literal and distance code lengths */
-    n = nl + nd;
-    m = mask_bits[bl];
-    i = l = 0;
-    while (i < n) {
-        NEEDBITS(bl);
-        j = (th = tl + ((unsigned) b & m))->b;
-        DUMPBITS(j);
-        j = th->v.n;
-        if (j < 16)          /* length of code in bits (0..15) */
-            ll[i++] = l = j; /* save last length in l */
-        else if (j == 16) {
-            /* repeat last length 3 to 6 times */
-            NEEDBITS(2);
-            j = 3 + ((unsigned) b & 3);
-            DUMPBITS(2);
-            if ((unsigned) i + j > n) {
-                huft_free(tl);
-                return 1;
-            }
-            while (j--)
-                ll[i++] = l;
-        } else if (j == 17) {
-            /* 3 to 10 zero length codes */
-            NEEDBITS(3);
-            j = 3 + ((unsigned) b & 7);
-            DUMPBITS(3);
-            if ((unsigned) i + j > n) {
-                huft_free(tl);
-                return 1;
-            }
-            while (j--)
-                ll[i++] = 0;
-            l = 0;
-        } else {
-            /* j == 18: 11 to 138 zero length codes */
-            NEEDBITS(7);
-            j = 11 + ((unsigned) b & 0x7f);
-            DUMPBITS(7);
-            if ((unsigned) i + j > n) {
-                huft_free(tl);
-                return 1;
-            }
-            while (j--)
-                ll[i++] = 0;
-            l = 0;
-        }
-    }
-
-    /* free decoding table for trees */
-    huft_free(tl);
-
-    /* restore the global bit buffer */
-    G.bb = b;
-    G.bk = k;
-
-    /* build the decoding tables for literal/length and distance codes */
-    bl = lbits;
-    retval = huft_build(ll, nl, 257, G.cplens, G.cplext, &tl, &bl);
-    if (bl == 0) /* no literals or lengths */
-        retval = 1;
-    if (retval) {
-        if (retval == 1) {
-            if (!G.UzO.qflag)
-                MESSAGE((uint8_t *) "(incomplete l-tree)  ", 21L, 1);
-            huft_free(tl);
-        }
-        return retval; /* incomplete code set */
-    }
-    bd = dbits;
-    retval = huft_build(ll + nl, nd, 0, cpdist, G.cpdext, &td, &bd);
-    if (retval == 1)
-        retval = 0;
-    if (bd == 0 && nl > 257) /* lengths but no distances */
-        retval = 1;
-    if (retval) {
-        if (retval == 1) {
-            if (!G.UzO.qflag)
-                MESSAGE((uint8_t *) "(incomplete d-tree)  ", 21L, 1);
-            huft_free(td);
-        }
-        huft_free(tl);
-        return retval;
-    }
-
-    /* decompress until an end-of-block code */
-    retval = inflate_codes(tl, td, bl, bd);
-
-cleanup_and_exit:
-    /* free the decoding tables, return */
-    if (tl != NULL)
-        huft_free(tl);
-    if (td != NULL)
-        huft_free(td);
-    return retval;
+    huft_free(s->dtl);
+    huft_free(s->dtd);
+    s->dtl = s->dtd = NULL;
 }
 
-/* decompress an inflated block */
-static int inflate_block(e)
-int *e; /* last block flag */
+/* In a stream (see do_stream() in process.c), what follows the Deflate
+   data is read from where they end, so give the whole bytes still in the
+   bit buffer back to the input.  Some of them may have come from the last
+   buffer, not this one; the bit buffer has them all, and inbuf[] has room
+   for them (see process_zipfiles()). */
+static void inflate_unpull(s)
+const struct inflate_state *s;
 {
-    unsigned t;          /* block type */
-    register uint32_t b; /* bit buffer */
-    register unsigned k; /* number of bits in bit buffer */
-    int retval = 0;      /* error code returned: initialized to "no error" */
-
-    /* make local bit buffer */
-    b = G.bb;
-    k = G.bk;
-
-    /* read in last block bit */
-    NEEDBITS(1);
-    *e = (int) b & 1;
-    DUMPBITS(1);
-
-    /* read in block type */
-    NEEDBITS(2);
-    t = (unsigned) b & 3;
-    DUMPBITS(2);
-
-    /* restore the global bit buffer */
-    G.bb = b;
-    G.bk = k;
-
-    /* inflate that block type */
-    if (t == 2)
-        return inflate_dynamic();
-    if (t == 0)
-        return inflate_stored();
-    if (t == 1)
-        return inflate_fixed();
-
-    /* bad block type */
-    retval = 2;
-
-cleanup_and_exit:
-    return retval;
+    unsigned n = s->k > 0 ? (unsigned) s->k >> 3 : 0;
+    uint64_t b = s->b >> (s->k & 7);
+    unsigned i;
+
+    if (n == 0)
+        return;
+    if ((unsigned) (G.inptr - G.inbuf) < n) {
+        memmove(G.inbuf + n, G.inptr, (size_t) G.incnt);
+        G.inptr = G.inbuf + n;
+    }
+    G.inptr -= n;
+    G.incnt += (int) n;
+    for (i = 0; i < n; i++, b >>= 8)
+        G.inptr[i] = (uint8_t) b;
 }
 
-/* decompress an inflated entry */
-int inflate(is_defl64)
+/* decompress an inflated entry (see also UZinflate() in infsel.c) */
+int inflate_builtin(is_defl64)
 int is_defl64;
 {
-    int e; /* last block flag */
-    int r; /* result code */
+    struct inflate_state s;
+    int n, r;
+
+    /* the mapped output file, the ring or slide[], as flush_window()
+       expects */
+    G.wf = 0;
+    if (G.outmaplen != 0)
+        inflate_init(&s, is_defl64, G.ring, G.outmaplen, INF_FILE);
+    else if (G.ring != NULL)
+        inflate_init(&s, is_defl64, G.ring, RINGSIZ, INF_RING);
+    else /* Deflate needs only 32K of the 64K in slide[] */
+        inflate_init(&s, is_defl64, redirSlide, is_defl64 ? WSIZE : WSIZE / 2,
+                     INF_SLIDE);
 #ifdef DEBUG
-    unsigned h = 0; /* maximum struct huft's malloc'ed */
+    G.hufts = 0;
 #endif
 
-    /* initialize window, bit buffer */
-    G.wp = 0;
-    G.bk = 0;
-    G.bb = 0;
-
-    if (is_defl64) {
-        G.cplens = cplens64;
-        G.cplext = cplext64;
-        G.cpdext = cpdext64;
-        G.fixed_tl = G.fixed_tl64;
-        G.fixed_bl = G.fixed_bl64;
-        G.fixed_td = G.fixed_td64;
-        G.fixed_bd = G.fixed_bd64;
-    } else {
-        G.cplens = cplens32;
-        G.cplext = cplext32;
-        G.cpdext = cpdext32;
-        G.fixed_tl = G.fixed_tl32;
-        G.fixed_bl = G.fixed_bl32;
-        G.fixed_td = G.fixed_td32;
-        G.fixed_bd = G.fixed_bd32;
-    }
-
-    /* decompress until the last block */
-    do {
-#ifdef DEBUG
-        G.hufts = 0;
-#endif
-        if ((r = inflate_block(&e)) != 0)
-            return r;
-#ifdef DEBUG
-        if (G.hufts > h)
-            h = G.hufts;
-#endif
-    } while (!e);
+    s.next_in = G.inptr;
+    s.avail_in = G.incnt > 0 ? (unsigned) G.incnt : 0;
+    s.last_in = G.mem_mode || G.csize <= 0L;
+    while ((r = inflate_run(&s)) < 0)
+        if (r == INF_HAVE_OUTPUT) {
+            if ((r = flush_window(s.avail_out)) != 0)
+                break;
+        } else { /* INF_NEED_INPUT */
+            n = G.csize <= 0L ? 0 : fillinbuf();
+            s.next_in = G.inptr;
+            s.avail_in = (unsigned) n;
+            s.last_in = G.csize <= 0L || n == 0;
+        }
+    G.inptr = (uint8_t *) s.next_in;
+    G.incnt = (int) s.avail_in;
+    if (r == 0 && G.zipstream)
+        inflate_unpull(&s);
+    inflate_end(&s);
 
     Trace((stderr, "\n%u bytes in Huffman tables (%u/entry)\n",
-           h * (unsigned) sizeof(struct huft), (unsigned) sizeof(struct huft)));
-
-    if (is_defl64) {
-        G.fixed_tl64 = G.fixed_tl;
-        G.fixed_bl64 = G.fixed_bl;
-        G.fixed_td64 = G.fixed_td;
-        G.fixed_bd64 = G.fixed_bd;
-    } else {
-        G.fixed_tl32 = G.fixed_tl;
-        G.fixed_bl32 = G.fixed_bl;
-        G.fixed_td32 = G.fixed_td;
-        G.fixed_bd32 = G.fixed_bd;
-    }
-
-    /* flush out redirSlide and return (success, unless final FLUSH failed) */
-    return (FLUSH(G.wp));
-}
-
-int inflate_free()
-{
-    if (G.fixed_tl != NULL) {
-        huft_free(G.fixed_td);
-        huft_free(G.fixed_tl);
-        G.fixed_td = G.fixed_tl = NULL;
-    }
-    return 0;
+           G.hufts * (unsigned) sizeof(struct huft),
+           (unsigned) sizeof(struct huft)));
+    return r;
 }
 
 /* If BMAX needs to be larger than 16, then h and x[] should be uint32_t. */
@@ -0,0 +1,86 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* inflate.h -- the resumable Deflate decoder of inflate.c
+
+   The caller hands inflate_run() the input as it comes, and takes the
+   output from the window it set up with inflate_init(), much as with
+   zlib's z_stream:
+
+        inflate_init(&s, is_defl64, window, wsize, INF_SLIDE);
+        s.next_in = buf;  s.avail_in = len;  s.last_in = is_last;
+        while ((r = inflate_run(&s)) < 0)
+            if (r == INF_HAVE_OUTPUT)
+                use s.avail_out bytes at s.out
+            else  (INF_NEED_INPUT:  all of next_in has been used)
+                set next_in, avail_in and last_in again
+        inflate_end(&s);
+
+   and r is 0 at the end of the stream, or an error code as for
+   inflate_builtin().  The output at s.out stays there only until the
+   next call.  last_in says that no input follows; until it is set,
+   inflate_run() never takes the end of the input for the end of the
+   stream.
+
+   The window keeps the history that matches copy from:
+
+        INF_SLIDE   wsize bytes (a power of two, 32K or more for
+                    Deflate, 64K or more for Deflate64) used as a circular
+                    buffer; the output is handed over wsize bytes at a time
+        INF_RING    the mirrored ring of unzpriv.h:  wsize (RINGSIZ) bytes
+                    mapped twice, back to back; output comes in pieces of
+                    RINGFLUSH bytes or a little more
+        INF_FILE    all of the output in a row, as in a mapped output file,
+                    which must be RINGROOM bytes longer than the output
+ */
+
+#ifndef __inflate_h /* don't include more than once */
+#define __inflate_h
+
+#define INF_HAVE_OUTPUT (-1) /* take s.avail_out bytes at s.out */
+#define INF_NEED_INPUT  (-2) /* give more at s.next_in */
+
+#define INF_SLIDE 0 /* kinds of window (see above) */
+#define INF_RING  1
+#define INF_FILE  2
+
+struct huft;
+
+struct inflate_state {
+    const uint8_t *next_in; /* next input byte */
+    unsigned avail_in;      /* number of bytes at next_in */
+    int last_in;            /* no input after that */
+    uint8_t *out;           /* output ready for the caller */
+    unsigned avail_out;     /* number of bytes at out */
+
+    /* the rest is inflate.c's own */
+    int defl64;                  /* Deflate64 (method 9) */
+    int bmi2;                    /* use the decoder built for BMI2 */
+    int how;                     /* kind of window */
+    uint8_t *window;             /* the window, and its size */
+    size_t wsize;
+    size_t wf;                   /* start of pending output in window */
+    unsigned w;                  /* bytes pending */
+    unsigned wend;               /* flush point */
+    int mode;                    /* where inflate_run() goes on */
+    int err;                     /* error code, once it has failed */
+    int last;                    /* this block is the last one */
+    uint64_t b;                  /* bit buffer */
+    int k;                       /* bits in it (< 0:  past end of input) */
+    unsigned n, d;               /* bytes left to copy, and from where */
+    const struct huft *tl, *td;  /* literal/length and distance tables */
+    unsigned bl, bd;             /* lookup bits of tl and td */
+    struct huft *dtl, *dtd;      /* tables of a dynamic block */
+    unsigned nl, nd, nb, i, l;   /* dynamic block header */
+    unsigned ll[288 + 32];       /* its code lengths */
+};
+
+void inflate_init(struct inflate_state *s, int defl64, uint8_t *window,
+                  size_t wsize, int how);
+int inflate_run(struct inflate_state *s);
+void inflate_end(struct inflate_state *s);
+
+#endif /* !__inflate_h */
@@ -0,0 +1,271 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* infsel.c -- UZinflate(), which hands Deflate data to one of several
+   decoders
+
+   The built-in decoder, inflate_builtin() in inflate.c, is always there,
+   and it is the only one that does Deflate64.  A build may also include
+   a Deflate library:
+
+        libdeflate    USE_LIBDEFLATE         whole member in one call
+        zlib-ng       USE_ZLIB, USE_ZLIBNG   streaming, native zng_ API
+        zlib          USE_ZLIB               streaming
+
+   unix/configure looks for libdeflate and zlib-ng, which decode faster
+   than inflate.c.  It does not look for plain zlib, which does not; the
+   generic_zlib target builds with it.  zlib-ng built with the zlib
+   compatible API is used as zlib.  The first backend in inflaters[] is
+   the default.  -I name picks another for the run (G.inflater).
+
+   A streaming backend reads the input the way inflate.c does (G.inptr,
+   G.incnt, fillinbuf()) and writes into the output window, passing it
+   to flush_window().  A whole-buffer backend decodes a member in one call
+   when its compressed and uncompressed sizes are both no more than
+   WHOLEMAX:  inflate_whole() reads all of the input into memory, has the
+   backend decode it, and then passes the output to the flush routine in
+   pieces of WSIZE bytes.  Larger members go to inflate.c instead.  If
+   the output file is mapped as the window (see map_output() in fileio.c),
+   it is the output buffer of inflate_whole(), too. */
+
+#include "unzip.h"
+
+#ifdef USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#ifdef USE_ZLIB
+#ifdef USE_ZLIBNG
+#include <zlib-ng.h>
+#define z_stream     zng_stream
+#define inflateInit2 zng_inflateInit2
+#define inflate      zng_inflate
+#define inflateEnd   zng_inflateEnd
+#else
+#include <zlib.h>
+#endif
+#endif
+
+#ifndef WHOLEMAX
+#define WHOLEMAX (64L << 20) /* largest member decoded in one call */
+#endif
+
+struct inflater {
+    const char *name;
+    int (*stream)(void); /* decode from the input, or NULL */
+    int (*buffer)(uint8_t *out, size_t *outlen, const uint8_t *in,
+                  size_t inlen); /* decode in memory, or NULL */
+};
+
+static int builtin_stream(void);
+#ifdef USE_ZLIB
+static int zlib_stream(void);
+#endif
+#ifdef USE_LIBDEFLATE
+static int libdeflate_buffer(uint8_t *out, size_t *outlen, const uint8_t *in,
+                             size_t inlen);
+#endif
+static int inflate_whole(const struct inflater *f);
+
+static const struct inflater inflaters[] = {
+#ifdef USE_LIBDEFLATE
+    {"libdeflate", NULL, libdeflate_buffer},
+#endif
+#ifdef USE_ZLIB
+#ifdef USE_ZLIBNG
+    {"zlib-ng", zlib_stream, NULL},
+#else
+    {"zlib", zlib_stream, NULL},
+#endif
+#endif
+    {"builtin", builtin_stream, NULL},
+    {NULL, NULL, NULL}};
+
+static const char UnknownInflater[] =
+    "error:  unknown Deflate backend \"%s\" (this UnZip has:%s)\n";
+
+/* -I name:  use the backend called name, if there is one */
+int inflate_select(name)
+const char *name;
+{
+    const struct inflater *f;
+    char have[80];
+
+    for (f = inflaters; f->name != NULL; f++)
+        if (strcmp(name, f->name) == 0) {
+            G.inflater = f;
+            return PK_OK;
+        }
+    for (*have = '\0', f = inflaters; f->name != NULL; f++) {
+        strcat(have, " ");
+        strcat(have, f->name);
+    }
+    Info(slide, 1, ((char *) slide, UnknownInflater, name, have));
+    return PK_PARAM;
+}
+
+/* decompress a Deflate (or, if is_defl64, Deflate64) entry:  0 if OK,
+   otherwise an error code as inflate_builtin() */
+int UZinflate(is_defl64)
+int is_defl64;
+{
+    const struct inflater *f = G.inflater ? G.inflater : inflaters;
+    off_t insize = G.mem_mode ? (off_t) G.incnt : G.csize + G.incnt;
+    off_t outsize = G.mem_mode ? (off_t) G.outsize : G.lrec.ucsize;
+
+    if (is_defl64) /* only inflate.c knows Deflate64 */
+        return inflate_builtin(TRUE);
+    if (f->buffer != NULL && insize <= WHOLEMAX && outsize <= WHOLEMAX) {
+        int r = inflate_whole(f);
+
+        if (r >= 0)
+            return r;
+    }
+    if (f->stream != NULL)
+        return (*f->stream)();
+    return inflate_builtin(FALSE);
+}
+
+static int builtin_stream(void)
+{
+    return inflate_builtin(FALSE);
+}
+
+/* Read the whole member, decode it with f->buffer and flush the result.
+   Returns -1, having read nothing, if there is not enough memory. */
+static int inflate_whole(f)
+const struct inflater *f;
+{
+    uint8_t *in, *out;
+    size_t insize, outsize, n;
+    int r;
+
+    outsize = (size_t) (G.mem_mode ? G.outsize : G.lrec.ucsize);
+    insize = (size_t) (G.mem_mode ? G.incnt : G.csize + G.incnt);
+    if (G.outmaplen != 0)
+        out = G.ring; /* the output file */
+    else if ((out = (uint8_t *) malloc(outsize + 1)) == NULL)
+        return -1;
+    if (G.mem_mode) {
+        in = G.inptr; /* memextract():  all there already */
+    } else {
+        if ((in = (uint8_t *) malloc(insize + 1)) == NULL) {
+            if (G.outmaplen == 0)
+                free(out);
+            return -1;
+        }
+        for (n = 0; n < insize;) {
+            memcpy(in + n, G.inptr, (size_t) G.incnt);
+            n += G.incnt;
+            G.inptr += G.incnt;
+            G.incnt = 0;
+            if (G.csize <= 0L || fillinbuf() == 0)
+                break;
+        }
+        insize = n;
+    }
+    Trace((stderr, "inflate_whole:  %s, %lu -> %lu bytes\n", f->name,
+           (unsigned long) insize, (unsigned long) outsize));
+
+    r = (*f->buffer)(out, &outsize, in, insize);
+    for (n = 0; r == 0;) { /* at least once, to set G.outcnt in mem_mode */
+        size_t w = MIN(outsize - n, WSIZE);
+
+        r = (*G.flush)(out + n, (uint32_t) w);
+        if ((n += w) == outsize)
+            break;
+    }
+
+    if (!G.mem_mode)
+        free(in);
+    if (G.outmaplen != 0)
+        G.wf = n; /* flushed, as flush_window() would count it */
+    else
+        free(out);
+    return r;
+}
+
+#ifdef USE_LIBDEFLATE
+static int libdeflate_buffer(out, outlen, in, inlen)
+uint8_t *out;
+size_t *outlen;
+const uint8_t *in;
+size_t inlen;
+{
+    struct libdeflate_decompressor *d;
+    enum libdeflate_result res;
+    size_t used;
+
+    if ((d = libdeflate_alloc_decompressor()) == NULL)
+        return 3;
+    /* more output than ucsize is an error, less is left to the caller */
+    res = libdeflate_deflate_decompress_ex(d, in, inlen, out, *outlen, &used,
+                                           outlen);
+    libdeflate_free_decompressor(d);
+    if (res != LIBDEFLATE_SUCCESS) {
+        Trace((stderr, "libdeflate_buffer:  result %d\n", (int) res));
+        return 2;
+    }
+    return 0;
+}
+#endif /* USE_LIBDEFLATE */
+
+#ifdef USE_ZLIB
+/* decompress a Deflate entry with zlib (or zlib-ng) */
+static int zlib_stream(void)
+{
+    z_stream zs;
+    uint8_t *out;
+    unsigned w, wend;
+    int err, retval = 0;
+
+    memzero(&zs, sizeof(zs));
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+        return 3;
+    zs.next_in = G.inptr;
+    zs.avail_in = G.incnt > 0 ? (unsigned) G.incnt : 0;
+
+    G.wf = 0; /* as inflate_builtin() */
+    out = WINDOW;
+    wend = WINDOWEND;
+    w = 0;
+    for (;;) {
+        zs.next_out = out + w;
+        zs.avail_out = wend - w;
+        err = inflate(&zs, Z_NO_FLUSH);
+        w = wend - (unsigned) zs.avail_out;
+        if (err == Z_STREAM_END)
+            break;
+        if (err != Z_OK && err != Z_BUF_ERROR) {
+            Trace((stderr, "zlib_stream:  inflate() error %d\n", err));
+            retval = err == Z_MEM_ERROR ? 3 : 2;
+            goto zlib_cleanup_exit;
+        }
+        if (w == wend) { /* window full:  flush it and go on */
+            if ((retval = flush_window(w)) != 0)
+                goto zlib_cleanup_exit;
+            out = WINDOW;
+            w = 0;
+        } else if (zs.avail_in == 0) { /* all input used:  get more */
+            if (G.csize <= 0L || fillinbuf() == 0) {
+                retval = 2; /* input ended in the middle of the stream */
+                goto zlib_cleanup_exit;
+            }
+            zs.next_in = G.inptr;
+            zs.avail_in = (unsigned) G.incnt;
+        } else if (err == Z_BUF_ERROR) { /* no progress possible */
+            retval = 2;
+            goto zlib_cleanup_exit;
+        }
+    }
+    retval = flush_window(w);
+
+zlib_cleanup_exit:
+    G.inptr = (uint8_t *) zs.next_in;
+    G.incnt = (int) zs.avail_in;
+    inflateEnd(&zs);
+    return retval;
+}
+#endif /* USE_ZLIB */
@@ -44,7 +44,8 @@ int list_files() /* return PK-type error code */
     static const char method[NUM_METHODS + 1][8] = {
         "Stored",  "Shrunk", "Reduce1", "Reduce2", "Reduce3", "Reduce4",
         "Implode", "Token",  "Defl:#",  "Def64#",  "ImplDCL", "BZip2",
-        "LZMA",    "Terse",  "IBMLZ77", "WavPack", "PPMd",    "Unk:###"};
+        "LZMA",    "Terse",  "IBMLZ77", "Zstd",    "WavPack", "PPMd",
+        "Unk:###"};
 
     /*---------------------------------------------------------------------------
         Unlike extract_or_test_files(), this routine confines itself to the cen-
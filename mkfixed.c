@@ -0,0 +1,158 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* mkfixed.c -- write inffixed.h, the fixed Huffman tables for inflate.c
+
+   A fixed block (type 1) uses the same codes every time:  literal/length
+   codes 0..143 are 8 bits, 144..255 are 9, 256..279 are 7 and 280..287
+   are 8 (286 and 287 complete the code but are invalid), and all 32
+   distance codes are 5 bits (30 and 31 only valid for Deflate64).  Since
+   none of them is longer than 9 bits, each table is a single level:  512
+   entries for literals/lengths and 32 for distances, indexed by the next
+   9 or 5 bits of input, in the struct huft format inflate_codes() reads.
+   Because nothing points anywhere, they can be const data.
+
+   huft_build() would end the first table level at the end-of-block code
+   (7 bits).  With the bit reader in bitread.h that is not needed:  it
+   lets a decoder look at bits past the end of the input, as long as it
+   does not use them.
+
+   inffixed.h is kept in the source, so building UnZip does not run this.
+   After changing it, or the length and distance tables in inflate.c, do
+
+        make -f unix/Makefile inffixed
+
+   The tables here must match those in inflate.c. */
+
+#include <stdio.h>
+#include <string.h>
+
+#define INVALID_CODE 99 /* as in inflate.c */
+
+/* Copy lengths and extra bits for literal codes 257..287 */
+static const unsigned cplens32[] = {
+    3,  4,  5,  6,  7,  8,  9,  10,  11,  13,  15,  17,  19,  23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0,  0};
+static const unsigned cplens64[] = {
+    3,  4,  5,  6,  7,  8,  9,  10,  11,  13,  15,  17,  19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 3,  0,  0};
+static const unsigned cplext32[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, INVALID_CODE, INVALID_CODE};
+static const unsigned cplext64[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 16, INVALID_CODE, INVALID_CODE};
+
+/* Copy offsets and extra bits for distance codes 0..31 */
+static const unsigned cpdist[] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,    25,   33,
+    49,   65,   97,   129,  193,  257,   385,   513,   769,   1025, 1537,
+    2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 32769, 49153};
+static const unsigned cpdext32[] = {
+    0,  0,  0,  0,  1,  1,  2,  2,  3,  3,  4,  4,  5,  5,  6,  6,
+    7,  7,  8,  8,  9,  9,  10, 10, 11, 11, 12, 12, 13, 13,
+    INVALID_CODE, INVALID_CODE};
+static const unsigned cpdext64[] = {
+    0,  0,  0,  0,  1,  1,  2,  2,  3,  3,  4,  4,  5,  5,  6,  6,
+    7,  7,  8,  8,  9,  9,  10, 10, 11, 11, 12, 12, 13, 13, 14, 14};
+
+struct entry {
+    unsigned e, b, n; /* as in struct huft */
+};
+
+static void fill(struct entry *t, unsigned bits, unsigned code,
+                 unsigned len, unsigned e, unsigned n);
+static void put(const char *name, const struct entry *t, unsigned size);
+static void literals(const char *name, const unsigned *lens,
+                     const unsigned *ext);
+static void distances(const char *name, const unsigned *ext);
+
+/* Enter the len-bit code for a symbol into every slot of the (1 << bits)
+   entry table t whose low len bits are that code, bit reversed. */
+static void fill(t, bits, code, len, e, n)
+struct entry *t;
+unsigned bits, code, len, e, n;
+{
+    unsigned i, r;
+
+    for (r = 0, i = 0; i < len; i++) /* codes go in msb first */
+        r = (r << 1) | ((code >> i) & 1);
+    for (i = r; i < (1U << bits); i += 1U << len) {
+        t[i].e = e;
+        t[i].b = len;
+        t[i].n = n;
+    }
+}
+
+static void put(name, t, size)
+const char *name;
+const struct entry *t;
+unsigned size;
+{
+    unsigned i;
+    int col = 4;
+    char s[32];
+
+    printf("\nstatic const struct huft %s[%u] = {\n   ", name, size);
+    for (i = 0; i < size; i++) {
+        sprintf(s, " {%u, %u, {%u}}%s", t[i].e, t[i].b, t[i].n,
+                i + 1 < size ? "," : "");
+        if (col + (int) strlen(s) > 79) {
+            printf("\n   ");
+            col = 4;
+        }
+        fputs(s, stdout);
+        col += (int) strlen(s);
+    }
+    printf("};\n");
+}
+
+static void literals(name, lens, ext)
+const char *name;
+const unsigned *lens, *ext;
+{
+    struct entry t[512];
+    unsigned sym, code;
+
+    /* the codes in order:  7 bits, then 8, then 9 */
+    for (sym = 256, code = 0; sym < 280; sym++, code++)
+        if (sym == 256)
+            fill(t, 9, code, 7, 31, 256); /* end of block */
+        else
+            fill(t, 9, code, 7, ext[sym - 257], lens[sym - 257]);
+    for (code <<= 1, sym = 0; sym < 144; sym++, code++)
+        fill(t, 9, code, 8, 32, sym);
+    for (sym = 280; sym < 288; sym++, code++)
+        fill(t, 9, code, 8, ext[sym - 257], lens[sym - 257]);
+    for (code <<= 1, sym = 144; sym < 256; sym++, code++)
+        fill(t, 9, code, 9, 32, sym);
+    put(name, t, 512);
+}
+
+static void distances(name, ext)
+const char *name;
+const unsigned *ext;
+{
+    struct entry t[32];
+    unsigned sym;
+
+    for (sym = 0; sym < 32; sym++)
+        fill(t, 5, sym, 5, ext[sym], cpdist[sym]);
+    put(name, t, 32);
+}
+
+int main()
+{
+    printf("/* inffixed.h -- fixed Huffman tables for inflate.c\n");
+    printf("   Generated by mkfixed.c:  do not edit. */\n");
+    printf("\n#define FIXED_BL 9 /* lookup bits of fixed_tl32/64 */\n");
+    printf("#define FIXED_BD 5 /* lookup bits of fixed_td32/64 */\n");
+    literals("fixed_tl32", cplens32, cplext32);
+    literals("fixed_tl64", cplens64, cplext64);
+    distances("fixed_td32", cpdext32);
+    distances("fixed_td64", cpdext64);
+    return 0;
+}
@@ -7,16 +7,34 @@
 
 /* This file contains top-level routines for processing multiple zipfiles. */
 
+#ifdef HAVE_MEMRCHR
+#define _GNU_SOURCE /* memrchr() */
+#endif
+
 #include "unzip.h"
 #include "crc32.h"
 
 static int do_seekable(int lastchance);
+static int do_stream(void);
 static off_t file_size(int fh);
-static int rec_find(off_t, char *, int);
-static int find_ecrec64(off_t searchlen);
+
+/* the end of the zipfile, read in one go by find_ecrec() */
+struct ztail {
+    uint8_t *buf;
+    off_t start; /* offset of buf[0] in the zipfile */
+    unsigned len;
+};
+
+static uint8_t *sig_rfind(uint8_t *buf, unsigned len, const char *sig);
+static int rec_find(struct ztail *t, off_t searchlen, char *signature,
+                    int rec_size);
+static int tail_read(struct ztail *t, uint8_t *buf, off_t ofs, unsigned len);
+static int find_ecrec64(struct ztail *t);
 static int find_ecrec(off_t searchlen);
+static int find_volumes(void);
 static int process_zip_cmmnt(void);
 static int get_cdir_ent(void);
+static void cdir_hdr_info(void);
 static int read_ux3_value(const uint8_t *dbuf, unsigned uidgid_sz,
                           uint32_t *p_uidgid);
 
@@ -53,8 +71,9 @@ static const char EndCentDirBogus[] =
 static const char MaybePakBug[] = "warning [%s]:\
   zipfile claims to be last disk of a multi-part archive;\n\
   attempting to process anyway, assuming all parts have been concatenated\n\
-  together in order.  Expect \"errors\" and warnings...true multi-part support\
-\n  doesn't exist yet (coming soon).\n";
+  together in order.  Expect \"errors\" and warnings.\n";
+static const char VolumeMissing[] =
+    "warning [%s]:  cannot open %s, disk %u of the split archive:  %s\n";
 static const char ExtraBytesAtStart[] =
     "warning [%s]:  %s extra byte%s at beginning or within zipfile\n\
   (attempting to process anyway)\n";
@@ -83,6 +102,9 @@ static const char CentDirEndSigNotFound[] = "\
   a zipfile, or it constitutes one disk of a multi-part archive.  In the\n\
   latter case the central directory and zipfile comment will be found on\n\
   the last disk(s) of this archive.\n";
+static const char StreamCannotList[] =
+    "error [%s]:  a zipfile read from a pipe or followed (-F) can only be "
+    "extracted or tested\n";
 static const char ZipTimeStampFailed[] = "warning:  cannot set time for %s\n";
 static const char ZipfileCommTrunc1[] =
     "\ncaution:  zipfile comment truncated\n";
@@ -105,9 +127,10 @@ int process_zipfiles() /* return PK-type error code */
       signature strings.
       ---------------------------------------------------------------------------*/
 
-    G.inbuf = checked_malloc(INBUFSIZ + 4);   /* 4 extra for hold[] (below) */
+    /* 8 more for the bytes inflate_unpull() may put back in a stream */
+    G.inbuf = checked_malloc(INBUFSIZ + 4 + 8);
     G.outbuf = checked_malloc(OUTBUFSIZ + 1); /* 1 extra for string term. */
-    G.hold = G.inbuf + INBUFSIZ; /* to check for boundary-spanning sigs */
+    G.ring = G.mirror = map_ring(RINGSIZ); /* NULL:  use slide */
 
     /* finish up initialization of magic signature strings */
     local_hdr_sig[0] /* = extd_local_sig[0] */ =  /* ASCII 'P', */
@@ -280,11 +303,15 @@ void free_G_buffers() /* releases all memory allocated in global vars */
 {
     unsigned i;
 
-    inflate_free();
+    explode_free();
     checkdir_end(NULL);
 
     free(G.key);
     G.key = NULL;
+    free(G.aes);
+    G.aes = NULL;
+    free(G.cryptsave);
+    G.cryptsave = NULL;
 
     free(G.extra_field);
     G.extra_field = NULL;
@@ -296,6 +323,13 @@ void free_G_buffers() /* releases all memory allocated in global vars */
     free(G.inbuf);
     G.inbuf = G.outbuf = NULL;
 
+    free(G.rcd);
+    G.rcd = NULL;
+
+    if (G.mirror != NULL)
+        unmap_ring(G.mirror, RINGSIZ);
+    G.ring = G.mirror = NULL;
+
     free(G.filename_full);
     G.filename_full = NULL;
     G.fnfull_bufsize = 0;
@@ -327,6 +361,8 @@ int lastchance;
       translation, which would corrupt the bit streams.
       ---------------------------------------------------------------------------*/
 
+    if (strcmp(G.zipfn, "-") == 0)
+        return do_stream();
     if (stat(G.zipfn, &G.statbuf) ||
         (error = S_ISDIR(G.statbuf.st_mode)) != 0) {
         if (lastchance && (G.UzO.qflag < 3)) {
@@ -341,6 +377,8 @@ int lastchance;
         }
         return error ? IZ_DIR : PK_NOZIP;
     }
+    if (S_ISFIFO(G.statbuf.st_mode) || G.UzO.F_flag)
+        return do_stream(); /* a pipe, or a zipfile still being written */
     G.ziplen = G.statbuf.st_size;
 
     if (G.statbuf.st_mode & S_IXUSR) /* no extension on Unix exes:  might */
@@ -368,12 +406,17 @@ int lastchance;
 
     G.cur_zipfile_bufstart = 0;
     G.inptr = G.inbuf;
+    free(G.rcd); /* rebuilt for the last zipfile, if any */
+    G.rcd = NULL;
 
     if (!G.UzO.qflag && !G.UzO.T_flag) {
         printf("Archive:  %s\n", G.zipfn);
     }
 
-    if ((error_in_archive = find_ecrec(MIN(G.ziplen, 66000L))) > PK_WARN) {
+    error_in_archive = find_ecrec(MIN(G.ziplen, 66000L));
+    if (error_in_archive > PK_WARN && G.UzO.R_flag)
+        error_in_archive = recover_cdir();
+    if (error_in_archive > PK_WARN) {
         CLOSE_INFILE();
 
         if (maybe_exe)
@@ -394,9 +437,10 @@ int lastchance;
         archives) or inconsistencies (missing or extra bytes in zipfile).
       ---------------------------------------------------------------------------*/
 
-    error = (G.ecrec.number_this_disk != 0);
+    error = (G.ecrec.number_this_disk != 0 && !find_volumes());
 
-    if (G.ecrec.number_this_disk != G.ecrec.num_disk_start_cdir) {
+    if (G.nvol == 0 &&
+        G.ecrec.number_this_disk != G.ecrec.num_disk_start_cdir) {
         if (G.ecrec.number_this_disk > G.ecrec.num_disk_start_cdir) {
             Info(slide, 1,
                  ((char *) slide, CentDirNotInZipMsg, G.zipfn,
@@ -476,13 +520,19 @@ int lastchance;
                 if (error != PK_BADERR)
                     Info(slide, 1,
                          ((char *) slide, CentDirStartNotFound, G.zipfn));
-                CLOSE_INFILE();
-                return (error != PK_OK ? error : PK_BADERR);
+                if (!G.UzO.R_flag || error == PK_BADERR ||
+                    (error = recover_cdir()) > PK_WARN) {
+                    CLOSE_INFILE();
+                    return (error != PK_OK ? error : PK_BADERR);
+                }
+                if (error > error_in_archive)
+                    error_in_archive = error;
+            } else {
+                Info(slide, 1,
+                     ((char *) slide, CentDirTooLong, G.zipfn,
+                      format_off_t((-tmp), NULL, NULL)));
+                error_in_archive = PK_ERR;
             }
-            Info(slide, 1,
-                 ((char *) slide, CentDirTooLong, G.zipfn,
-                  format_off_t((-tmp), NULL, NULL)));
-            error_in_archive = PK_ERR;
         }
 
         /*-----------------------------------------------------------------------
@@ -528,6 +578,59 @@ int lastchance;
     return error_in_archive;
 }
 
+/*---------------------------------------------------------------------------
+    A zipfile that is a pipe ("-" for standard input, or a FIFO) cannot be
+    searched for its central directory.  It is read once through instead,
+    extracting or testing each member as its local header comes along (see
+    extract_or_test_stream() in extract.c); the central directory is only
+    checked against what was found when it comes at the end.  So is a
+    zipfile that is still being written (-F), except that at its end we
+    wait for it to grow (see follow_wait() in fileio.c) until its end of
+    central directory record has come.
+  ---------------------------------------------------------------------------*/
+
+static int do_stream() /* return PK-type error code */
+{
+    int error;
+
+    if (G.UzO.zflag > 0 || G.UzO.T_flag ||
+        (G.UzO.vflag && !G.UzO.tflag && !G.UzO.cflag)) {
+        Info(slide, 1, ((char *) slide, StreamCannotList, G.zipfn));
+        return PK_PARAM;
+    }
+    if (strcmp(G.zipfn, "-") == 0)
+        G.zipfd = 0;
+    else if (open_input_file())
+        return PK_NOZIP;
+    G.zipstream = TRUE;
+    G.zipfollow = G.UzO.F_flag && fstat(G.zipfd, &G.statbuf) == 0 &&
+                  S_ISREG(G.statbuf.st_mode);
+    G.followfd = -1;
+    G.ziplen = 0;
+    G.cur_zipfile_bufstart = 0;
+    G.inptr = G.inbuf;
+    G.incnt = 0;
+    G.extra_bytes = 0;
+    memzero(&G.ecrec, sizeof(G.ecrec));
+    free(G.rcd);
+    G.rcd = NULL;
+
+    /* the zipfile is standard input:  no one to answer the queries */
+    if (G.zipfd == 0 && G.overwrite_mode == OVERWRT_QUERY)
+        G.overwrite_mode = OVERWRT_NEVER;
+
+    if (!G.UzO.qflag)
+        printf("Archive:  %s\n", G.zipfn);
+    error = extract_or_test_files();
+
+    if (G.zipfd != 0)
+        CLOSE_INFILE();
+    if (G.followfd >= 0)
+        close(G.followfd);
+    G.zipstream = G.zipfollow = FALSE;
+    return error;
+}
+
 /* File size determination which does not mislead for large files in a
    small-file program.  Probably should be somewhere else.
    The file has to be opened previously
@@ -567,71 +670,90 @@ int fh;
     return ofs;
 }
 
-static int rec_find(searchlen, signature, rec_size)
+/* Return the last place in buf[0..len-1] where the four bytes at sig
+   start, or NULL if there is none.  memrchr() looks for the first byte of
+   sig many bytes at a time. */
+static uint8_t *sig_rfind(buf, len, sig)
+uint8_t *buf;
+unsigned len;
+const char *sig;
+{
+    uint8_t *p;
+
+    if (len < 4)
+        return NULL;
+#ifdef HAVE_MEMRCHR
+    for (len -= 3; (p = memrchr(buf, sig[0], len)) != NULL;
+         len = (unsigned) (p - buf))
+        if (memcmp(p, sig, 4) == 0)
+            return p;
+#else
+    for (p = buf + len - 4; p >= buf; p--)
+        if (*p == (uint8_t) sig[0] && memcmp(p, sig, 4) == 0)
+            return p;
+#endif
+    return NULL;
+}
+
+static int rec_find(t, searchlen, signature, rec_size)
 /* return 0 when rec found, 1 when not found, 2 in case of read error */
+struct ztail *t;
 off_t searchlen;
 char *signature;
 int rec_size;
 {
-    int i, numblks, found = FALSE;
-    off_t tail_len;
+    uint8_t *p;
+    off_t sigpos, end;
+    unsigned skip = (unsigned) (t->len - searchlen);
 
     /*---------------------------------------------------------------------------
-        Zipfile is longer than INBUFSIZ:  may need to loop.  Start with short
-        block at end of zipfile (if not TOO short).
+        The signature is somewhere in the last searchlen bytes of t, with at
+        least rec_size bytes after it.  On finding it, set up the input
+        buffer as if the block of the zipfile that holds it had just been
+        read, with G.inptr at the signature.
       ---------------------------------------------------------------------------*/
 
-    if ((tail_len = G.ziplen % INBUFSIZ) > rec_size) {
-        G.cur_zipfile_bufstart = lseek(G.zipfd, G.ziplen - tail_len, SEEK_SET);
-        if ((G.incnt = read(G.zipfd, (char *) G.inbuf,
-                            (unsigned int) tail_len)) != (int) tail_len)
-            return 2; /* it's expedient... */
-
-        /* 'P' must be at least (rec_size+4) bytes from end of zipfile */
-        for (G.inptr = G.inbuf + (int) tail_len - (rec_size + 4);
-             G.inptr >= G.inbuf; --G.inptr) {
-            if (*G.inptr == (uint8_t) 0x50 && /* ASCII 'P' */
-                !memcmp((char *) G.inptr, signature, 4)) {
-                G.incnt -= (int) (G.inptr - G.inbuf);
-                found = TRUE;
-                break;
-            }
-        }
-        /* sig may span block boundary: */
-        memcpy((char *) G.hold, (char *) G.inbuf, 3);
-    } else
-        G.cur_zipfile_bufstart = G.ziplen - tail_len;
-
-    /*-----------------------------------------------------------------------
-        Loop through blocks of zipfile data, starting at the end and going
-        toward the beginning.  In general, need not check whole zipfile for
-        signature, but may want to do so if testing.
-      -----------------------------------------------------------------------*/
-
-    numblks = (int) ((searchlen - tail_len + (INBUFSIZ - 1)) / INBUFSIZ);
-    /*               ==amount=   ==done==   ==rounding==    =blksiz=  */
-
-    for (i = 1; !found && (i <= numblks); ++i) {
-        G.cur_zipfile_bufstart -= INBUFSIZ;
-        lseek(G.zipfd, G.cur_zipfile_bufstart, SEEK_SET);
-        if ((G.incnt = read(G.zipfd, (char *) G.inbuf, INBUFSIZ)) != INBUFSIZ)
-            return 2; /* read error is fatal failure */
-
-        for (G.inptr = G.inbuf + INBUFSIZ - 1; G.inptr >= G.inbuf; --G.inptr)
-            if (*G.inptr == (uint8_t) 0x50 && /* ASCII 'P' */
-                !memcmp((char *) G.inptr, signature, 4)) {
-                G.incnt -= (int) (G.inptr - G.inbuf);
-                found = TRUE;
-                break;
-            }
-        /* sig may span block boundary: */
-        memcpy((char *) G.hold, (char *) G.inbuf, 3);
+    if (searchlen < rec_size + 4 ||
+        (p = sig_rfind(t->buf + skip, (unsigned) searchlen - rec_size,
+                       signature)) == NULL)
+        return 1;
+    sigpos = t->start + (p - t->buf);
+    G.cur_zipfile_bufstart = sigpos - sigpos % INBUFSIZ;
+    end = MIN(G.cur_zipfile_bufstart + INBUFSIZ, G.ziplen);
+    if (G.cur_zipfile_bufstart >= t->start) {
+        memcpy(G.inbuf, t->buf + (G.cur_zipfile_bufstart - t->start),
+               (size_t) (end - G.cur_zipfile_bufstart));
+        if (lseek(G.zipfd, end, SEEK_SET) != end)
+            return 2;
+    } else if (lseek(G.zipfd, G.cur_zipfile_bufstart, SEEK_SET) !=
+                   G.cur_zipfile_bufstart ||
+               read(G.zipfd, (char *) G.inbuf,
+                    (unsigned) (end - G.cur_zipfile_bufstart)) !=
+                   (int) (end - G.cur_zipfile_bufstart))
+        return 2;
+    G.inptr = G.inbuf + (int) (sigpos - G.cur_zipfile_bufstart);
+    G.incnt = (int) (end - sigpos);
+    return 0;
+}
+
+/* Get len bytes at ofs in the zipfile into buf:  from t if it has them,
+   otherwise by reading them.  Returns FALSE if they cannot be read. */
+static int tail_read(t, buf, ofs, len)
+struct ztail *t;
+uint8_t *buf;
+off_t ofs;
+unsigned len;
+{
+    if (ofs >= t->start && ofs + len <= t->start + t->len) {
+        memcpy(buf, t->buf + (ofs - t->start), len);
+        return TRUE;
     }
-    return (found ? 0 : 1);
+    G.cur_zipfile_bufstart = lseek(G.zipfd, ofs, SEEK_SET);
+    return (G.incnt = read(G.zipfd, (char *) buf, len)) == (int) len;
 }
 
-static int find_ecrec64(searchlen) /* return PK-class error */
-off_t searchlen;
+static int find_ecrec64(t) /* return PK-class error */
+struct ztail *t;
 {
     ec_byte_rec64 byterec;         /* buf for ecrec64 */
     ec_byte_loc64 byterecL;        /* buf for ecrec64 locator */
@@ -654,10 +776,7 @@ off_t searchlen;
         /* Seeking would go past beginning, so probably empty archive */
         return PK_COOL;
 
-    G.cur_zipfile_bufstart = lseek(G.zipfd, ecloc64_start_offset, SEEK_SET);
-
-    if ((G.incnt = read(G.zipfd, (char *) byterecL, ECLOC64_SIZE + 4)) !=
-        (ECLOC64_SIZE + 4)) {
+    if (!tail_read(t, byterecL, ecloc64_start_offset, ECLOC64_SIZE + 4)) {
         if (G.UzO.qflag)
             Info(slide, 1, ((char *) slide, "[%s]\n", G.zipfn));
         Info(slide, 1, ((char *) slide, Cent64EndSigSearchErr));
@@ -717,10 +836,8 @@ off_t searchlen;
         return PK_ERR;
     }
 
-    G.cur_zipfile_bufstart = lseek(G.zipfd, ecrec64_start_offset, SEEK_SET);
-
-    if ((G.incnt = read(G.zipfd, (char *) byterec, ECREC64_SIZE + 4)) !=
-        ECREC64_SIZE + 4) {
+    if (!tail_read(t, byterec, (off_t) ecrec64_start_offset,
+                   ECREC64_SIZE + 4)) {
         if (G.UzO.qflag)
             Info(slide, 1, ((char *) slide, "[%s]\n", G.zipfn));
         Info(slide, 1, ((char *) slide, Cent64EndSigSearchErr));
@@ -736,10 +853,8 @@ off_t searchlen;
         /* Make a guess as to where the Zip64 EOCD Record might be */
         ecrec64_start_offset = ecloc64_start_offset - ECREC64_SIZE - 4;
 
-        G.cur_zipfile_bufstart = lseek(G.zipfd, ecrec64_start_offset, SEEK_SET);
-
-        if ((G.incnt = read(G.zipfd, (char *) byterec, ECREC64_SIZE + 4)) !=
-            (ECREC64_SIZE + 4)) {
+        if (!tail_read(t, byterec, (off_t) ecrec64_start_offset,
+                       ECREC64_SIZE + 4)) {
             if (G.UzO.qflag)
                 Info(slide, 1, ((char *) slide, "[%s]\n", G.zipfn));
             Info(slide, 1, ((char *) slide, Cent64EndSigSearchErr));
@@ -844,39 +959,23 @@ off_t searchlen;
     int error_in_archive;
     int result;
     ec_byte_rec byterec;
+    struct ztail t;
 
     /*---------------------------------------------------------------------------
-        Treat case of short zipfile separately.
+        Read the last searchlen bytes of the zipfile, where the signature
+        must be, and the Zip64 end-of-central-dir locator and record that
+        may be just in front of them, all in one go.  rec_find() looks for
+        the signature in them, and find_ecrec64() finds the Zip64 records
+        there as well unless they are somewhere else.
       ---------------------------------------------------------------------------*/
 
-    if (G.ziplen <= INBUFSIZ) {
-        lseek(G.zipfd, 0L, SEEK_SET);
-        if ((G.incnt = read(G.zipfd, (char *) G.inbuf,
-                            (unsigned int) G.ziplen)) == (int) G.ziplen)
-
-            /* 'P' must be at least (ECREC_SIZE+4) bytes from end of zipfile */
-            for (G.inptr = G.inbuf + (int) G.ziplen - (ECREC_SIZE + 4);
-                 G.inptr >= G.inbuf; --G.inptr) {
-                if (*G.inptr == (uint8_t) 0x50 && /* ASCII 'P' */
-                    !memcmp((char *) G.inptr, end_central_sig, 4)) {
-                    G.incnt -= (int) (G.inptr - G.inbuf);
-                    found = TRUE;
-                    break;
-                }
-            }
-
-        /*---------------------------------------------------------------------------
-            Zipfile is longer than INBUFSIZ:
-
-            MB - this next block of code moved to rec_find so that same code can
-          be used to look for zip64 ec record.  No need to include code above
-          since a zip64 ec record will only be looked for if it is a BIG file.
-          ---------------------------------------------------------------------------*/
-
-    } else {
-        found = (rec_find(searchlen, end_central_sig, ECREC_SIZE) == 0 ? TRUE
-                                                                       : FALSE);
-    } /* end if (ziplen > INBUFSIZ) */
+    t.len = (unsigned) MIN(G.ziplen,
+                           searchlen + ECLOC64_SIZE + 4 + ECREC64_SIZE + 4);
+    t.start = G.ziplen - t.len;
+    t.buf = (uint8_t *) checked_malloc(t.len + 1);
+    if (lseek(G.zipfd, t.start, SEEK_SET) == t.start &&
+        read(G.zipfd, (char *) t.buf, t.len) == (int) t.len)
+        found = rec_find(&t, searchlen, end_central_sig, ECREC_SIZE) == 0;
 
     /*---------------------------------------------------------------------------
         Searched through whole region where signature should be without finding
@@ -884,6 +983,7 @@ off_t searchlen;
       ---------------------------------------------------------------------------*/
 
     if (!found) {
+        free(t.buf);
         if (G.UzO.qflag)
             Info(slide, 1, ((char *) slide, "[%s]\n", G.zipfn));
         Info(slide, 1, ((char *) slide, CentDirEndSigNotFound));
@@ -906,8 +1006,10 @@ off_t searchlen;
            G.inptr - G.inbuf, G.inptr - G.inbuf);
 #endif
 
-    if (readbuf((char *) byterec, ECREC_SIZE + 4) == 0)
+    if (readbuf((char *) byterec, ECREC_SIZE + 4) == 0) {
+        free(t.buf);
         return PK_EOF;
+    }
 
     G.ecrec.number_this_disk = makeint16(&byterec[NUMBER_THIS_DISK]);
     G.ecrec.num_disk_start_cdir =
@@ -928,8 +1030,10 @@ off_t searchlen;
     /* Now, we have to read the archive comment, BEFORE the file pointer
        is moved away backwards to seek for a Zip64 ECLOC64 structure.
      */
-    if ((error_in_archive = process_zip_cmmnt()) > PK_WARN)
+    if ((error_in_archive = process_zip_cmmnt()) > PK_WARN) {
+        free(t.buf);
         return error_in_archive;
+    }
 
     /* Next: Check for existence of Zip64 end-of-cent-dir locator
        ECLOC64. This structure must reside on the same volume as the
@@ -942,8 +1046,8 @@ off_t searchlen;
        in the archive, so just check for that to see if this is a
        Zip64 archive.
      */
-    result = find_ecrec64(searchlen + 76);
-    /* 76 bytes for zip64ec & zip64 locator */
+    result = find_ecrec64(&t);
+    free(t.buf);
     if (result != PK_COOL) {
         if (error_in_archive < result)
             error_in_archive = result;
@@ -956,6 +1060,81 @@ off_t searchlen;
     return error_in_archive;
 }
 
+/*---------------------------------------------------------------------------
+    The end-of-central-directory record says that the zipfile is the last
+    disk of a split archive.  zip -s names the others after it:  .z01, .z02
+    and so on for .zip.  If they are all there, they are kept open and read
+    as one file, one after the other (see vol_read() in fileio.c), an
+    offset on disk d being one from the start of its file; what find_ecrec()
+    found in the last one is moved along to where it now is.  Returns FALSE,
+    having changed nothing, if they are not:  the zipfile may then be the
+    disks put together.
+  ---------------------------------------------------------------------------*/
+
+static int find_volumes()
+{
+    unsigned n = (unsigned) G.ecrec.number_this_disk + 1, i, j;
+    size_t len = strlen(G.zipfn);
+    char *name;
+    zipvol *v;
+    struct stat st;
+    off_t start = 0;
+
+    if (G.ecrec.number_this_disk >= 0xFFFF ||
+        G.ecrec.num_disk_start_cdir >= n || len < 4 ||
+        (strcmp(G.zipfn + len - 4, ".zip") != 0 &&
+         strcmp(G.zipfn + len - 4, ".ZIP") != 0))
+        return FALSE;
+    name = (char *) checked_malloc(len + 8);
+    v = (zipvol *) checked_malloc(n * sizeof(zipvol));
+    for (i = 0; i + 1 < n; i++) {
+        sprintf(name, "%.*s.%c%02u", (int) (len - 4), G.zipfn,
+                G.zipfn[len - 3], i + 1); /* .z01 for disk 0, or .Z01 */
+        if ((v[i].fd = open(name, O_RDONLY | O_BINARY)) < 0 ||
+            fstat(v[i].fd, &st) != 0) {
+            Info(slide, 1,
+                 ((char *) slide, VolumeMissing, G.zipfn, name, i + 1,
+                  strerror(errno)));
+            break;
+        }
+        v[i].start = start;
+        v[i].size = st.st_size;
+        start += st.st_size;
+    }
+    free(name);
+    if (i + 1 < n) {
+        for (j = 0; j <= i; j++)
+            if (v[j].fd >= 0)
+                close(v[j].fd);
+        free(v);
+        return FALSE;
+    }
+    v[i].fd = G.zipfd;
+    v[i].start = start;
+    v[i].size = G.ziplen;
+    G.vol = v;
+    G.nvol = n;
+    G.volcur = i;
+    G.volpos = start + lseek(G.zipfd, 0, SEEK_CUR);
+
+    G.ziplen += start;
+    G.cur_zipfile_bufstart += start;
+    G.real_ecrec_offset += start;
+    G.ecrec.ec_start += start;
+    G.ecrec.ec_end += start;
+    if (G.ecrec.have_ecr64) {
+        G.ecrec.ec64_start += start;
+        G.ecrec.ec64_end += start;
+    }
+    G.ecrec.offset_start_central_directory +=
+        v[G.ecrec.num_disk_start_cdir].start;
+    G.expect_ecrec_offset =
+        G.ecrec.offset_start_central_directory + G.ecrec.size_central_directory;
+    Trace((stderr, "find_volumes:  %u disks, %s bytes\n", n,
+           format_off_t(G.ziplen, NULL, NULL)));
+    return TRUE;
+}
+
 static int process_zip_cmmnt() /* return PK-type error code */
 {
     int error = PK_COOL;
@@ -987,7 +1166,12 @@ int process_cdir_file_hdr() /* return PK-type error code */
 
     if ((error = get_cdir_ent()) != 0)
         return error;
+    cdir_hdr_info();
+    return PK_COOL;
+}
 
+static void cdir_hdr_info()
+{
     G.pInfo->hostver = G.crec.version_made_by[0];
     G.pInfo->hostnum = MIN(G.crec.version_made_by[1], NUM_HOSTS);
     /*  extnum = MIN(crec.version_needed_to_extract[1], NUM_HOSTS); */
@@ -1041,8 +1225,6 @@ int process_cdir_file_hdr() /* return PK-type error code */
     /* Initialize the symlink flag, may be set by the platform-specific
        mapattr function.  */
     G.pInfo->symlink = 0;
-
-    return PK_COOL;
 }
 
 static int get_cdir_ent() /* return PK-type error code */
@@ -1116,7 +1298,7 @@ int process_local_file_hdr() /* return PK-type error code */
     G.lrec.filename_length = makeint16(&byterec[L_FILENAME_LENGTH]);
     G.lrec.extra_field_length = makeint16(&byterec[L_EXTRA_FIELD_LENGTH]);
 
-    if ((G.lrec.general_purpose_bit_flag & 8) != 0) {
+    if ((G.lrec.general_purpose_bit_flag & 8) != 0 && !G.zipstream) {
         /* can't trust local header, use central directory: */
         G.lrec.crc32 = G.pInfo->crc;
         G.lrec.csize = G.pInfo->compr_size;
@@ -1128,6 +1310,37 @@ int process_local_file_hdr() /* return PK-type error code */
     return PK_COOL;
 }
 
+/* In a stream (see do_stream()), read the local header whose signature has
+   just been read, and make up from it the central directory entry that
+   the rest of UnZip goes by, as recover.c does:  made on Unix, mode 644
+   (the caller makes it a directory if the name says so).  With bit 3 set,
+   the sizes and CRC come after the data; they are zero here unless the
+   writer went back to fill them in. */
+int process_stream_file_hdr() /* return PK-type error code */
+{
+    int error;
+
+    if ((error = process_local_file_hdr()) != PK_COOL)
+        return error;
+
+    memzero(&G.crec, sizeof(G.crec));
+    G.crec.version_made_by[0] = 30;
+    G.crec.version_made_by[1] = UNIX_;
+    G.crec.version_needed_to_extract[0] = G.lrec.version_needed_to_extract[0];
+    G.crec.version_needed_to_extract[1] = G.lrec.version_needed_to_extract[1];
+    G.crec.general_purpose_bit_flag = G.lrec.general_purpose_bit_flag;
+    G.crec.compression_method = G.lrec.compression_method;
+    G.crec.last_mod_dos_datetime = G.lrec.last_mod_dos_datetime;
+    G.crec.crc32 = G.lrec.crc32;
+    G.crec.csize = G.lrec.csize;
+    G.crec.ucsize = G.lrec.ucsize;
+    G.crec.filename_length = G.lrec.filename_length;
+    G.crec.extra_field_length = G.lrec.extra_field_length;
+    G.crec.external_file_attributes = (uint32_t) 0100644 << 16;
+    cdir_hdr_info();
+    return PK_COOL;
+}
+
 int getZip64Data(
     ef_buf, ef_len) const uint8_t *ef_buf; /* buffer containing extra field */
 unsigned ef_len;                           /* total length of extra field */
@@ -1219,6 +1432,56 @@ unsigned ef_len;                           /* total length of extra field */
     return PK_COOL;
 }
 
+int getAESData(
+    ef_buf, ef_len) const uint8_t *ef_buf; /* buffer containing extra field */
+unsigned ef_len;                           /* total length of extra field */
+{
+    unsigned eb_id;
+    unsigned eb_len;
+
+    /*---------------------------------------------------------------------------
+        This function scans the extra field for WinZip AES information:  the
+        version (AE-1 or AE-2), the vendor ID ("AE"), the key strength and
+        the real compression method of a member whose method is 99.  Sets
+        G.pInfo->aes, aes_v2 and aes_method.  Returns PK_COOL if the block is
+        there and makes sense, PK_ERR if not.
+      ---------------------------------------------------------------------------*/
+
+    G.pInfo->aes = 0;
+
+    if (ef_len == 0 || ef_buf == NULL)
+        return PK_ERR;
+
+    while (ef_len >= EB_HEADSIZE) {
+        eb_id = makeint16(EB_ID + ef_buf);
+        eb_len = makeint16(EB_LEN + ef_buf);
+
+        if (eb_len > (ef_len - EB_HEADSIZE)) {
+            Trace((stderr, "getAESData: block length %u > rest ef_size %u\n",
+                   eb_len, ef_len - EB_HEADSIZE));
+            break;
+        }
+        if (eb_id == EF_AES && eb_len >= 7) {
+            const uint8_t *b = ef_buf + EB_HEADSIZE;
+            unsigned version = makeint16(b);
+
+            if ((version != 1 && version != 2) || b[2] != 'A' ||
+                b[3] != 'E' || b[4] < 1 || b[4] > 3)
+                return PK_ERR;
+            G.pInfo->aes = b[4];
+            G.pInfo->aes_v2 = version == 2;
+            G.pInfo->aes_method = makeint16(b + 5);
+            return PK_COOL;
+        }
+
+        /* Skip this extra field block */
+        ef_buf += (eb_len + EB_HEADSIZE);
+        ef_len -= (eb_len + EB_HEADSIZE);
+    }
+
+    return PK_ERR;
+}
+
 int getUnicodeData(
     ef_buf, ef_len) const uint8_t *ef_buf; /* buffer containing extra field */
 unsigned ef_len;                           /* total length of extra field */
@@ -0,0 +1,536 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* recover.c -- recover_cdir(), which rebuilds the central directory of a
+   zipfile that has lost it (-R)
+
+   A zipfile cut short, by an interrupted upload for instance, has all of
+   its members but the last, and no central directory.  Each member still
+   starts with a local header, which has everything the central directory
+   entry has except the file attributes and comment, and, if the sizes
+   were not known when it was written (bit 3), a data descriptor after
+   the data has the sizes and CRC instead.
+
+   recover_cdir() reads the whole file once, noting where "PK" signatures
+   are (scan_sigs()).  Then it goes through the local header signatures in
+   order, skipping those that are inside a member already found:  the
+   header must make sense, and the member must end before the end of the
+   file.  A member with a data descriptor ends at the first descriptor
+   whose compressed size is the length of the data from the header:  one
+   with a signature (PK\7\8), or one without, just in front of the next
+   signature or the end of the file.  Whatever follows a member that runs
+   past the end of the file is its data, not more members; if it has no
+   size and no descriptor, so that where it ends is not known, members
+   found after it are kept but flagged, since they may be in its data (a
+   stored zipfile, say).  For each member that checks out, it writes a
+   central directory entry into G.rcd, and it ends the directory with the
+   end-of-central-directory record(s).
+
+   Nothing is written to the zipfile.  zip_read() (fileio.c) returns G.rcd
+   to anything reading past the end of the zipfile, and G.ecrec says the
+   central directory starts there, so list_files() and
+   extract_or_test_files() need not know. */
+
+#include "unzip.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h> /* scan_sigs() looks at 16 bytes at a time */
+#endif
+
+#define SCANBUF  0x100000L /* bytes per read() in scan_sigs() */
+#define SIG(c, d) ((c) << 8 | (d)) /* kind of signature:  the last two bytes */
+
+#define UNKNOWN 0xFFFFFFFFL /* 32-bit size or offset in the Zip64 extra */
+
+struct sighit {
+    off_t ofs; /* of the "P" */
+    unsigned kind;
+};
+
+struct sigs {
+    struct sighit *hit; /* in order of ofs */
+    size_t n, max;
+};
+
+/* a member found by find_member() */
+struct rmember {
+    uint8_t hdr[LREC_SIZE + 4];
+    uint8_t *name;  /* name and extra field, as in the local header */
+    off_t start;    /* local header */
+    off_t data;     /* start of the data */
+    off_t end;      /* end of the data, or of the data descriptor */
+    uint64_t csize, ucsize;
+    uint32_t crc;
+    unsigned nlen, elen;
+};
+
+static int read_at(off_t ofs, uint8_t *buf, unsigned len);
+static void scan_sigs(struct sigs *s);
+static int find_member(struct sigs *s, size_t k, struct rmember *m);
+static int find_descriptor(struct sigs *s, size_t k, struct rmember *m,
+                           int zip64);
+static void put16(uint8_t *b, unsigned v);
+static void put32(uint8_t *b, uint32_t v);
+static void put64(uint8_t *b, uint64_t v);
+static uint8_t *rcd_grow(size_t *max, size_t len);
+static void add_centry(struct rmember *m, size_t *max);
+static void add_ecrec(uint64_t n, size_t *max);
+
+static const char Recovering[] =
+    "%s:  looking for members after their local headers...\n";
+static const char MemberIncomplete[] =
+    "warning [%s]:  member at offset %s is incomplete; skipped\n";
+static const char MaybeInside[] =
+    "warning [%s]:  member at offset %s may be data of the one at %s\n";
+static const char NothingRecovered[] = "error [%s]:  no members found\n";
+static const char Recovered[] =
+    "warning [%s]:  central directory rebuilt with %s member%s\n";
+
+/* read len bytes at ofs:  TRUE if all there */
+static int read_at(ofs, buf, len)
+off_t ofs;
+uint8_t *buf;
+unsigned len;
+{
+    return lseek(G.zipfd, ofs, SEEK_SET) == ofs &&
+           read(G.zipfd, (char *) buf, len) == (int) len;
+}
+
+/*---------------------------------------------------------------------------
+    Note the offset of every signature in the zipfile which could help
+    find a member or its end.  All signatures begin with "PK"; SSE2 looks
+    for it 16 positions at a time, elsewhere memchr() finds the "P"s.
+    Each read() after the first carries the last three bytes of the one
+    before, so a signature on the boundary is not missed.
+  ---------------------------------------------------------------------------*/
+
+static void scan_sigs(s)
+struct sigs *s;
+{
+    uint8_t *buf = (uint8_t *) checked_malloc(SCANBUF + 3);
+    off_t base = 0; /* offset of buf[0] */
+    unsigned i, n = 0, kind;
+    int r;
+#ifdef __SSE2__
+    const __m128i p = _mm_set1_epi8(0x50);
+    const __m128i k = _mm_set1_epi8(0x4b);
+#endif
+
+    lseek(G.zipfd, 0, SEEK_SET);
+    while ((r = read(G.zipfd, (char *) buf + n, SCANBUF)) > 0) {
+        n += (unsigned) r;
+        for (i = 0; i + 3 < n; i++) {
+#ifdef __SSE2__
+            if (i + 19 <= n) { /* a hit at i + 15 has its kind before n */
+                int hits = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (buf + i)),
+                                   p),
+                    _mm_cmpeq_epi8(
+                        _mm_loadu_si128((const __m128i *) (buf + i + 1)), k)));
+
+                if (hits == 0) {
+                    i += 15;
+                    continue;
+                }
+                i += __builtin_ctz((unsigned) hits);
+            } else
+#endif
+            {
+                uint8_t *q = (uint8_t *) memchr(buf + i, 0x50, n - 3 - i);
+
+                if (q == NULL)
+                    break;
+                i = (unsigned) (q - buf);
+                if (buf[i + 1] != 0x4b)
+                    continue;
+            }
+            kind = SIG(buf[i + 2], buf[i + 3]);
+            if (kind != SIG(1, 2) && kind != SIG(3, 4) && kind != SIG(5, 6) &&
+                kind != SIG(6, 6) && kind != SIG(6, 7) && kind != SIG(7, 8))
+                continue;
+            if (s->n == s->max) {
+                s->max = s->max ? 2 * s->max : 1024;
+                s->hit = (struct sighit *) checked_realloc(
+                    s->hit, s->max * sizeof(struct sighit));
+            }
+            s->hit[s->n].ofs = base + i;
+            s->hit[s->n++].kind = kind;
+        }
+        if (n > 3) { /* keep the last three bytes */
+            memmove(buf, buf + n - 3, 3);
+            base += n - 3;
+            n = 3;
+        }
+    }
+    free(buf);
+}
+
+/*---------------------------------------------------------------------------
+    Check the local header at s->hit[k] and find the end of its member.
+    Returns PK_OK with *m filled in (m->name malloc'd), PK_EOF if the
+    member does not all fit in the file (m->end then being the end of
+    the file, or -1 if its data have no known size and no data descriptor
+    was found), or PK_ERR if the header is not one.
+  ---------------------------------------------------------------------------*/
+
+static int find_member(s, k, m)
+struct sigs *s;
+size_t k;
+struct rmember *m;
+{
+    uint8_t *h = m->hdr + 4, *p, *e;
+    unsigned flags, len;
+    int zip64 = FALSE;
+
+    m->start = s->hit[k].ofs;
+    m->end = G.ziplen; /* if it is incomplete */
+    if (!read_at(m->start, m->hdr, LREC_SIZE + 4))
+        return PK_EOF;
+    if (h[L_VERSION_NEEDED_TO_EXTRACT_0] > 99 ||
+        makeint16(h + L_COMPRESSION_METHOD) > 99)
+        return PK_ERR;
+    flags = makeint16(h + L_GENERAL_PURPOSE_BIT_FLAG);
+    m->nlen = makeint16(h + L_FILENAME_LENGTH);
+    m->elen = makeint16(h + L_EXTRA_FIELD_LENGTH);
+    if (m->nlen == 0)
+        return PK_ERR;
+    m->data = m->start + LREC_SIZE + 4 + m->nlen + m->elen;
+    if (m->data > G.ziplen)
+        return PK_EOF;
+
+    m->name = (uint8_t *) checked_malloc(m->nlen + m->elen + 1);
+    if (!read_at(m->start + LREC_SIZE + 4, m->name, m->nlen + m->elen)) {
+        free(m->name);
+        return PK_EOF;
+    }
+    m->crc = makeint32(h + L_CRC32);
+    m->csize = makeint32(h + L_COMPRESSED_SIZE);
+    m->ucsize = makeint32(h + L_UNCOMPRESSED_SIZE);
+
+    /* no NULs in the name; the extra field blocks must fit */
+    if (memchr(m->name, 0, m->nlen) != NULL)
+        goto not_a_header;
+    for (p = m->name + m->nlen, e = p + m->elen; e - p >= 4; p += 4 + len) {
+        len = makeint16(p + 2);
+        if (len > (unsigned) (e - p - 4))
+            goto not_a_header;
+        if (makeint16(p) == EF_PKSZ64) { /* in this order, if UNKNOWN */
+            uint8_t *q = p + 4;
+
+            zip64 = TRUE;
+            if (m->ucsize == UNKNOWN && q + 8 <= p + 4 + len) {
+                m->ucsize = makeint64(q);
+                q += 8;
+            }
+            if (m->csize == UNKNOWN && q + 8 <= p + 4 + len)
+                m->csize = makeint64(q);
+        }
+    }
+
+    if ((flags & 8) && find_descriptor(s, k, m, zip64) == PK_OK)
+        return PK_OK;
+    if ((flags & 8) && m->csize == 0) { /* descriptor lost, or not there */
+        free(m->name);
+        m->end = -1;
+        return PK_EOF;
+    }
+    if (m->csize > (uint64_t) (G.ziplen - m->data)) {
+        free(m->name);
+        return PK_EOF;
+    }
+    m->end = m->data + m->csize;
+    return PK_OK;
+
+not_a_header:
+    free(m->name);
+    return PK_ERR;
+}
+
+/*---------------------------------------------------------------------------
+    Find the data descriptor of the member m, whose header is s->hit[k]:
+    the first one after the data whose compressed size is the size of
+    the data.  If it has a signature, it is at a PK\7\8; if not, it is
+    just in front of the next signature of another kind, or of the end of
+    the file.  The sizes are 8 bytes each in the descriptor of a Zip64
+    member, and 4 otherwise, but that is tried, too.
+  ---------------------------------------------------------------------------*/
+
+static int find_descriptor(s, k, m, zip64)
+struct sigs *s;
+size_t k;
+struct rmember *m;
+int zip64;
+{
+    uint8_t d[24];
+    off_t at, len;
+    int i, wide;
+
+    for (k++;; k++) {
+        int signed_dd = k < s->n && s->hit[k].kind == SIG(7, 8);
+
+        at = k < s->n ? s->hit[k].ofs : G.ziplen;
+        if (at < m->data)
+            continue;
+        for (i = 0; i < 2; i++) {
+            wide = zip64 ? i == 0 : i == 1;
+            if (signed_dd) {
+                len = at - m->data;
+                if (!read_at(at, d, wide ? 24 : 16))
+                    continue;
+                if ((wide ? makeint64(d + 8) : makeint32(d + 8)) !=
+                    (uint64_t) len)
+                    continue;
+                m->crc = makeint32(d + 4);
+                m->csize = len;
+                m->ucsize = wide ? makeint64(d + 16) : makeint32(d + 12);
+                m->end = at + (wide ? 24 : 16);
+                return PK_OK;
+            }
+            len = at - (wide ? 20 : 12) - m->data;
+            if (len < 0 || !read_at(m->data + len, d, wide ? 20 : 12))
+                continue;
+            if ((wide ? makeint64(d + 4) : makeint32(d + 4)) != (uint64_t) len)
+                continue;
+            m->crc = makeint32(d);
+            m->csize = len;
+            m->ucsize = wide ? makeint64(d + 12) : makeint32(d + 8);
+            m->end = at;
+            return PK_OK;
+        }
+        if (k >= s->n)
+            return PK_ERR;
+    }
+}
+
+static void put16(b, v)
+uint8_t *b;
+unsigned v;
+{
+    b[0] = (uint8_t) v;
+    b[1] = (uint8_t) (v >> 8);
+}
+
+static void put32(b, v)
+uint8_t *b;
+uint32_t v;
+{
+    put16(b, (unsigned) (v & 0xffff));
+    put16(b + 2, (unsigned) (v >> 16));
+}
+
+static void put64(b, v)
+uint8_t *b;
+uint64_t v;
+{
+    put32(b, (uint32_t) v);
+    put32(b + 4, (uint32_t) (v >> 32));
+}
+
+/* make room for len more bytes at the end of G.rcd, and return them */
+static uint8_t *rcd_grow(max, len)
+size_t *max;
+size_t len;
+{
+    if (G.rcdlen + len > *max) {
+        *max = MAX(2 * *max, G.rcdlen + len + 0x10000L);
+        G.rcd = (uint8_t *) checked_realloc(G.rcd, *max);
+    }
+    G.rcdlen += len;
+    return G.rcd + G.rcdlen - len;
+}
+
+/*---------------------------------------------------------------------------
+    Append the central directory entry of m.  It is made by Unix, with
+    the permissions UnZip would give a file from MS-DOS (but readable by
+    all), and it has the extra field of the local header but for the
+    Zip64 block, which is replaced by one for the central directory.
+  ---------------------------------------------------------------------------*/
+
+static void add_centry(m, max)
+struct rmember *m;
+size_t *max;
+{
+    uint8_t *h = m->hdr + 4, *c, *p, *e, z64[4 + 24];
+    unsigned len, elen = 0, zlen = 4;
+    int isdir = m->name[m->nlen - 1] == '/';
+
+    if (m->ucsize >= UNKNOWN) {
+        put64(z64 + zlen, m->ucsize);
+        zlen += 8;
+    }
+    if (m->csize >= UNKNOWN) {
+        put64(z64 + zlen, m->csize);
+        zlen += 8;
+    }
+    if ((uint64_t) m->start >= UNKNOWN) {
+        put64(z64 + zlen, (uint64_t) m->start);
+        zlen += 8;
+    }
+    put16(z64, EF_PKSZ64);
+    put16(z64 + 2, zlen - 4);
+    if (zlen == 4)
+        zlen = 0;
+
+    /* the name, then the local extra field without its Zip64 block */
+    p = m->name + m->nlen;
+    e = p + m->elen;
+    for (; e - p >= 4; p += 4 + len) {
+        len = makeint16(p + 2);
+        if (makeint16(p) != EF_PKSZ64) {
+            memmove(m->name + m->nlen + elen, p, 4 + len);
+            elen += 4 + len;
+        }
+    }
+    if (elen + zlen > 0xFFFF) /* no room:  keep only the Zip64 block */
+        elen = 0;
+
+    c = rcd_grow(max, 4 + CREC_SIZE + m->nlen + elen + zlen);
+    memcpy(c, central_hdr_sig, 4);
+    c += 4;
+    memzero(c, CREC_SIZE);
+    c[C_VERSION_MADE_BY_0] = 30;
+    c[C_VERSION_MADE_BY_1] = UNIX_;
+    c[C_VERSION_NEEDED_TO_EXTRACT_0] = h[L_VERSION_NEEDED_TO_EXTRACT_0];
+    c[C_VERSION_NEEDED_TO_EXTRACT_1] = h[L_VERSION_NEEDED_TO_EXTRACT_1];
+    memcpy(c + C_GENERAL_PURPOSE_BIT_FLAG, h + L_GENERAL_PURPOSE_BIT_FLAG, 8);
+    put32(c + C_CRC32, m->crc);
+    put32(c + C_COMPRESSED_SIZE, (uint32_t) MIN(m->csize, UNKNOWN));
+    put32(c + C_UNCOMPRESSED_SIZE, (uint32_t) MIN(m->ucsize, UNKNOWN));
+    put16(c + C_FILENAME_LENGTH, m->nlen);
+    put16(c + C_EXTRA_FIELD_LENGTH, elen + zlen);
+    put32(c + C_EXTERNAL_FILE_ATTRIBUTES,
+          isdir ? (uint32_t) 040755 << 16 | 0x10 : (uint32_t) 0100644 << 16);
+    put32(c + C_RELATIVE_OFFSET_LOCAL_HEADER,
+          (uint32_t) MIN((uint64_t) m->start, UNKNOWN));
+    c += CREC_SIZE;
+    memcpy(c, m->name, m->nlen + elen);
+    memcpy(c + m->nlen + elen, z64, zlen);
+}
+
+/*---------------------------------------------------------------------------
+    Append the end-of-central-directory record for n entries, and the
+    Zip64 record and locator in front of it if they are needed, and set
+    G.ecrec as find_ecrec() would have.
+  ---------------------------------------------------------------------------*/
+
+static void add_ecrec(n, max)
+uint64_t n;
+size_t *max;
+{
+    uint64_t cdlen = G.rcdlen;
+    off_t end = G.ziplen + (off_t) cdlen; /* of the central directory */
+    int zip64 = n >= 0xFFFF || (uint64_t) G.ziplen >= UNKNOWN ||
+                cdlen >= UNKNOWN;
+    uint8_t *b;
+
+    memzero(&G.ecrec, sizeof(G.ecrec));
+    G.ecrec.num_entries_centrl_dir_ths_disk = n;
+    G.ecrec.total_entries_central_dir = n;
+    G.ecrec.size_central_directory = cdlen;
+    G.ecrec.offset_start_central_directory = G.ziplen;
+    G.ecrec.ec_start = end;
+    if (zip64) {
+        b = rcd_grow(max, 4 + ECREC64_SIZE + 4 + ECLOC64_SIZE);
+        memzero(b, 4 + ECREC64_SIZE + 4 + ECLOC64_SIZE);
+        memcpy(b, end_central64_sig, 4);
+        put64(b + ECREC64_LENGTH, ECREC64_SIZE - 8);
+        b[EC_VERSION_MADE_BY_0] = 45;
+        b[EC_VERSION_MADE_BY_0 + 1] = UNIX_;
+        b[EC_VERSION_NEEDED_0] = 45;
+        put64(b + 24, n);
+        put64(b + 32, n);
+        put64(b + 40, cdlen);
+        put64(b + 48, (uint64_t) G.ziplen);
+        b += 4 + ECREC64_SIZE;
+        memcpy(b, end_centloc64_sig, 4);
+        put64(b + OFFSET_START_EOCDR64, (uint64_t) end);
+        put32(b + NUM_THIS_DISK_LOC64, 1);
+        G.ecrec.have_ecr64 = G.ecrec.is_zip64_archive = TRUE;
+        G.ecrec.ec64_start = end;
+        G.ecrec.ec64_end = end + 4 + ECREC64_SIZE;
+        G.ecrec.ec_start = G.ecrec.ec64_end;
+    }
+    b = rcd_grow(max, 4 + ECREC_SIZE);
+    memzero(b, 4 + ECREC_SIZE);
+    memcpy(b, end_central_sig, 4);
+    put16(b + NUM_ENTRIES_CEN_DIR_THS_DISK, (unsigned) MIN(n, 0xFFFF));
+    put16(b + TOTAL_ENTRIES_CENTRAL_DIR, (unsigned) MIN(n, 0xFFFF));
+    put32(b + SIZE_CENTRAL_DIRECTORY, (uint32_t) MIN(cdlen, UNKNOWN));
+    put32(b + OFFSET_START_CENTRAL_DIRECTORY,
+          (uint32_t) MIN((uint64_t) G.ziplen, UNKNOWN));
+    G.ecrec.ec_end = G.ziplen + G.rcdlen;
+
+    G.real_ecrec_offset = G.expect_ecrec_offset = end;
+    G.extra_bytes = 0;
+}
+
+/*---------------------------------------------------------------------------
+    Rebuild the central directory from the local headers (see the top of
+    this file).  Returns PK_WARN if any members were found, else PK_ERR.
+  ---------------------------------------------------------------------------*/
+
+int recover_cdir()
+{
+    struct sigs s;
+    struct rmember m;
+    size_t k, max = 0;
+    off_t next = 0; /* where the next member can start */
+    off_t lost = -1; /* an incomplete member that may go on to the end */
+    uint64_t n = 0;
+    int r;
+
+    if (G.UzO.qflag < 2)
+        Info(slide, 1, ((char *) slide, Recovering, G.zipfn));
+    free(G.rcd);
+    G.rcd = NULL;
+    G.rcdlen = 0;
+    s.hit = NULL;
+    s.n = s.max = 0;
+    scan_sigs(&s);
+    Trace((stderr, "recover_cdir:  %lu signatures\n", (unsigned long) s.n));
+
+    for (k = 0; k < s.n; k++) {
+        if (s.hit[k].kind != SIG(3, 4) || s.hit[k].ofs < next)
+            continue;
+        if ((r = find_member(&s, k, &m)) == PK_EOF) {
+            Info(slide, 1,
+                 ((char *) slide, MemberIncomplete, G.zipfn,
+                  format_off_t(s.hit[k].ofs, NULL, NULL)));
+            if (m.end < 0) /* where it ends is not known */
+                lost = s.hit[k].ofs;
+            else
+                next = m.end; /* what is left is its data */
+            continue;
+        }
+        if (r != PK_OK)
+            continue;
+        if (lost >= 0)
+            Info(slide, 1,
+                 ((char *) slide, MaybeInside, G.zipfn,
+                  format_off_t(m.start, NULL, NULL),
+                  format_off_t(lost, NULL, NULL)));
+        add_centry(&m, &max);
+        free(m.name);
+        next = m.end;
+        n++;
+    }
+    free(s.hit);
+
+    if (n == 0) {
+        free(G.rcd);
+        G.rcd = NULL;
+        Info(slide, 1, ((char *) slide, NothingRecovered, G.zipfn));
+        return PK_ERR;
+    }
+    add_ecrec(n, &max);
+    G.cur_zipfile_bufstart = -1; /* G.inbuf has none of it */
+    G.incnt = 0;
+    if (G.UzO.qflag < 2)
+        Info(slide, 1,
+             ((char *) slide, Recovered, G.zipfn,
+              format_off_t((off_t) n, NULL, NULL), n == 1 ? "" : "s"));
+    return PK_WARN;
+}
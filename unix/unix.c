@@ -7,7 +7,17 @@
 
 /* Unix-specific routines for use with Info-ZIP's UnZip 5.41 and later. */
 
+/* syncfs() and sync_file_range() (-S option) and memfd_create() (mirrored
+   output window) are GNU extensions */
+#if (defined(HAVE_SYNCFS) || defined(HAVE_SYNC_FILE_RANGE) || \
+     defined(HAVE_MEMFD_CREATE))
+#define _GNU_SOURCE
+#endif
+
 #include "unzip.h"
+#if (defined(HAVE_MEMFD_CREATE) || defined(HAVE_POSIX_FALLOCATE))
+#include <sys/mman.h>
+#endif
 
 #define DIRENT
 
@@ -41,6 +51,8 @@ static const char CannotSetItemTimestamps[] =
     "warning:  cannot set modif./access times for %s\n          %s\n";
 static const char CannotSetTimestamps[] =
     " (warning) cannot set modif./access times\n          %s";
+static const char CannotSyncItem[] =
+    "warning:  cannot sync %s to disk\n          %s\n";
 
 char *do_wild(wildspec) const
     char *wildspec; /* only used first time on a given dir */
@@ -651,7 +663,106 @@ uint32_t z_uidgid[2];
     return have_uidgid_flg;
 }
 
-void close_outfile() /* GRR: change to return PK-style warning level */
+/* Add the time elapsed since *start to the -S durability total. */
+static void sync_clock(start)
+struct timespec *start;
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    G.sync_secs += (double) (now.tv_sec - start->tv_sec) +
+                   (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*---------------------------------------------------------------------------
+    -S:  start asynchronous write-out of fd and keep one descriptor on each
+    output file system (mount points under -d may add more) for the syncfs()
+    calls in sync_extracted().  -SS:  fsync() fd before returning; the file
+    system is still recorded so that sync_extracted() can make the directory
+    entries durable, including those of directories created implicitly.
+    Returns PK_WARN if the fsync() failed.
+  ---------------------------------------------------------------------------*/
+
+static int sync_fd(fd, fn)
+int fd;
+const char *fn;
+{
+    struct timespec start;
+    struct stat st;
+    int errval = PK_OK;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (G.UzO.S_flag > 1) {
+        if (fsync(fd)) {
+            Info(slide, 1,
+                 ((char *) slide, CannotSyncItem, FnFilter1(fn),
+                  strerror(errno)));
+            errval = PK_WARN;
+        }
+    }
+#ifdef HAVE_SYNC_FILE_RANGE
+    else /* queue the dirty pages now; sync_extracted() waits for them */
+        sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+#endif
+    if (!G.syncall) {
+        if (fstat(fd, &st))
+            G.syncall = TRUE;
+        else {
+            for (i = 0; i < G.nsyncfd && G.syncdev[i] != st.st_dev; ++i)
+                ;
+            if (i == G.nsyncfd) {
+                if (i == SYNC_MAXFS || (G.syncfd[i] = dup(fd)) < 0)
+                    G.syncall = TRUE;
+                else {
+                    G.syncdev[i] = st.st_dev;
+                    ++G.nsyncfd;
+                }
+            }
+        }
+    }
+    sync_clock(&start);
+    return errval;
+}
+
+/* Finish the -S durability pass once all files and directories have been
+   closed:  one syncfs() per output file system covers the data and metadata
+   of everything extracted.  -SS has already synced each file, so this only
+   has the directory entries left to write.  Falls back to sync() when the
+   file systems could not all be recorded. */
+int sync_extracted()
+{
+    struct timespec start;
+    int errval = PK_OK;
+    int i;
+
+    if (!G.UzO.S_flag || (G.nsyncfd == 0 && !G.syncall))
+        return PK_OK;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+#ifdef HAVE_SYNCFS
+    for (i = 0; i < G.nsyncfd; ++i)
+        if (syncfs(G.syncfd[i]) && errval == PK_OK) {
+            Info(slide, 1,
+                 ((char *) slide, CannotSyncItem, "extracted files",
+                  strerror(errno)));
+            errval = PK_WARN;
+        }
+    if (G.syncall)
+        sync();
+#else
+    sync();
+#endif
+    for (i = 0; i < G.nsyncfd; ++i)
+        close(G.syncfd[i]);
+    G.nsyncfd = 0;
+    G.syncall = FALSE;
+    sync_clock(&start);
+    return errval;
+}
+
+/* Returns PK_WARN if -SS could not sync the file, PK_OK otherwise. */
+int close_outfile()
 {
     union {
         iztimes t3;        /* mtime, atime, ctime */
@@ -659,6 +770,7 @@ void close_outfile() /* GRR: change to return PK-style warning level */
     } zt;
     uint32_t z_uidgid[2];
     int have_uidgid_flg;
+    int errval = PK_OK;
 
     have_uidgid_flg = get_extattribs(&(zt.t3), z_uidgid);
 
@@ -689,7 +801,7 @@ void close_outfile() /* GRR: change to return PK-style warning level */
                   "warning:  symbolic link (%s) failed: mem alloc overflow\n",
                   FnFilter1(G.filename)));
             fclose(G.outfile);
-            return;
+            return PK_OK;
         }
 
         slnk_entry = checked_malloc(slnk_entrysize);
@@ -712,7 +824,7 @@ void close_outfile() /* GRR: change to return PK-style warning level */
                   FnFilter1(G.filename)));
             free(slnk_entry);
             fclose(G.outfile);
-            return;
+            return PK_OK;
         }
         fclose(G.outfile); /* close "link" file for good... */
         slnk_entry->target[ucsize] = '\0';
@@ -725,7 +837,7 @@ void close_outfile() /* GRR: change to return PK-style warning level */
         else
             G.slink_head = slnk_entry;
         G.slink_last = slnk_entry;
-        return;
+        return PK_OK;
     }
 
     /* if -X option was specified and we have UID/GID info, restore it */
@@ -755,6 +867,11 @@ void close_outfile() /* GRR: change to return PK-style warning level */
     if (fchmod(fileno(G.outfile), filtattr(G.pInfo->file_attr)))
         perror("fchmod (file attributes) error");
 
+    if (G.UzO.S_flag) {
+        fflush(G.outfile);
+        errval = sync_fd(fileno(G.outfile), G.filename);
+    }
+
     fclose(G.outfile);
 
     /* skip restoring time stamps on user's request */
@@ -768,6 +885,7 @@ void close_outfile() /* GRR: change to return PK-style warning level */
             Info(slide, 1,
                  ((char *) slide, CannotSetTimestamps, strerror(errno)));
     }
+    return errval;
 }
 
 int set_symlnk_attribs(slnk_entry)
@@ -848,9 +966,124 @@ direntry *d;
         if (!errval)
             errval = PK_WARN;
     }
+    /* -S/-SS: the directory's entries must reach the disk, too */
+    if (G.UzO.S_flag) {
+        int fd = open(d->fn, O_RDONLY);
+
+        if (fd >= 0) {
+            if (sync_fd(fd, d->fn) != PK_OK && !errval)
+                errval = PK_WARN;
+            close(fd);
+        }
+    }
     return errval;
 }
 
+/*---------------------------------------------------------------------------
+    Map size bytes of anonymous memory twice, back to back, so that byte i
+    and byte i + size are the same for 0 <= i < size.  Returns NULL if that
+    cannot be done; the decompressors then fall back to slide[].
+  ---------------------------------------------------------------------------*/
+
+uint8_t *map_ring(size)
+size_t size;
+{
+#ifdef HAVE_MEMFD_CREATE
+    uint8_t *base;
+    int fd;
+
+    if ((fd = memfd_create("unzip-window", 0)) < 0)
+        return NULL;
+    if (ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        return NULL;
+    }
+    /* reserve the address range, then map the file over both halves */
+    base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+             0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+             fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * size);
+        close(fd);
+        return NULL;
+    }
+    close(fd); /* the mappings keep the memory alive */
+
+    base[0] = 0x5a; /* paranoia:  make sure the halves really alias */
+    if (base[size] != 0x5a) {
+        munmap(base, 2 * size);
+        return NULL;
+    }
+    Trace((stderr, "map_ring:  %lu byte mirrored window at %p\n",
+           (unsigned long) size, base));
+    return base;
+#else
+    return NULL;
+#endif
+}
+
+void unmap_ring(ring, size)
+uint8_t *ring;
+size_t size;
+{
+#ifdef HAVE_MEMFD_CREATE
+    munmap(ring, 2 * size);
+#endif
+}
+
+/* Map the first size bytes of the new, empty output file for inflate() to
+   write into (map_output() in fileio.c).  Its blocks are allocated first,
+   so that a full disk shows up here rather than as a SIGBUS on some page
+   halfway through; if anything fails, the file is left empty. */
+uint8_t *map_outfile(file, size)
+FILE *file;
+size_t size;
+{
+#ifdef HAVE_POSIX_FALLOCATE
+    int fd = fileno(file);
+    uint8_t *map;
+
+    if (posix_fallocate(fd, (off_t) 0, (off_t) size) == 0) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED)
+            return map;
+    }
+    if (ftruncate(fd, (off_t) 0) != 0)
+        Trace((stderr, "map_outfile:  ftruncate() failed\n"));
+#endif
+    return NULL;
+}
+
+/* fault in len bytes of the mapped output file at p, ready for writing */
+void fault_outfile(p, len)
+uint8_t *p;
+size_t len;
+{
+#if (defined(HAVE_POSIX_FALLOCATE) && defined(MADV_POPULATE_WRITE))
+    madvise(p, len, MADV_POPULATE_WRITE); /* only a hint:  errors are OK */
+#endif
+}
+
+/* unmap the output file and cut it to len bytes:  0 if OK */
+int unmap_outfile(file, map, size, len)
+FILE *file;
+uint8_t *map;
+size_t size;
+off_t len;
+{
+#ifdef HAVE_POSIX_FALLOCATE
+    munmap(map, size);
+    return ftruncate(fileno(file), len);
+#else
+    return 0;
+#endif
+}
+
 int stamp_file(fname, modtime) const char *fname;
 time_t modtime;
 {
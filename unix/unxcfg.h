@@ -27,11 +27,17 @@
 /* These have to be before any include that sets types so the large file
    versions of the types are set in the includes */
 
+#ifndef _LARGEFILE_SOURCE  /* may come from _GNU_SOURCE (unix.c) */
 #define _LARGEFILE_SOURCE /* some OSes need this for fseeko */
+#endif
+#ifndef _LARGEFILE64_SOURCE
 #define _LARGEFILE64_SOURCE
+#endif
 #define _FILE_OFFSET_BITS 64 /* select default interface as 64 bit */
 #define _LARGE_FILES         /* some OSes need this for 64-bit off_t */
+#ifndef __USE_LARGEFILE64
 #define __USE_LARGEFILE64
+#endif
 #endif /* LARGE_FILE_SUPPORT */
 
 #include <sys/types.h> /* off_t, time_t, dev_t, ... */
@@ -0,0 +1,421 @@
+/*
+  Copyright (c) 1990-2009 Info-ZIP.  All rights reserved.
+
+  See the accompanying file LICENSE, version 2009-Jan-02 or later
+  (the contents of which are also included in unzip.h) for terms of use.
+*/
+/* unlzma.c -- decompress LZMA (method 14) members
+
+   The member data start with a four-byte header (the version of the LZMA
+   SDK that wrote them and the size of the properties that follow, always
+   5), then the properties proper:  lc, lp and pb packed into one byte, and
+   the dictionary size.  The range coded stream comes next.  It ends after
+   ucsize bytes of output or, if bit 1 of the general purpose flags is set,
+   with an end marker (a match at distance 0xffffffff).
+
+   The decoder keeps its own dictionary, as large as the member asks for
+   but no larger than ucsize, and hands it to G.flush each time it fills
+   up.  The range coder is the usual one; what is done about speed is
+   this:  the bits of literals, lengths and distances are decoded without
+   a jump (the comparison with the bound becomes a mask that selects the
+   new range and probability and the next node of the bit tree), and a
+   long match is copied with memcpy() unless it overlaps itself or wraps
+   around the end of the dictionary.
+ */
+
+#define __UNLZMA_C /* identifies this source module */
+#include "unzip.h"
+
+#define LZMA_PROPS    5             /* size of the properties */
+#define LZMA_BITS     11            /* probabilities are in 1/2048ths */
+#define LZMA_ONE      (1 << LZMA_BITS)
+#define LZMA_MOVE     5             /* adaptation speed */
+#define LZMA_TOP      (1U << 24)    /* range must be kept above this */
+#define LZMA_STATES   12
+#define LZMA_LITSTATE 7             /* states below follow a literal */
+#define LZMA_POSSTATE 16            /* most position states (pb <= 4) */
+#define LZMA_ENDSLOT  14            /* first slot with direct bits */
+#define LZMA_FULLDIST 128           /* distances below the direct ones */
+#define LZMA_DICTMIN  4096          /* smallest dictionary */
+
+typedef uint16_t lzprob;
+
+typedef struct lzlen {
+    lzprob choice;
+    lzprob choice2;
+    lzprob low[LZMA_POSSTATE][8];
+    lzprob mid[LZMA_POSSTATE][8];
+    lzprob high[256];
+} lzlen;
+
+typedef struct lzmodel {
+    lzprob ismatch[LZMA_STATES][LZMA_POSSTATE];
+    lzprob isrep[LZMA_STATES];
+    lzprob isrepg0[LZMA_STATES];
+    lzprob isrepg1[LZMA_STATES];
+    lzprob isrepg2[LZMA_STATES];
+    lzprob isrep0long[LZMA_STATES][LZMA_POSSTATE];
+    lzprob slot[4][64];
+    lzprob spec[1 + LZMA_FULLDIST - LZMA_ENDSLOT];
+    lzprob align[16];
+    lzlen len;
+    lzlen replen;
+    lzprob lit[1]; /* 0x300 << (lc + lp) of them, allocated with the rest */
+} lzmodel;
+
+static int lzma_flush(uint8_t *buf, size_t len);
+
+/* Range decoder.  range and code are locals of unlzma(), and so are in and
+   inend, a copy of the input buffer pointers that the compiler can keep in
+   registers (G.inptr could alias the dictionary); they go back to G for
+   readbyte() when the buffer is used up.  A byte read past the end of the
+   member, or of the input, comes in as 0xff and leaves G.csize negative
+   (see readbyte()), which the decode loop checks before each symbol:  in a
+   stream, where there is no ucsize to stop at, it would go on forever. */
+#define RC_NORMALIZE                                   \
+    if (range < LZMA_TOP) {                            \
+        range <<= 8;                                   \
+        code = (code << 8) | (in < inend ? *in++ : RC_REFILL()); \
+    }
+
+#define RC_REFILL()                                    \
+    (G.inptr = in, G.incnt = 0, c = readbyte(),        \
+     in = G.inptr, inend = in + G.incnt,               \
+     c == EOF ? (G.csize = -1, 0xff) : (uint8_t) c)
+
+/* decode a bit with probability *p and branch on it */
+#define RC_IF0(p)                                      \
+    RC_NORMALIZE                                       \
+    bound = (range >> LZMA_BITS) * *(p);               \
+    if (code < bound ? (range = bound,                 \
+                        *(p) += (LZMA_ONE - *(p)) >> LZMA_MOVE, 1) \
+                     : (range -= bound, code -= bound, \
+                        *(p) -= *(p) >> LZMA_MOVE, 0))
+
+/* decode a bit with probability *p without a jump:  mask becomes 0 for a
+   0 bit and ~0 for a 1 bit */
+#define RC_MASK(p, mask)                                            \
+    do {                                                            \
+        unsigned v_ = *(p);                                         \
+                                                                    \
+        RC_NORMALIZE                                                \
+        bound = (range >> LZMA_BITS) * v_;                          \
+        mask = 0 - (uint32_t) (code >= bound);                      \
+        range = (bound & ~mask) | ((range - bound) & mask);         \
+        code -= bound & mask;                                       \
+        *(p) = (lzprob) (v_ + (((LZMA_ONE - v_) >> LZMA_MOVE) & ~mask) - \
+                         ((v_ >> LZMA_MOVE) & mask));               \
+    } while (0)
+
+/* one step down the bit tree at probs:  m = 2 * m + bit */
+#define RC_TREE(probs, m)                              \
+    do {                                               \
+        RC_MASK((probs) + (m), mask);                  \
+        m = 2 * m + (mask & 1);                        \
+    } while (0)
+
+/* n bits, least significant first, from the bit tree at probs into v */
+#define RC_REVERSE(probs, n, v)                        \
+    do {                                               \
+        unsigned m_ = 1, i_;                           \
+                                                       \
+        for (v = 0, i_ = 0; i_ < (n); i_++) {          \
+            RC_MASK((probs) + m_, mask);               \
+            m_ = 2 * m_ + (mask & 1);                  \
+            v |= (mask & 1) << i_;                     \
+        }                                              \
+    } while (0)
+
+/* a match length (less 2) with the length coder at lc into len */
+#define RC_LENGTH(lc, len)                             \
+    do {                                               \
+        m = 1;                                         \
+        RC_IF0(&(lc)->choice) {                        \
+            RC_TREE((lc)->low[posstate], m);           \
+            RC_TREE((lc)->low[posstate], m);           \
+            RC_TREE((lc)->low[posstate], m);           \
+            len = m - 8;                               \
+        } else {                                       \
+            RC_IF0(&(lc)->choice2) {                   \
+                RC_TREE((lc)->mid[posstate], m);       \
+                RC_TREE((lc)->mid[posstate], m);       \
+                RC_TREE((lc)->mid[posstate], m);       \
+                len = m - 8 + 8;                       \
+            } else {                                   \
+                do                                     \
+                    RC_TREE((lc)->high, m);            \
+                while (m < 0x100);                     \
+                len = m - 0x100 + 16;                  \
+            }                                          \
+        }                                              \
+    } while (0)
+
+/* pass len bytes at buf to the output sink, a window at a time */
+static int lzma_flush(buf, len)
+uint8_t *buf;
+size_t len;
+{
+    unsigned n;
+    int r;
+
+    for (; len > 0; buf += n, len -= n) {
+        n = (unsigned) MIN(len, WSIZE);
+        if ((r = (*G.flush)(buf, (uint32_t) n)) != 0)
+            return r;
+    }
+    return 0;
+}
+
+/* Decompress the current LZMA member.  Returns 0, 2 for bad data, 3 if
+   memory ran out, or the error from the output sink. */
+int unlzma()
+{
+    uint8_t props[4 + LZMA_PROPS];
+    unsigned lc, lp, pb, state, posstate, m, len, i;
+    uint32_t range, code, bound, mask;
+    uint32_t rep0, rep1, rep2, rep3, d;
+    uint64_t total, ucsize;
+    size_t dictsize, dicsize, dicpos, src, n, k;
+    uint8_t *dic, prev, *in, *inend;
+    unsigned mbyte;
+    lzprob *p, *lit;
+    lzmodel *S;
+    int eosmark = (G.lrec.general_purpose_bit_flag & 2) != 0;
+    int c, retval = 0;
+
+    for (i = 0; i < sizeof(props); i++) {
+        if ((c = NEXTBYTE) == EOF)
+            return 2;
+        props[i] = (uint8_t) c;
+    }
+    if (props[2] != LZMA_PROPS || props[3] != 0 || props[4] >= 9 * 5 * 5)
+        return 2;
+    lc = props[4] % 9;
+    lp = props[4] / 9 % 5;
+    pb = props[4] / 45;
+    dictsize = (size_t) makeint32(props + 5);
+    if (dictsize < LZMA_DICTMIN)
+        dictsize = LZMA_DICTMIN;
+    Trace((stderr, "unlzma:  SDK %u.%u, lc %u lp %u pb %u, dict %lu\n",
+           props[0], props[1], lc, lp, pb, (unsigned long) dictsize));
+
+    /* in a stream, a member with bit 3 set has no size until the end
+       marker (see extract_or_test_stream()) */
+    ucsize = G.streamlost ? ~(uint64_t) 0 : G.lrec.ucsize;
+    dicsize = ucsize < dictsize ? (size_t) ucsize : dictsize;
+    if (dicsize == 0)
+        dicsize = 1;
+    n = sizeof(lzmodel) + ((size_t) 0x300 << (lc + lp)) * sizeof(lzprob);
+    if ((S = (lzmodel *) malloc(n)) == NULL)
+        return 3;
+    if ((dic = (uint8_t *) malloc(dicsize)) == NULL) {
+        free(S);
+        return 3;
+    }
+    for (p = (lzprob *) S; p < (lzprob *) ((uint8_t *) S + n); p++)
+        *p = LZMA_ONE / 2;
+    lit = S->lit;
+
+    /* the range coder starts with a zero byte and the first code */
+    in = G.inptr;
+    inend = in + G.incnt;
+    range = 0xffffffff;
+    code = 0;
+    for (i = 0; i < 5; i++)
+        code = (code << 8) | (in < inend ? *in++ : RC_REFILL());
+
+    state = 0;
+    rep0 = rep1 = rep2 = rep3 = 0;
+    total = 0;
+    dicpos = 0;
+    prev = 0;
+    for (;;) {
+        if (total >= ucsize && !eosmark)
+            break;
+        if (G.csize < 0) /* out of input */
+            goto bad_data;
+        posstate = (unsigned) total & ((1 << pb) - 1);
+
+        RC_IF0(&S->ismatch[state][posstate]) {
+            /* literal, coded in the context of the previous byte */
+            if (total >= ucsize)
+                goto bad_data;
+            p = lit + 0x300 * ((((unsigned) total & ((1 << lp) - 1)) << lc) +
+                               (prev >> (8 - lc)));
+            m = 1;
+            if (state < LZMA_LITSTATE) {
+                do
+                    RC_TREE(p, m);
+                while (m < 0x100);
+            } else {
+                /* after a match:  use the byte at rep0 as well, as long
+                   as the bits agree */
+                unsigned offs = 0x100, bit;
+
+                src = dicpos > rep0 ? dicpos - rep0 - 1
+                                    : dicpos + dicsize - rep0 - 1;
+                mbyte = dic[src];
+                do {
+                    mbyte <<= 1;
+                    bit = mbyte & offs;
+                    RC_MASK(p + offs + bit + m, mask);
+                    m = 2 * m + (mask & 1);
+                    offs &= bit ^ ~mask;
+                } while (m < 0x100);
+            }
+            dic[dicpos++] = prev = (uint8_t) m;
+            total++;
+            state = state < 4 ? 0 : state < 10 ? state - 3 : state - 6;
+            if (dicpos == dicsize) {
+                if ((retval = lzma_flush(dic, dicpos)) != 0)
+                    goto cleanup;
+                dicpos = 0;
+            }
+            continue;
+        }
+
+        RC_IF0(&S->isrep[state]) {
+            /* a new match */
+            rep3 = rep2;
+            rep2 = rep1;
+            rep1 = rep0;
+            RC_LENGTH(&S->len, len);
+            state = state < LZMA_LITSTATE ? 7 : 10;
+
+            p = S->slot[len < 4 ? len : 3];
+            m = 1;
+            for (i = 0; i < 6; i++)
+                RC_TREE(p, m);
+            m -= 64; /* the distance slot */
+            if (m < 4)
+                rep0 = m;
+            else {
+                unsigned direct = (m >> 1) - 1;
+
+                rep0 = (2 | (m & 1)) << direct;
+                if (m < LZMA_ENDSLOT) {
+                    RC_REVERSE(S->spec + rep0 - m - 1, direct, d);
+                    rep0 += d;
+                } else {
+                    for (d = 0, i = direct - 4; i > 0; i--) {
+                        uint32_t t;
+
+                        RC_NORMALIZE
+                        range >>= 1;
+                        code -= range;
+                        t = 0 - (code >> 31); /* ~0 if code went below 0 */
+                        code += range & t;
+                        d = (d << 1) + (t + 1);
+                    }
+                    rep0 += d << 4;
+                    RC_REVERSE(S->align, 4, d);
+                    rep0 += d;
+                    if (rep0 == 0xffffffff) { /* end marker */
+                        RC_NORMALIZE
+                        if (!eosmark || code != 0 ||
+                            (total != ucsize && !G.streamlost))
+                            goto bad_data;
+                        break;
+                    }
+                }
+            }
+        } else {
+            /* a repeated distance */
+            RC_IF0(&S->isrepg0[state]) {
+                RC_IF0(&S->isrep0long[state][posstate]) {
+                    /* one byte at rep0 */
+                    if (rep0 >= total || total >= ucsize)
+                        goto bad_data;
+                    src = dicpos > rep0 ? dicpos - rep0 - 1
+                                        : dicpos + dicsize - rep0 - 1;
+                    dic[dicpos++] = prev = dic[src];
+                    total++;
+                    state = state < LZMA_LITSTATE ? 9 : 11;
+                    if (dicpos == dicsize) {
+                        if ((retval = lzma_flush(dic, dicpos)) != 0)
+                            goto cleanup;
+                        dicpos = 0;
+                    }
+                    continue;
+                }
+            } else {
+                RC_IF0(&S->isrepg1[state]) {
+                    d = rep1;
+                } else {
+                    RC_IF0(&S->isrepg2[state]) {
+                        d = rep2;
+                    } else {
+                        d = rep3;
+                        rep3 = rep2;
+                    }
+                    rep2 = rep1;
+                }
+                rep1 = rep0;
+                rep0 = d;
+            }
+            RC_LENGTH(&S->replen, len);
+            state = state < LZMA_LITSTATE ? 8 : 11;
+        }
+
+        /* copy len + 2 bytes from rep0 + 1 back */
+        n = len + 2;
+        if (rep0 >= total || rep0 >= dicsize || n > ucsize - total)
+            goto bad_data;
+        total += n;
+        src = dicpos > rep0 ? dicpos - rep0 - 1 : dicpos + dicsize - rep0 - 1;
+        if (src < dicpos && n < dicsize - dicpos) {
+            /* the usual case:  no wrap around, no flush */
+            uint8_t *q = dic + dicpos, *s = dic + src;
+
+            dicpos += n;
+            if (n >= 32 && rep0 >= n) /* long and not overlapping */
+                memcpy(q, s, n);
+            else
+                do
+                    *q++ = *s++;
+                while (--n);
+            prev = dic[dicpos - 1];
+            continue;
+        }
+        do {
+            k = MIN(n, dicsize - MAX(dicpos, src));
+            if (src > dicpos || dicpos - src >= k)
+                memmove(dic + dicpos, dic + src, k);
+            else {
+                uint8_t *q = dic + dicpos, *s = dic + src;
+                size_t j;
+
+                for (j = 0; j < k; j++) /* overlapping:  repeats */
+                    q[j] = s[j];
+            }
+            dicpos += k;
+            src += k;
+            n -= k;
+            if (src == dicsize)
+                src = 0;
+            if (dicpos == dicsize) {
+                if ((retval = lzma_flush(dic, dicpos)) != 0)
+                    goto cleanup;
+                dicpos = 0;
+            }
+        } while (n > 0);
+        prev = dic[(dicpos ? dicpos : dicsize) - 1];
+    }
+
+    if (G.csize < 0) /* read past the end of the member */
+        goto bad_data;
+    retval = lzma_flush(dic, dicpos);
+    goto cleanup;
+
+bad_data:
+    if (dicpos > 0) /* what was decoded is still written out */
+        lzma_flush(dic, dicpos);
+    retval = 2;
+
+cleanup:
+    G.inptr = in;
+    G.incnt = (int) (inend - in);
+    free(dic);
+    free(S);
+    return retval;
+}
@@ -36,14 +36,14 @@
 
   Memory requirements have been reduced in this version and are now no more
   than the original Sam Smith code.  This is still larger than any of the
-  other algorithms:  at a minimum, 8K+8K+16K (stack+values+parents) assuming
-  16-bit short ints, and this does not even include the output buffer (the
-  other algorithms leave the uncompressed data in the work area, typically
+  other algorithms:  16K+8K+16K+16K+8K (parents+values+lengths+offsets+
+  stamps), and this does not even include the output buffer (the other
+  algorithms leave the uncompressed data in the work area, typically
   called slide[]).  For machines with a 64KB data space this is a problem,
   particularly when text conversion is required and line endings have more
   than one character.  UnZip's solution is to use two roughly equal halves
-  of outbuf for the ASCII conversion in such a case; the "unshrink" argument
-  to flush() signals that this is the case.
+  of outbuf for the ASCII conversion in such a case; the output sink (G.flush)
+  tells this case by being handed G.outbuf itself.
 
   For large-memory machines, a second outbuf is allocated for translations,
   but only if unshrinking and only if translations are required.
@@ -53,14 +53,35 @@
     big mem   |  big outbuf  | big outbuf + big outbuf2  <- malloc'd here
     small mem | small outbuf | half + half small outbuf
 
+  Strings are written straight into outbuf, without a stack.  A code added
+  as oldcode's child stands for the previous string plus the first byte of
+  the current one, and those two were written next to each other; so each
+  code records its string length and where in outbuf its string can be
+  found, and translating it is normally a plain forward copy.  If outbuf
+  has been flushed since (the stamp records which fill of outbuf the offset
+  refers to), the string is rebuilt from the parent chain, last byte first,
+  into its final place.  Only a code whose ancestors are all in the table
+  has a fixed string, though:  partial clearing can free the parent of a
+  live code, and the freed code can later be reused, which changes the
+  string of that code and of all its descendants.  Such codes have their
+  length zeroed and are translated by walking the chain twice, once to
+  measure and once to copy, exactly as the tree stands at the time.
+
   Copyright 1994, 1995 Greg Roelofs.  See the accompanying file "COPYING"
   in UnZip 5.20 (or later) source or binary distributions.
 
   ---------------------------------------------------------------------------*/
 
 #include "unzip.h"
+#include "bitread.h"
+
+#if (OUTBUFSIZ > 0x10000L)
+#error "unshrink.c:  outbuf offsets must fit in 16 bits"
+#endif
 
-static void partial_clear(int lastcodeused);
+static int flush_outbuf(uint8_t *stamp);
+static int dyn_length(int code, int oldcode);
+static shrint partial_clear(int lastcodeused);
 
 #ifdef DEBUG
 #define OUTDBG(c)                            \
@@ -76,22 +97,17 @@ static void partial_clear(int lastcodeused);
     } while (0)
 #endif
 
-#define READBITS(nbits, zdest)                                        \
-    do {                                                              \
-        if (nbits > G.bits_left) {                                    \
-            int temp;                                                 \
-            G.zipeof = 1;                                             \
-            while (G.bits_left <= 8 * (int) (sizeof(G.bitbuf) - 1) && \
-                   (temp = NEXTBYTE) != EOF) {                        \
-                G.bitbuf |= (uint32_t) temp << G.bits_left;           \
-                G.bits_left += 8;                                     \
-                G.zipeof = 0;                                         \
-            }                                                         \
-        }                                                             \
-        zdest = (shrint) ((unsigned) G.bitbuf & mask_bits[nbits]);    \
-        G.bitbuf >>= nbits;                                           \
-        G.bits_left -= nbits;                                         \
+/* A shrunk stream has no end code; it ends where the input does.  So a
+   code that would use any of the zero bits the bit reader supplies past
+   the end is not there (BITS_PAST_END), and the decoding is over before
+   NEEDBITS() could find that out for itself. */
+#define READBITS(nbits, zdest)                                 \
+    do {                                                       \
+        NEEDBITS(nbits);                                       \
+        zdest = (shrint) ((unsigned) b & mask_bits[nbits]);    \
+        DUMPBITS(nbits);                                       \
     } while (0)
+#define BITS_OVERRUN return PK_ERR /* not reached */
 
 /* HSIZE is defined as 2^13 (8192) in unzip.h (resp. unzpriv.h */
 #define BOGUSCODE 256
@@ -102,27 +118,30 @@ static void partial_clear(int lastcodeused);
 
 #define parent G.area.shrink.Parent
 #define Value  G.area.shrink.value /* "value" conflicts with Pyramid ioctl.h */
-#define stack  G.area.shrink.Stack
+#define Length G.area.shrink.length /* 0:  string not fixed (see above) */
+#define Where  G.area.shrink.where  /* offset of a copy of it in outbuf... */
+#define Stamp  G.area.shrink.stamp  /* ...if this is the current stamp */
 
 int unshrink()
 {
-    uint8_t *stacktop = stack + (HSIZE - 1);
-    register uint8_t *newstr;
-    uint8_t finalval;
+    uint8_t finalval, stamp, oldstamp;
     int codesize = 9, len, error;
     shrint code, oldcode, curcode;
     shrint lastfreecode;
-    unsigned int outbufsiz;
-    register uint8_t *p;
+    unsigned int outbufsiz, oldpos;
+    register uint8_t *out, *p;
+    bitbuf_t b; /* bit buffer (see bitread.h) */
+    unsigned k; /* number of bits in it */
 
     /*---------------------------------------------------------------------------
         Initialize various variables.
       ---------------------------------------------------------------------------*/
 
     lastfreecode = BOGUSCODE;
+    BITS_INIT();
 
     /* non-memory-limited machines:  allocate second (large) buffer for
-     * textmode conversion in flush(), but only if needed */
+     * textmode conversion by the output sink, but only if needed */
     if (G.pInfo->textmode && !G.outbuf2) {
         G.outbuf2 = checked_malloc(TRANSBUFSIZ);
     }
@@ -130,9 +149,14 @@ int unshrink()
     for (code = 0; code < BOGUSCODE; ++code) {
         Value[code] = (uint8_t) code;
         parent[code] = BOGUSCODE;
+        Length[code] = 1;
     }
-    for (code = BOGUSCODE + 1; code < HSIZE; ++code)
+    for (code = BOGUSCODE; code < HSIZE; ++code) { /* BOGUSCODE:  see below */
         parent[code] = FREE_CODE;
+        Length[code] = 0;
+    }
+    memzero(Stamp, HSIZE);
+    stamp = 1;
 
     if (G.pInfo->textmode)
         outbufsiz = RAWBUFSIZ;
@@ -146,21 +170,23 @@ int unshrink()
       ---------------------------------------------------------------------------*/
 
     READBITS(codesize, oldcode);
-    if (G.zipeof)
+    if (BITS_PAST_END)
         return PK_OK;
 
     finalval = (uint8_t) oldcode;
     OUTDBG(finalval);
     *G.outptr++ = finalval;
     ++G.outcnt;
+    oldpos = 0;
+    oldstamp = stamp;
 
     while (TRUE) {
         READBITS(codesize, code);
-        if (G.zipeof)
+        if (BITS_PAST_END)
             break;
         if (code == BOGUSCODE) { /* possible to have consecutive escapes? */
             READBITS(codesize, code);
-            if (G.zipeof)
+            if (BITS_PAST_END)
                 break;
             if (code == 1) {
                 ++codesize;
@@ -169,76 +195,92 @@ int unshrink()
                     return PK_ERR;
             } else if (code == 2) {
                 Trace((stderr, " (partial clear code)\n"));
-                /* clear leafs (nodes with no children) */
-                partial_clear(lastfreecode);
+                /* clear leafs (nodes with no children); the free-node
+                   search resumes below the first free one */
+                lastfreecode = partial_clear(lastfreecode);
                 Trace((stderr, " (done with partial clear)\n"));
-                lastfreecode = BOGUSCODE; /* reset start of free-node search */
             }
             continue;
         }
+        curcode = code;
 
         /*-----------------------------------------------------------------------
-            Translate code:  traverse tree from leaf back to root.
+            Translate code straight into outbuf.
           -----------------------------------------------------------------------*/
 
-        newstr = stacktop;
-        curcode = code;
+        if (parent[code] != FREE_CODE)
+            len = Length[code];
+        else if (Length[oldcode] != 0)
+            len = Length[oldcode] + 1; /* KwKwK:  oldcode's string + 1 */
+        else
+            len = 0;
+
+        if (len == 0 && (len = dyn_length(code, oldcode)) == 0) {
+            /* Bogus compression stream caused string longer than table! */
+            Trace((stderr, "unshrink string overflow!\n"));
+            return PK_ERR;
+        }
+        if (G.outcnt + len > outbufsiz) {
+            if ((error = flush_outbuf(&stamp)) != 0)
+                return error;
+            oldstamp = 0; /* never current */
+        }
+        out = G.outptr;
+        p = out + len;
 
         if (parent[code] == FREE_CODE) {
             /* or (FLAG_BITS[code] & FREE_CODE)? */
             Trace((stderr, " (found a KwKwK code %d; oldcode = %d)\n", code,
                    oldcode));
-            *newstr-- = finalval;
+            *--p = finalval;
             code = oldcode;
-        }
-
-        while (code != BOGUSCODE) {
-            if (newstr < stack) {
-                /* Bogus compression stream caused buffer underflow! */
-                Trace((stderr, "unshrink stack overflow!\n"));
-                return PK_ERR;
+            if (Length[code] != 0 && oldstamp == stamp) {
+                /* the previous string is still right in front of us */
+                memcpy(out, G.outbuf + oldpos, len - 1);
+                p = out;
             }
+        } else if (Length[code] != 0) {
+            if (Stamp[code] == stamp) {
+                memcpy(out, G.outbuf + Where[code], len);
+                p = out;
+            } else {
+                /* a fixed string from before the last flush:  rebuild it
+                   and remember where it is now */
+                Where[code] = (uint16_t) (out - G.outbuf);
+                Stamp[code] = stamp;
+                do {
+                    *--p = Value[code];
+                    code = (shrint) (parent[code] & CODE_MASK);
+                } while (p > out);
+            }
+        }
+        /* otherwise walk the tree from leaf back to root (exactly as
+           dyn_length() did to measure it) */
+        while (p > out) {
             if (parent[code] == FREE_CODE) {
-                /* or (FLAG_BITS[code] & FREE_CODE)? */
-                Trace((stderr, " (found a KwKwK code %d; oldcode = %d)\n", code,
-                       oldcode));
-                *newstr-- = finalval;
+                *--p = finalval;
                 code = oldcode;
             } else {
-                *newstr-- = Value[code];
+                *--p = Value[code];
                 code = (shrint) (parent[code] & CODE_MASK);
             }
         }
-
-        len = (int) (stacktop - newstr++);
-        finalval = *newstr;
-
-        /*-----------------------------------------------------------------------
-            Write expanded string in reverse order to output buffer.
-          -----------------------------------------------------------------------*/
+        finalval = *out;
 
         Trace((stderr, "code %4d; oldcode %4d; char %3d (%c); len %d; string [",
-               curcode, oldcode, (int) (*newstr),
-               (*newstr < 32 || *newstr >= 127) ? ' ' : *newstr, len));
-
-        for (p = newstr; p < newstr + len; ++p) {
-            *G.outptr++ = *p;
+               curcode, oldcode, (int) finalval,
+               (finalval < 32 || finalval >= 127) ? ' ' : finalval, len));
+#ifdef DEBUG
+        for (p = out; p < out + len; ++p)
             OUTDBG(*p);
-            if (++G.outcnt == outbufsiz) {
-                Trace((stderr, "doing flush(), outcnt = %lu\n", G.outcnt));
-                if ((error = flush(G.outbuf, G.outcnt, TRUE)) != 0) {
-                    Trace((stderr, "unshrink:  flush() error (%d)\n", error));
-                    return error;
-                }
-                G.outptr = G.outbuf;
-                G.outcnt = 0L;
-                Trace((stderr, "done with flush()\n"));
-            }
-        }
+#endif
+        G.outptr += len;
+        G.outcnt += len;
 
         /*-----------------------------------------------------------------------
-            Add new leaf (first character of newstr) to tree as child of
-          oldcode.
+            Add new leaf (first character of out) to tree as child of
+          oldcode.  Its string is the previous one plus that character, so
+          if the previous string is fixed, the new one is found at oldpos.
           -----------------------------------------------------------------------*/
 
         /* search for freecode */
@@ -254,28 +296,81 @@ int unshrink()
 
         Value[code] = finalval;
         parent[code] = oldcode;
+        if (Length[oldcode] != 0) {
+            Length[code] = (uint16_t) (Length[oldcode] + 1);
+            Where[code] = (uint16_t) oldpos;
+            Stamp[code] = oldstamp;
+        } else
+            Length[code] = 0; /* an orphan (see above), or a descendant */
         oldcode = curcode;
+        oldpos = (unsigned int) (out - G.outbuf);
+        oldstamp = stamp;
     }
 
     /*---------------------------------------------------------------------------
         Flush any remaining data and return to sender...
       ---------------------------------------------------------------------------*/
 
-    if (G.outcnt > 0L) {
-        Trace((stderr, "doing final flush(), outcnt = %lu\n", G.outcnt));
-        if ((error = flush(G.outbuf, G.outcnt, TRUE)) != 0) {
-            Trace((stderr, "unshrink:  flush() error (%d)\n", error));
-            return error;
-        }
-        Trace((stderr, "done with flush()\n"));
-    }
+    if (G.outcnt > 0L)
+        return flush_outbuf(&stamp);
+
+    return PK_OK;
+}
 
+/* Hand outbuf to the output sink; called before a string would overrun it.
+   Offsets recorded before this refer to data that is gone, so *stamp moves
+   on (and when it wraps around, all the old stamps are wiped). */
+static int flush_outbuf(stamp) uint8_t *stamp;
+{
+    int error;
+
+    Trace((stderr, "doing flush(), outcnt = %lu\n", G.outcnt));
+    if ((error = (*G.flush)(G.outbuf, G.outcnt)) != 0) {
+        Trace((stderr, "unshrink:  flush() error (%d)\n", error));
+        return error;
+    }
+    G.outptr = G.outbuf;
+    G.outcnt = 0L;
+    if (++*stamp == 0) {
+        memzero(Stamp, HSIZE);
+        *stamp = 1;
+    }
+    Trace((stderr, "done with flush()\n"));
     return PK_OK;
 }
 
-static void partial_clear(lastcodeused) int lastcodeused;
+/* Length of the string of a code that has no fixed string, or 0 if it is
+   longer than the table (possible only with a bogus compression stream).
+   A freed code on the way stands for the previous string (KwKwK). */
+static int dyn_length(code, oldcode) int code, oldcode;
+{
+    int len = 0;
+
+    if (parent[code] == FREE_CODE) {
+        ++len;
+        code = oldcode;
+    }
+    while (code != BOGUSCODE) {
+        if (len == HSIZE)
+            return 0;
+        ++len;
+        if (parent[code] == FREE_CODE)
+            code = oldcode;
+        else
+            code = parent[code] & CODE_MASK;
+    }
+    return len;
+}
+
+/* Clear all leaves among the codes up to lastcodeused and return the code
+   after which the search for free codes is to resume.  Codes below the
+   first free one are all in use, so the search need not start over at the
+   bottom of the table. */
+static shrint partial_clear(lastcodeused) int lastcodeused;
 {
     register shrint code;
+    shrint resume = (shrint) lastcodeused;
+    int changed;
 
     /* first loop:  mark each parent as such */
     for (code = BOGUSCODE + 1; code <= lastcodeused; ++code) {
@@ -292,6 +387,29 @@ static void partial_clear(lastcodeused) int lastcodeused;
         else { /* leaf:  lose it */
             Trace((stderr, "%d\n", code));
             parent[code] = FREE_CODE;
+            Length[code] = 0;
         }
+        if (parent[code] == FREE_CODE && code <= resume)
+            resume = (shrint) (code - 1);
+    }
+
+    /* Only codes above lastcodeused can have lost their parent, and they
+       usually have not (there are none when the table was full).  If one
+       has, it and its descendants no longer have a fixed string. */
+    for (code = (shrint) (lastcodeused + 1); code < HSIZE; ++code)
+        if (Length[code] != 0 && Length[parent[code] & CODE_MASK] == 0)
+            break;
+    if (code < HSIZE) {
+        do {
+            changed = FALSE;
+            for (code = BOGUSCODE + 1; code < HSIZE; ++code) {
+                if (Length[code] != 0 &&
+                    Length[parent[code] & CODE_MASK] == 0) {
+                    Length[code] = 0;
+                    changed = TRUE;
+                }
+            }
+        } while (changed);
     }
+    return resume;
 }
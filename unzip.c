@@ -72,10 +72,13 @@ static const char MustGiveExdir[] =
 static const char MustGivePasswd[] =
     "error:  must give decryption password with -P option\n";
 
+static const char MustGiveInflater[] =
+    "error:  must give Deflate backend name with -I option\n";
+
 static const char UnzipUsage[] = "\
 Usage: unzip [-opts[modifiers]] file[.zip] [list] [-x xlist] [-d exdir]\n\
  Default action is to extract files in list, except those in xlist, to exdir;\n\
-  file[.zip] may be a wildcard.\n\
+  file[.zip] may be a wildcard, or - to read the zipfile from a pipe.\n\
   -p  extract files to pipe, no messages     -l  list files (short format)\n\
   -f  freshen existing files, create none    -t  test compressed archive data\n\
   -u  update files, create if necessary      -z  display archive comment only\n\
@@ -88,7 +91,9 @@ modifiers:\n\
   -U  use escapes for all non-ASCII Unicode  -UU ignore any Unicode fields\n\
   -C  match filenames case-insensitively     -L  make (some) names lowercase\n\
   -X  restore UID/GID info                   -V  retain VMS version numbers\n\
-  -K  keep setuid/setgid/tacky permissions\n\
+  -K  keep setuid/setgid/tacky permissions   -S  sync files to disk at end\n\
+  -I name  decode Deflate with backend name  -SS fsync each file when closed\n\
+  -R  rebuild lost zipfile directory         -F  follow zipfile being written\n\
 Examples:\n\
   unzip data1 -x joe   => extract all files except joe from zipfile data1.zip\n\
   unzip -p foo | more  => send contents of foo.zip via pipe into program more\n\
@@ -345,7 +350,8 @@ char ***pargv;
     argc = *pargc;
     argv = *pargv;
 
-    while (++argv, (--argc > 0 && *argv != NULL && **argv == '-')) {
+    while (++argv, (--argc > 0 && *argv != NULL && **argv == '-' &&
+                    (*argv)[1] != '\0')) { /* "-" is a zipfile:  stdin */
         s = *argv + 1;
         while ((c = *s++) != 0) {
             switch (c) {
@@ -431,6 +437,10 @@ char ***pargv;
                 G.UzO.uflag = !negative;
                 negative = 0;
                 break;
+            case 'F': /* follow a zipfile that is still being written */
+                G.UzO.F_flag = !negative;
+                negative = 0;
+                break;
             case 'h': /* just print help message and quit */
                 if (showhelp == 0) {
                     if (*s == 'h')
@@ -440,6 +450,25 @@ char ***pargv;
                     }
                 }
                 break;
+            case 'I': /* -I name:  Deflate backend to use (see infsel.c) */
+                if (negative) { /* -I- name is not meaningful */
+                    Info(slide, 1, ((char *) slide, MustGiveInflater));
+                    return (PK_PARAM);
+                }
+                /* "-Iname" or "-I name", as -P */
+                if (*s == '\0') {
+                    if (argc <= 1) {
+                        Info(slide, 1, ((char *) slide, MustGiveInflater));
+                        return (PK_PARAM);
+                    }
+                    --argc;
+                    s = *++argv;
+                }
+                if (inflate_select(s) != PK_OK)
+                    return (PK_PARAM);
+                while (*s != 0) /* the rest of the argument is the name */
+                    ++s;
+                break;
             case 'j': /* junk pathnames/directory structure */
                 G.UzO.jflag = !negative;
                 negative = 0;
@@ -523,6 +552,17 @@ char ***pargv;
                 } else
                     ++G.UzO.qflag;
                 break;
+            case 'R': /* recover:  rebuild a lost central directory */
+                G.UzO.R_flag = !negative;
+                negative = 0;
+                break;
+            case 'S': /* make extracted files durable (-SS: fsync each) */
+                if (negative) {
+                    G.UzO.S_flag = MAX(G.UzO.S_flag - negative, 0);
+                    negative = 0;
+                } else
+                    ++G.UzO.S_flag;
+                break;
             case 't':
                 G.UzO.tflag = !negative;
                 negative = 0;
@@ -607,6 +647,8 @@ char ***pargv;
     }
     if (G.UzO.aflag > 2)
         G.UzO.aflag = 2;
+    if (G.UzO.S_flag > 2)
+        G.UzO.S_flag = 2;
     if (G.UzO.overwrite_all && G.UzO.overwrite_none) {
         Info(slide, 1,
              ((char *) slide,
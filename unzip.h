@@ -88,6 +88,7 @@ typedef struct _UzpOpts {
     int C_flag;         /* -C: match filenames case-insensitively */
     int D_flag;         /* -D: don't restore directory (-DD: any) timestamps */
     int fflag;          /* -f: "freshen" (extract only newer files) */
+    int F_flag;         /* -F: follow a zipfile that is still being written */
     int jflag;          /* -j: junk pathnames (unzip) */
     int K_flag;         /* -K: keep setuid/setgid/tacky permissions */
     int lflag;          /* -12slmv: listing format */
@@ -95,6 +96,8 @@ typedef struct _UzpOpts {
     int overwrite_none; /* -n: never overwrite files (no prompting) */
     int overwrite_all;  /* -o: OK to overwrite files without prompting */
     int qflag;          /* -q: produce a lot less output */
+    int R_flag;         /* -R: rebuild a lost central dir from local headers */
+    int S_flag;         /* -S: sync extracted files (-SS: fsync each file) */
     int tflag;          /* -t: test (unzip) or totals line */
     int T_flag;         /* -T: timestamps (unzip) or dec. time fmt */
     int uflag;          /* -u: "update" (extract only newer/brand-new files) */
@@ -30,7 +30,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 
-#define UNZIP_VERSION     46
+#define UNZIP_VERSION     63 /* 6.3:  LZMA */
 #define VMS_UNZIP_VERSION 42 /* if OS-needed-to-extract is VMS:  can do */
 
 /* clean up with a few defaults */
@@ -41,7 +41,7 @@
 #define DATE_SEPCHAR '-'
 #endif
 #ifndef CLOSE_INFILE
-#define CLOSE_INFILE() close(G.zipfd)
+#define CLOSE_INFILE() close_infile()
 #endif
 
 /* defaults that we hope will take care of most machines in the future */
@@ -55,6 +55,22 @@
 #define WSIZE 65536L /* window size--must be a power of two, and */
 #endif
 
+/* inflate() and explode() write their output into a ring of RINGSIZ bytes
+   that is mapped twice, back to back (see map_ring()), so neither a match
+   copy nor a flush has to stop at the wrap point; output is flushed once
+   RINGFLUSH bytes are pending, so a window never grows beyond RINGROOM (a
+   maximal Deflate64 match past the flush point).  The rest of the ring
+   holds the WSIZE history and, with a writer thread (USE_PIPELINE), the
+   windows it has not drained yet.  RINGSIZ must be a multiple of the page
+   size.  Without the double mapping, slide[] is used as before.  A large
+   member inflated to a file may instead use the file itself, mapped into
+   memory, as a window that never wraps (G.outmaplen, see select_flush()). */
+#define RINGSIZ   (16 * WSIZE)
+#define RINGFLUSH (2 * WSIZE)
+#define RINGROOM  (RINGFLUSH + WSIZE + 2)
+#define WINDOW    (G.ring ? G.ring + G.wf : redirSlide) /* pending output */
+#define WINDOWEND (G.ring ? RINGFLUSH : WSIZE)          /* flush point */
+
 #ifndef INBUFSIZ
 #define INBUFSIZ 8192 /* larger buffers for real OSes */
 #endif
@@ -265,11 +281,13 @@ char *plastchar(const char *ptr, size_t len);
 #define LZMAED      14
 #define IBMTERSED   18
 #define IBMLZ77ED   19
+#define ZSTDED      93
 #define WAVPACKED   97
 #define PPMDED      98
-#define NUM_METHODS 17 /* number of known method IDs */
+#define NUM_METHODS 18 /* number of known method IDs */
 /* don't forget to update list.c (list_files()) and extract.c
  * appropriately if NUM_METHODS changes */
+#define AESENCRED   99 /* WinZip AES:  real method is in the extra field */
 
 /* (the PK-class error codes are public and have been moved into unzip.h) */
 
@@ -304,6 +322,7 @@ char *plastchar(const char *ptr, size_t len);
 #define EF_TANDEM  0x4154 /* Tandem NSK ("TA") */
 #define EF_THEOS   0x6854 /* Jean-Michel Dubois' Theos "Th" */
 #define EF_ASIUNIX 0x756e /* ASi's Unix ("nu") */
+#define EF_AES     0x9901 /* WinZip AES encryption ("\001\231") */
 
 #define EB_HEADSIZE    4 /* length of extra field block header */
 #define EB_ID          0 /* offset of block ID in header */
@@ -406,6 +425,13 @@ typedef struct slinkentry {  /* info for deferred symlink creation */
     char buf[1];             /* data/name/link buffer */
 } slinkentry;
 
+typedef struct zipvol { /* one file of a split archive (see fileio.c) */
+    int fd;
+    off_t start; /* where it starts in the archive, the files one after
+                    the other */
+    off_t size;
+} zipvol;
+
 typedef struct min_info {
     off_t offset;
     uint64_t compr_size;   /* compressed size (needed if extended header) */
@@ -424,19 +450,29 @@ typedef struct min_info {
     unsigned symlink   : 1; /* file is a symbolic link */
     unsigned HasUxAtt  : 1; /* crec ext_file_attr has Unix style mode bits */
     unsigned GPFIsUTF8 : 1; /* crec gen_purpose_flag UTF-8 bit 11 is set */
+    unsigned aes       : 2; /* WinZip AES key strength (1-3), 0 if not AES */
+    unsigned aes_v2    : 1; /* AE-2:  no CRC, authentication code only */
+    uint16_t aes_method;    /* WinZip AES:  the real compression method */
     char *cfilname;         /* central header version of filename */
 } min_info;
 
+/* Output sink for decompressed data:  one of the flush_*() variants in
+   fileio.c (or memflush()), chosen once per member by select_flush() and
+   called through G.flush.  buf is G.outbuf when it comes from unshrink(). */
+typedef int(FlushFn)(uint8_t *buf, uint32_t size);
+
 /*---------------------------------------------------------------------------
     Zipfile work area declarations.
   ---------------------------------------------------------------------------*/
 
 union work {
     struct {                  /* unshrink(): */
-        shrint Parent[HSIZE]; /* (8192 * sizeof(shrint)) == 16KB minimum */
-        uint8_t value[HSIZE]; /* 8KB */
-        uint8_t Stack[HSIZE]; /* 8KB */
-    } shrink;                 /* total = 32KB minimum; 80KB on Cray/Alpha */
+        uint16_t Parent[HSIZE]; /* 16KB (code and flag bits fit in 15) */
+        uint8_t value[HSIZE];   /* 8KB */
+        uint16_t length[HSIZE]; /* 16KB */
+        uint16_t where[HSIZE];  /* 16KB */
+        uint8_t stamp[HSIZE];   /* 8KB */
+    } shrink;                   /* total = 64KB, <= WSIZE */
     uint8_t Slide[WSIZE];     /* explode(), inflate(), unreduce() */
 };
 
@@ -584,6 +620,17 @@ struct huft {
     } v;
 };
 
+/* A Huffman table explode() kept for the next member:  archives written in
+   one go tend to use the same trees for many members. */
+struct xtree {
+    struct huft *t;    /* table from huft_build(), or NULL */
+    struct huft *f;    /* for literals:  flag+literal table, or NULL */
+    unsigned bits;     /* lookup bits of t */
+    unsigned m;        /* lookup bits asked for */
+    const uint16_t *d; /* base values t was built with */
+    uint8_t l[256];    /* code lengths t was built from */
+};
+
 #include "globals.h"
 
 /*************************/
@@ -610,11 +657,14 @@ int process_zipfiles(void);
 void free_G_buffers(void);
 int process_cdir_file_hdr(void);
 int process_local_file_hdr(void);
+int process_stream_file_hdr(void);
 int getZip64Data(const uint8_t *ef_buf, unsigned ef_len);
 int getUnicodeData(const uint8_t *ef_buf, unsigned ef_len);
+int getAESData(const uint8_t *ef_buf, unsigned ef_len);
 unsigned ef_scan_for_izux(const uint8_t *ef_buf, unsigned ef_len, int ef_is_c,
                           uint32_t dos_mdatetime, iztimes *z_utim,
                           uint32_t *z_uidgid);
+int recover_cdir(void); /* recover.c */
 
 /*---------------------------------------------------------------------------
     Functions in list.c (generic zipfile-listing routines):
@@ -637,7 +687,20 @@ unsigned readbuf(char *buf, register unsigned len);
 int readbyte(void);
 int fillinbuf(void);
 int seek_zipf(off_t abs_offset);
-int flush(uint8_t *buf, uint32_t size, int unshrink);
+int zip_read(uint8_t *buf, unsigned len);
+off_t zip_lseek(off_t ofs, int whence);
+void close_infile(void);
+int follow_wait(off_t len);
+void select_flush(void);
+int flush_window(unsigned w);
+int unmap_output(void);
+#ifdef USE_PIPELINE
+void pipe_start(void);
+int pipe_stop(void);
+#else
+#define pipe_start()
+#define pipe_stop() PK_OK
+#endif
 /* static int  disk_error(void); */
 void handler(int signal);
 time_t dos_to_unix_time(uint32_t dos_datetime);
@@ -674,7 +737,7 @@ int extract_or_test_files(void);
 unsigned find_compr_idx(unsigned compr_methodnum);
 int memextract(uint8_t *tgt, uint32_t tgtsize, const uint8_t *src,
                uint32_t srcsize);
-int memflush(const uint8_t *rawbuf, uint32_t size);
+int memflush(uint8_t *rawbuf, uint32_t size);
 char *fnfilter(const char *raw, uint8_t *space, size_t size);
 
 /*---------------------------------------------------------------------------
@@ -682,13 +745,22 @@ char *fnfilter(const char *raw, uint8_t *space, size_t size);
   ---------------------------------------------------------------------------*/
 
 int explode(void);             /* explode.c */
+int explode_free(void);        /* explode.c */
 int huft_free(struct huft *t); /* inflate.c */
 int huft_build(const unsigned *b, unsigned n, unsigned s, const uint16_t *d,
                const uint8_t *e, struct huft **t, unsigned *m);
-int inflate(int is_defl64);            /* inflate.c */
-int inflate_free(void);                /* inflate.c */
+int inflate_builtin(int is_defl64);    /* inflate.c */
+int UZinflate(int is_defl64);          /* infsel.c */
+int inflate_select(const char *name);  /* infsel.c */
 int unshrink(void);                    /* unshrink.c */
+int unlzma(void);                      /* unlzma.c */
 int UZbunzip2(void);                   /* extract.c */
+#ifdef USE_ZSTD
+int UZunzstd(void); /* extract.c */
+#endif
+#ifdef USE_PIPELINE
+int UZbunzip2_par(void); /* bzpar.c */
+#endif
 void bz_internal_error(int bzerrcode); /* ubz2err.c */
 
 /*---------------------------------------------------------------------------
@@ -714,10 +786,16 @@ int checkdir_root(char *pathcomp);
 void checkdir_end(char *pathcomp);
 char *do_wild(const char *wildzipfn);              /* local */
 char *GetLoadPath(void);                           /* local */
-void close_outfile(void);                          /* local */
+int close_outfile(void);                           /* local */
 int set_symlnk_attribs(slinkentry *slnk_entry);    /* local */
 int defer_dir_attribs(direntry **pd);              /* local */
 int set_direc_attribs(direntry *d);                /* local */
+int sync_extracted(void);                          /* local */
+uint8_t *map_ring(size_t size);                    /* local */
+void unmap_ring(uint8_t *ring, size_t size);       /* local */
+uint8_t *map_outfile(FILE *file, size_t size);     /* local */
+void fault_outfile(uint8_t *p, size_t len);        /* local */
+int unmap_outfile(FILE *file, uint8_t *map, size_t size, off_t len); /* local */
 int stamp_file(const char *fname, time_t modtime); /* local */
 
 /************/
@@ -793,9 +871,7 @@ int stamp_file(const char *fname, time_t modtime); /* local */
             return error;                                    \
     }
 
-#define FLUSH(w)                                         \
-    ((G.mem_mode) ? memflush(redirSlide, (uint32_t) (w)) \
-                  : flush(redirSlide, (uint32_t) (w), 0))
+#define FLUSH(w) (*G.flush)(redirSlide, (uint32_t) (w))
 #define NEXTBYTE (G.incnt-- > 0 ? (int) (*G.inptr++) : readbyte())
 
 /* GRR:  should use StringLower for STRLOWER macro if possible */